@@ -28,9 +28,9 @@
 
 static void check_be_blur(BeBlurFunc func)
 {
-    ALIGN(uint8_t buf_ref[STRIDE * HEIGHT], 32);
-    ALIGN(uint8_t buf_new[STRIDE * HEIGHT], 32);
-    ALIGN(uint16_t tmp[STRIDE * 2], 32);
+    ALIGN(uint8_t buf_ref[STRIDE * HEIGHT], 64);
+    ALIGN(uint8_t buf_new[STRIDE * HEIGHT], 64);
+    ALIGN(uint16_t tmp[STRIDE * 2], 64);
     declare_func(void,
                  uint8_t *buf, ptrdiff_t stride,
                  size_t width, size_t height, uint16_t *tmp);
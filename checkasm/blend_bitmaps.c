@@ -30,9 +30,9 @@
 
 static void check_blend_bitmaps(BitmapBlendFunc func, const char *name)
 {
-    ALIGN(uint8_t src[SRC1_STRIDE * HEIGHT], 32);
-    ALIGN(uint8_t dst_ref[DST_STRIDE * HEIGHT], 32);
-    ALIGN(uint8_t dst_new[DST_STRIDE * HEIGHT], 32);
+    ALIGN(uint8_t src[SRC1_STRIDE * HEIGHT], 64);
+    ALIGN(uint8_t dst_ref[DST_STRIDE * HEIGHT], 64);
+    ALIGN(uint8_t dst_new[DST_STRIDE * HEIGHT], 64);
     declare_func(void,
                  uint8_t *dst, ptrdiff_t dst_stride,
                  const uint8_t *src, ptrdiff_t src_stride,
@@ -63,10 +63,10 @@ static void check_blend_bitmaps(BitmapBlendFunc func, const char *name)
 
 static void check_mul_bitmaps(BitmapMulFunc func)
 {
-    ALIGN(uint8_t src1[SRC1_STRIDE * HEIGHT], 32);
-    ALIGN(uint8_t src2[SRC2_STRIDE * HEIGHT], 32);
-    ALIGN(uint8_t dst_ref[DST_STRIDE * HEIGHT], 32);
-    ALIGN(uint8_t dst_new[DST_STRIDE * HEIGHT], 32);
+    ALIGN(uint8_t src1[SRC1_STRIDE * HEIGHT], 64);
+    ALIGN(uint8_t src2[SRC2_STRIDE * HEIGHT], 64);
+    ALIGN(uint8_t dst_ref[DST_STRIDE * HEIGHT], 64);
+    ALIGN(uint8_t dst_new[DST_STRIDE * HEIGHT], 64);
     declare_func(void,
                  uint8_t *dst, ptrdiff_t dst_stride,
                  const uint8_t *src1, ptrdiff_t src1_stride,
@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ass_compat.h"
+
+#include "checkasm.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define MAX_WIDTH  80
+#define MAX_HEIGHT 9
+#define SRC_STRIDE (MAX_WIDTH + 48)
+#define DST_STRIDE (4 * MAX_WIDTH + 48)
+
+// Random stride of at least min_stride bytes
+static ptrdiff_t random_stride(int min_stride, int max_stride)
+{
+    return min_stride + rnd() % (max_stride - min_stride + 1);
+}
+
+static void check_blend_rgba(FrameBlendFunc func)
+{
+    ALIGN(uint8_t src[SRC_STRIDE * MAX_HEIGHT], 64);
+    ALIGN(uint8_t dst_ref[DST_STRIDE * MAX_HEIGHT], 64);
+    ALIGN(uint8_t dst_new[DST_STRIDE * MAX_HEIGHT], 64);
+    declare_func(void,
+                 uint8_t *dst, ptrdiff_t dst_stride,
+                 const uint8_t *src, ptrdiff_t src_stride,
+                 size_t width, size_t height, uint32_t color);
+
+    if (check_func(func, "blend_rgba")) {
+        for (int w = 1; w <= MAX_WIDTH; w++) {
+            int h = 1 + rnd() % MAX_HEIGHT;
+            ptrdiff_t src_stride = random_stride(w, SRC_STRIDE);
+            ptrdiff_t dst_stride = random_stride(4 * w, DST_STRIDE);
+            uint32_t color = rnd() ^ (uint32_t) rnd() << 16;
+
+            for (int i = 0; i < sizeof(src); i++)
+                src[i] = rnd();
+            for (int i = 0; i < sizeof(dst_ref); i++)
+                dst_ref[i] = dst_new[i] = rnd();
+
+            call_ref(dst_ref, dst_stride, src, src_stride, w, h, color);
+            call_new(dst_new, dst_stride, src, src_stride, w, h, color);
+
+            if (memcmp(dst_ref, dst_new, sizeof(dst_ref))) {
+                fail();
+                break;
+            }
+        }
+
+        bench_new(dst_new, DST_STRIDE, src, SRC_STRIDE,
+                  MAX_WIDTH, MAX_HEIGHT, 0x80FF8040);
+    }
+
+    report("blend_rgba");
+}
+
+static void check_blend_plane8(FrameBlendFunc func)
+{
+    ALIGN(uint8_t src[SRC_STRIDE * MAX_HEIGHT], 64);
+    ALIGN(uint8_t dst_ref[DST_STRIDE * MAX_HEIGHT], 64);
+    ALIGN(uint8_t dst_new[DST_STRIDE * MAX_HEIGHT], 64);
+    declare_func(void,
+                 uint8_t *dst, ptrdiff_t dst_stride,
+                 const uint8_t *src, ptrdiff_t src_stride,
+                 size_t width, size_t height, uint32_t color);
+
+    if (check_func(func, "blend_plane8")) {
+        for (int w = 1; w <= MAX_WIDTH; w++) {
+            int h = 1 + rnd() % MAX_HEIGHT;
+            ptrdiff_t src_stride = random_stride(w, SRC_STRIDE);
+            ptrdiff_t dst_stride = random_stride(w, DST_STRIDE);
+            uint32_t color = rnd() ^ (uint32_t) rnd() << 16;
+
+            for (int i = 0; i < sizeof(src); i++)
+                src[i] = rnd();
+            for (int i = 0; i < sizeof(dst_ref); i++)
+                dst_ref[i] = dst_new[i] = rnd();
+
+            call_ref(dst_ref, dst_stride, src, src_stride, w, h, color);
+            call_new(dst_new, dst_stride, src, src_stride, w, h, color);
+
+            if (memcmp(dst_ref, dst_new, sizeof(dst_ref))) {
+                fail();
+                break;
+            }
+        }
+
+        bench_new(dst_new, DST_STRIDE, src, SRC_STRIDE,
+                  MAX_WIDTH, MAX_HEIGHT, 0x80FF8040);
+    }
+
+    report("blend_plane8");
+}
+
+// With chroma set, the arguments are those of the interleaved chroma plane
+// of a P010 frame of odd width: the mask holds every value twice, and the
+// last pair covers the odd column of the frame.
+static void check_blend_plane16(FrameBlend16Func func, bool chroma)
+{
+    ALIGN(uint8_t src[SRC_STRIDE * MAX_HEIGHT], 64);
+    ALIGN(uint16_t dst_ref[DST_STRIDE * MAX_HEIGHT / 2], 64);
+    ALIGN(uint16_t dst_new[DST_STRIDE * MAX_HEIGHT / 2], 64);
+    declare_func(void,
+                 uint16_t *dst, ptrdiff_t dst_stride,
+                 const uint8_t *src, ptrdiff_t src_stride,
+                 size_t width, size_t height,
+                 uint32_t color, unsigned alpha);
+
+    if (check_func(func, "blend_plane16%s", chroma ? "_chroma" : "")) {
+        for (int w = 1; w <= MAX_WIDTH; w++) {
+            if (chroma && !(w & 1))
+                continue;
+            int width = chroma ? w + 1 : w;
+            int h = 1 + rnd() % MAX_HEIGHT;
+            ptrdiff_t src_stride = random_stride(width, SRC_STRIDE);
+            ptrdiff_t dst_stride = 2 * random_stride(width, DST_STRIDE / 2);
+            uint32_t color = (rnd() & 0x3FF) << 6;
+            color |= (chroma ? (rnd() & 0x3FF) << 6 : color) << 16;
+            unsigned alpha = rnd() & 0xFF;
+
+            for (int i = 0; i < sizeof(src); i++)
+                src[i] = rnd();
+            if (chroma) {
+                for (int y = 0; y < h; y++)
+                    for (int x = 0; x < width; x += 2)
+                        src[y * src_stride + x + 1] = src[y * src_stride + x];
+            }
+            for (int i = 0; i < sizeof(dst_ref) / 2; i++)
+                dst_ref[i] = dst_new[i] = (rnd() & 0x3FF) << 6;
+
+            call_ref(dst_ref, dst_stride, src, src_stride, width, h, color, alpha);
+            call_new(dst_new, dst_stride, src, src_stride, width, h, color, alpha);
+
+            if (memcmp(dst_ref, dst_new, sizeof(dst_ref))) {
+                fail();
+                break;
+            }
+        }
+
+        bench_new(dst_new, DST_STRIDE, src, SRC_STRIDE,
+                  MAX_WIDTH, MAX_HEIGHT, 0x80004000, 0x80);
+    }
+
+    report("blend_plane16%s", chroma ? "_chroma" : "");
+}
+
+void checkasm_check_blend_frame(unsigned cpu_flag)
+{
+    BitmapEngine engine = ass_bitmap_engine_init(cpu_flag);
+    check_blend_rgba(engine.blend_rgba);
+    check_blend_plane8(engine.blend_plane8);
+    check_blend_plane16(engine.blend_plane16, false);
+    check_blend_plane16(engine.blend_plane16, true);
+}
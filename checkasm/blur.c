@@ -29,9 +29,9 @@
 
 static void check_stripe_unpack(Convert8to16Func func, const char *name, int align)
 {
-    ALIGN(uint8_t src[STRIDE * HEIGHT], 32);
-    ALIGN(int16_t dst_ref[STRIDE * HEIGHT], 32);
-    ALIGN(int16_t dst_new[STRIDE * HEIGHT], 32);
+    ALIGN(uint8_t src[STRIDE * HEIGHT], 64);
+    ALIGN(int16_t dst_ref[STRIDE * HEIGHT], 64);
+    ALIGN(int16_t dst_new[STRIDE * HEIGHT], 64);
     declare_func(void,
                  int16_t *dst, const uint8_t *src, ptrdiff_t src_stride,
                  size_t width, size_t height);
@@ -62,9 +62,9 @@ static void check_stripe_unpack(Convert8to16Func func, const char *name, int ali
 
 static void check_stripe_pack(Convert16to8Func func, const char *name, int align)
 {
-    ALIGN(int16_t src[STRIDE * HEIGHT], 32);
-    ALIGN(uint8_t dst_ref[STRIDE * HEIGHT], 32);
-    ALIGN(uint8_t dst_new[STRIDE * HEIGHT], 32);
+    ALIGN(int16_t src[STRIDE * HEIGHT], 64);
+    ALIGN(uint8_t dst_ref[STRIDE * HEIGHT], 64);
+    ALIGN(uint8_t dst_new[STRIDE * HEIGHT], 64);
     declare_func(void,
                  uint8_t *dst, ptrdiff_t dst_stride, const int16_t *src,
                  size_t width, size_t height);
@@ -99,11 +99,11 @@ static void check_stripe_pack(Convert16to8Func func, const char *name, int align
 
 static void check_fixed_filter(FilterFunc func, const char *name, int align)
 {
-    enum { PADDING = FFMAX(32 * HEIGHT, 4 * STRIDE) };
+    enum { PADDING = FFMAX(64 * HEIGHT, 4 * STRIDE) };
 
-    ALIGN(int16_t src[STRIDE * HEIGHT], 32);
-    ALIGN(int16_t dst_ref[2 * STRIDE * HEIGHT + PADDING], 32);
-    ALIGN(int16_t dst_new[2 * STRIDE * HEIGHT + PADDING], 32);
+    ALIGN(int16_t src[STRIDE * HEIGHT], 64);
+    ALIGN(int16_t dst_ref[2 * STRIDE * HEIGHT + PADDING], 64);
+    ALIGN(int16_t dst_new[2 * STRIDE * HEIGHT + PADDING], 64);
     declare_func(void,
                  int16_t *dst, const int16_t *src,
                  size_t src_width, size_t src_height);
@@ -134,11 +134,11 @@ static void check_fixed_filter(FilterFunc func, const char *name, int align)
 
 static void check_param_filter(ParamFilterFunc func, const char *name, int n, int align)
 {
-    enum { PADDING = FFMAX(32 * HEIGHT, 16 * STRIDE) };
+    enum { PADDING = FFMAX(64 * HEIGHT, 16 * STRIDE) };
 
-    ALIGN(int16_t src[STRIDE * HEIGHT], 32);
-    ALIGN(int16_t dst_ref[STRIDE * HEIGHT + PADDING], 32);
-    ALIGN(int16_t dst_new[STRIDE * HEIGHT + PADDING], 32);
+    ALIGN(int16_t src[STRIDE * HEIGHT], 64);
+    ALIGN(int16_t dst_ref[STRIDE * HEIGHT + PADDING], 64);
+    ALIGN(int16_t dst_new[STRIDE * HEIGHT + PADDING], 64);
     int16_t param[8];
     declare_func(void,
                  int16_t *dst, const int16_t *src,
@@ -177,11 +177,12 @@ static void check_param_filter(ParamFilterFunc func, const char *name, int n, in
 
 void checkasm_check_blur(unsigned cpu_flag)
 {
-    BitmapEngine engine[2] = {
+    BitmapEngine engine[3] = {
         ass_bitmap_engine_init(cpu_flag),
-        ass_bitmap_engine_init(cpu_flag | ASS_FLAG_WIDE_STRIPE)
+        ass_bitmap_engine_init(cpu_flag | ASS_FLAG_WIDE_STRIPE),
+        ass_bitmap_engine_init(cpu_flag | ASS_FLAG_WIDER_STRIPE)
     };
-    for (int i = 0; i < 2; i++) {
+    for (int i = 0; i < 3; i++) {
         int align = 1 << engine[i].align_order;
         check_stripe_unpack(engine[i].stripe_unpack, "stripe_unpack%d", align);
         check_stripe_pack(engine[i].stripe_pack, "stripe_pack%d", align);
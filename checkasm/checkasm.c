@@ -59,6 +59,7 @@ static const struct {
 } tests[] = {
     { "rasterizer", checkasm_check_rasterizer },
     { "blend_bitmaps", checkasm_check_blend_bitmaps },
+    { "blend_frame", checkasm_check_blend_frame },
     { "be_blur", checkasm_check_be_blur },
     { "blur", checkasm_check_blur },
     { 0 }
@@ -74,8 +75,10 @@ static const struct {
     { "SSE2",               "sse2",      ASS_CPU_FLAG_X86_SSE2 },
     { "SSSE3",              "ssse3",     ASS_CPU_FLAG_X86_SSSE3 },
     { "AVX2",               "avx2",      ASS_CPU_FLAG_X86_AVX2 },
+    { "AVX-512",            "avx512",    ASS_CPU_FLAG_X86_AVX512 },
 #elif ARCH_AARCH64
     { "NEON",               "neon",      ASS_CPU_FLAG_ARM_NEON },
+    { "SVE",                "sve",       ASS_CPU_FLAG_ARM_SVE },
 #endif
     { 0 }
 };
@@ -631,7 +634,7 @@ int main(int argc, char *argv[]) {
         void checkasm_warmup_avx2(void);
         void checkasm_warmup_avx512(void);
         const unsigned cpu_flags = ass_get_cpu_flags(ASS_CPU_FLAG_ALL);
-        if (cpu_flags & /*ASS_CPU_FLAG_X86_AVX512ICL*/0)
+        if (cpu_flags & ASS_CPU_FLAG_X86_AVX512)
             state.simd_warmup = checkasm_warmup_avx512;
         else if (cpu_flags & ASS_CPU_FLAG_X86_AVX2)
             state.simd_warmup = checkasm_warmup_avx2;
@@ -71,12 +71,6 @@ void ass_free_track(ASS_Track *track)
     if (!track)
         return;
 
-    if (track->parser_priv) {
-        free(track->parser_priv->read_order_bitmap);
-        free(track->parser_priv->fontname);
-        free(track->parser_priv->fontdata);
-        free(track->parser_priv);
-    }
     free(track->style_format);
     free(track->event_format);
     free(track->Language);
@@ -90,6 +84,20 @@ void ass_free_track(ASS_Track *track)
             ass_free_event(track, i);
     }
     free(track->events);
+    // after the events, as freeing them updates the event index
+    if (track->parser_priv) {
+        free(track->parser_priv->read_order_bitmap);
+        free(track->parser_priv->fontname);
+        free(track->parser_priv->fontdata);
+        free(track->parser_priv->line);
+        free(track->parser_priv->event_index.by_start);
+        free(track->parser_priv->event_index.by_end);
+        free(track->parser_priv->event_index.max_end);
+#if CONFIG_THREADS
+        ass_mutex_destroy(&track->parser_priv->render_lock);
+#endif
+        free(track->parser_priv);
+    }
     free(track->name);
     free(track);
 }
@@ -114,6 +122,8 @@ int ass_alloc_style(ASS_Track *track)
 
     sid = track->n_styles++;
     memset(track->styles + sid, 0, sizeof(ASS_Style));
+    // may shadow an existing style of the same name
+    track->parser_priv->generation++;
     return sid;
 }
 
@@ -148,6 +158,12 @@ void ass_free_event(ASS_Track *track, int eid)
     free(event->Effect);
     free(event->Text);
     free(event->render_priv);
+
+    // the index is rebuilt on next use, as the event will be removed
+    EventIndex *index = &track->parser_priv->event_index;
+    if (eid < index->n_events)
+        index->n_events = 0;
+    track->parser_priv->event_removals++;
 }
 
 void ass_free_style(ASS_Track *track, int sid)
@@ -550,6 +566,7 @@ void ass_process_force_style(ASS_Track *track)
     if (!list)
         return;
 
+    track->parser_priv->generation++;
     for (fs = list; *fs; ++fs) {
         eq = strrchr(*fs, '=');
         if (!eq)
@@ -874,6 +891,7 @@ static inline void check_duplicate_info_line(const ASS_Track *const track,
 
 static int process_info_line(ASS_Track *track, char *str)
 {
+    track->parser_priv->generation++;
     if (!strncmp(str, "PlayResX:", 9)) {
         check_duplicate_info_line(track, SINFO_PLAYRESX, "PlayResX");
         track->PlayResX = parse_int_header(str + 9);
@@ -1046,21 +1064,6 @@ static int process_events_line(ASS_Track *track, char *str)
     return 0;
 }
 
-static unsigned char *decode_chars(const unsigned char *src,
-                                   unsigned char *dst, size_t cnt_in)
-{
-    uint32_t value = 0;
-    for (size_t i = 0; i < cnt_in; i++)
-        value |= (uint32_t) ((src[i] - 33u) & 63) << 6 * (3 - i);
-
-    *dst++ = value >> 16;
-    if (cnt_in >= 3)
-        *dst++ = value >> 8 & 0xff;
-    if (cnt_in >= 4)
-        *dst++ = value & 0xff;
-    return dst;
-}
-
 static void reset_embedded_font_parsing(ASS_ParserPriv *parser_priv)
 {
     free(parser_priv->fontname);
@@ -1071,95 +1074,79 @@ static void reset_embedded_font_parsing(ASS_ParserPriv *parser_priv)
     parser_priv->fontdata_used = 0;
 }
 
-static int decode_font(ASS_Track *track)
+static bool reserve_font_data(ASS_ParserPriv *parser_priv, size_t size)
 {
-    unsigned char *p;
-    unsigned char *q;
-    size_t i;
-    size_t size;                   // original size
-    size_t dsize;                  // decoded size
-    unsigned char *buf = 0;
+    size_t used = parser_priv->fontdata_used;
+    if (parser_priv->fontdata && used + size <= parser_priv->fontdata_size)
+        return true;
+    size_t step = FFMAX(parser_priv->fontdata_size / 2, FFMAX(size, 100 * 1024));
+    if (used >= SIZE_MAX - step)
+        return false;
+    size_t new_size = used + step;
+    if (!ASS_REALLOC_ARRAY(parser_priv->fontdata, new_size))
+        return false;
+    parser_priv->fontdata_size = new_size;
+    return true;
+}
 
-    ass_msg(track->library, MSGL_V, "Font: %zu bytes encoded data",
-            track->parser_priv->fontdata_used);
-    size = track->parser_priv->fontdata_used;
-    if (size % 4 == 1) {
+/**
+ * \brief Hand the font collected so far over to the library
+ * The data is kept encoded; it's only decoded as far as it's read,
+ * so fonts that are never used cost little more than their text.
+ */
+static int finish_font(ASS_Track *track)
+{
+    ASS_ParserPriv *parser_priv = track->parser_priv;
+
+    size_t len = parser_priv->fontdata_used;
+    if (len % 4 == 1) {
         ass_msg(track->library, MSGL_ERR, "Bad encoded data size");
-        goto error_decode_font;
-    }
-    buf = malloc(size / 4 * 3 + FFMAX(size % 4, 1) - 1);
-    if (!buf)
-        goto error_decode_font;
-    q = buf;
-    for (i = 0, p = (unsigned char *) track->parser_priv->fontdata;
-         i < size / 4; i++, p += 4) {
-        q = decode_chars(p, q, 4);
+        goto error_finish_font;
     }
-    if (size % 4 == 2) {
-        q = decode_chars(p, q, 2);
-    } else if (size % 4 == 3) {
-        q = decode_chars(p, q, 3);
-    }
-    dsize = q - buf;
-    assert(dsize == size / 4 * 3 + FFMAX(size % 4, 1) - 1);
 
-    if (track->library->extract_fonts) {
-        ass_add_font(track->library, track->parser_priv->fontname,
-                     (char *) buf, dsize);
-    }
+    ass_msg(track->library, MSGL_V, "Font: %zu bytes encoded data", len);
+    if (track->library->extract_fonts && parser_priv->fontdata &&
+            ass_add_encoded_font(track->library, parser_priv->fontname,
+                                 parser_priv->fontdata, len))
+        parser_priv->fontdata = NULL;   // owned by the library now
 
-error_decode_font:
-    free(buf);
-    reset_embedded_font_parsing(track->parser_priv);
+error_finish_font:
+    reset_embedded_font_parsing(parser_priv);
     return 0;
 }
 
 static int process_fonts_line(ASS_Track *track, char *str)
 {
-    size_t len;
+    ASS_ParserPriv *parser_priv = track->parser_priv;
 
     if (!strncmp(str, "fontname:", 9)) {
         char *p = str + 9;
         skip_spaces(&p);
-        if (track->parser_priv->fontname) {
-            decode_font(track);
+        if (parser_priv->fontname) {
+            finish_font(track);
         }
-        track->parser_priv->fontname = strdup(p);
-        if (!track->parser_priv->fontname)
+        parser_priv->fontname = strdup(p);
+        if (!parser_priv->fontname)
             return -1;
         ass_msg(track->library, MSGL_V, "Fontname: %s",
-                track->parser_priv->fontname);
+                parser_priv->fontname);
         return 0;
     }
 
-    if (!track->parser_priv->fontname) {
+    if (!parser_priv->fontname) {
         ass_msg(track->library, MSGL_V, "Not understood: '%s'", str);
         return 1;
     }
 
-    len = strlen(str);
-    if (track->parser_priv->fontdata_used >=
-        SIZE_MAX - FFMAX(len, 100 * 1024)) {
-        goto mem_fail;
-    } else if (track->parser_priv->fontdata_used + len >
-               track->parser_priv->fontdata_size) {
-        size_t new_size =
-                track->parser_priv->fontdata_size + FFMAX(len, 100 * 1024);
-        if (!ASS_REALLOC_ARRAY(track->parser_priv->fontdata, new_size))
-            goto mem_fail;
-        track->parser_priv->fontdata_size = new_size;
+    size_t len = strlen(str);
+    if (!reserve_font_data(parser_priv, len)) {
+        reset_embedded_font_parsing(parser_priv);
+        return -1;
     }
-    if (!track->parser_priv->fontdata)
-        return 0;
-    memcpy(track->parser_priv->fontdata + track->parser_priv->fontdata_used,
-           str, len);
-    track->parser_priv->fontdata_used += len;
+    memcpy(parser_priv->fontdata + parser_priv->fontdata_used, str, len);
+    parser_priv->fontdata_used += len;
 
     return 0;
-
-mem_fail:
-    reset_embedded_font_parsing(track->parser_priv);
-    return -1;
 }
 
 /**
@@ -1170,18 +1157,27 @@ mem_fail:
 static int process_line(ASS_Track *track, char *str)
 {
     skip_spaces(&str);
+    ParserState state = PST_UNKNOWN;
     if (!ass_strncasecmp(str, "[Script Info]", 13)) {
-        track->parser_priv->state = PST_INFO;
+        state = PST_INFO;
     } else if (!ass_strncasecmp(str, "[V4 Styles]", 11)) {
-        track->parser_priv->state = PST_STYLES;
+        state = PST_STYLES;
         track->track_type = TRACK_TYPE_SSA;
     } else if (!ass_strncasecmp(str, "[V4+ Styles]", 12)) {
-        track->parser_priv->state = PST_STYLES;
+        state = PST_STYLES;
         track->track_type = TRACK_TYPE_ASS;
     } else if (!ass_strncasecmp(str, "[Events]", 8)) {
-        track->parser_priv->state = PST_EVENTS;
+        state = PST_EVENTS;
     } else if (!ass_strncasecmp(str, "[Fonts]", 7)) {
-        track->parser_priv->state = PST_FONTS;
+        state = PST_FONTS;
+    }
+
+    if (state != PST_UNKNOWN) {
+        // there is no explicit end-of-font marker, but a new section
+        // ends the last font
+        if (track->parser_priv->fontname)
+            finish_font(track);
+        track->parser_priv->state = state;
     } else {
         switch (track->parser_priv->state) {
         case PST_INFO:
@@ -1229,7 +1225,7 @@ static int process_text(ASS_Track *track, char *str)
     }
     // there is no explicit end-of-font marker in ssa/ass
     if (track->parser_priv->fontname)
-        decode_font(track);
+        finish_font(track);
     return 0;
 }
 
@@ -1253,6 +1249,78 @@ void ass_process_data(ASS_Track *track, const char *data, int size)
     free(str);
 }
 
+static bool append_line(ASS_ParserPriv *parser_priv, const char *data, size_t len)
+{
+    size_t line_len = parser_priv->line_len;
+    if (line_len + len >= parser_priv->line_size) {
+        if (len >= SIZE_MAX / 2 - line_len)
+            return false;
+        size_t new_size = FFMAX(2 * (line_len + len), 256);
+        if (!ASS_REALLOC_ARRAY(parser_priv->line, new_size))
+            return false;
+        parser_priv->line_size = new_size;
+    }
+    memcpy(parser_priv->line + line_len, data, len);
+    parser_priv->line_len = line_len + len;
+    parser_priv->line[parser_priv->line_len] = '\0';
+    return true;
+}
+
+static void process_buffered_line(ASS_Track *track)
+{
+    ASS_ParserPriv *parser_priv = track->parser_priv;
+    char *str = parser_priv->line;
+    if (!strncmp(str, "\xef\xbb\xbf", 3))
+        str += 3;               // U+FFFE (BOM)
+    if (*str)
+        process_line(track, str);
+    parser_priv->line_len = 0;
+}
+
+int ass_track_feed(ASS_Track *track, const char *data, size_t size)
+{
+    ASS_ParserPriv *parser_priv = track->parser_priv;
+    const char *end = data + size;
+    while (data < end) {
+        const char *eol = data;
+        while (eol < end && *eol != '\r' && *eol != '\n')
+            eol++;
+        if (!append_line(parser_priv, data, eol - data))
+            return -1;
+        if (eol == end)
+            break;
+        // empty lines, including the second half of CR LF, are skipped
+        if (parser_priv->line_len)
+            process_buffered_line(track);
+        data = eol + 1;
+    }
+    return 0;
+}
+
+int ass_track_feed_end(ASS_Track *track)
+{
+    ASS_ParserPriv *parser_priv = track->parser_priv;
+    if (parser_priv->line_len)
+        process_buffered_line(track);
+    free(parser_priv->line);
+    parser_priv->line = NULL;
+    parser_priv->line_size = 0;
+
+    // there is no explicit end-of-font marker in ssa/ass
+    if (parser_priv->fontname)
+        finish_font(track);
+
+    // external SSA/ASS subs does not have ReadOrder field
+    for (int i = 0; i < track->n_events; ++i)
+        track->events[i].ReadOrder = i;
+
+    if (track->track_type == TRACK_TYPE_UNKNOWN)
+        return -1;
+
+    ass_process_force_style(track);
+    return 0;
+}
+
 /**
  * \brief Process CodecPrivate section of subtitle stream
  * \param track track
@@ -1376,6 +1444,11 @@ void ass_flush_events(ASS_Track *track)
     track->parser_priv->read_order_elems = 0;
 }
 
+void ass_track_changed(ASS_Track *track)
+{
+    track->parser_priv->generation++;
+}
+
 void ass_configure_prune(ASS_Track *track, long long delay)
 {
     track->parser_priv->prune_delay = delay;
@@ -1554,33 +1627,131 @@ char *ass_load_file(ASS_Library *library, const char *fname, FileNameSource hint
     return buf;
 }
 
-/*
- * \param buf pointer to subtitle text in utf-8
- */
-static ASS_Track *parse_memory(ASS_Library *library, char *buf)
-{
-    ASS_Track *track;
-    int i;
+#define READ_CHUNK_SIZE (64 * 1024)
 
-    track = ass_new_track(library);
-    if (!track)
-        return NULL;
+#ifdef CONFIG_ICONV
+static iconv_t open_recoder(ASS_Library *library, const char *codepage)
+{
+    iconv_t icdsc = iconv_open("UTF-8", codepage);
+    if (icdsc != (iconv_t) (-1))
+        ass_msg(library, MSGL_V, "Opened iconv descriptor");
+    else
+        ass_msg(library, MSGL_ERR, "Error opening iconv descriptor");
+    return icdsc;
+}
 
-    // process header
-    process_text(track, buf);
+static void close_recoder(ASS_Library *library, iconv_t icdsc)
+{
+    if (icdsc != (iconv_t) (-1)) {
+        (void) iconv_close(icdsc);
+        ass_msg(library, MSGL_V, "Closed iconv descriptor");
+    }
+}
 
-    // external SSA/ASS subs does not have ReadOrder field
-    for (i = 0; i < track->n_events; ++i)
-        track->events[i].ReadOrder = i;
+/**
+ * \brief Recode data to UTF-8 and feed it to the track piece by piece
+ * \param size in: length of data, out: length of an incomplete character
+ * at its end, which must be passed again along with the following data
+ * \param last whether this is the end of the data
+ */
+static bool feed_recoded(ASS_Track *track, iconv_t icdsc,
+                         char *data, size_t *size, bool last)
+{
+    char outbuf[4096];
+    char *ip = data;
+    size_t ileft = *size;
+    while (ileft || last) {
+        char *op = outbuf;
+        size_t oleft = sizeof(outbuf);
+        bool clear = !ileft;    // clear the conversion state and leave
+        size_t rc = clear ? iconv(icdsc, NULL, NULL, &op, &oleft)
+                          : iconv(icdsc, &ip, &ileft, &op, &oleft);
+        int err = errno;
+        if (ass_track_feed(track, outbuf, op - outbuf) < 0)
+            return false;
+        if (rc == (size_t) (-1)) {
+            if (err == E2BIG)
+                continue;
+            if (err == EINVAL && !last)
+                break;
+            ass_msg(track->library, MSGL_WARN, "Error recoding file");
+            return false;
+        }
+        if (clear)
+            break;
+    }
+    *size = ileft;
+    return true;
+}
+#endif
 
-    if (track->track_type == TRACK_TYPE_UNKNOWN) {
-        ass_free_track(track);
-        return 0;
+/**
+ * \brief Feed a complete buffer to the track, recoding it if needed
+ */
+static bool feed_buffer(ASS_Track *track, char *buf, size_t bufsize,
+                        const char *codepage)
+{
+#ifdef CONFIG_ICONV
+    if (codepage) {
+        iconv_t icdsc = open_recoder(track->library, codepage);
+        bool ok = icdsc != (iconv_t) (-1) &&
+                  feed_recoded(track, icdsc, buf, &bufsize, true);
+        close_recoder(track->library, icdsc);
+        return ok;
     }
+#endif
+    return ass_track_feed(track, buf, bufsize) >= 0;
+}
 
-    ass_process_force_style(track);
+/**
+ * \brief Read a file in chunks and feed them to the track
+ */
+static bool feed_stream(ASS_Track *track, FILE *fp, const char *codepage)
+{
+    ASS_Library *library = track->library;
+    char *buf = malloc(READ_CHUNK_SIZE);
+    if (!buf)
+        return false;
 
-    return track;
+#ifdef CONFIG_ICONV
+    iconv_t icdsc = (iconv_t) (-1);
+    if (codepage) {
+        icdsc = open_recoder(library, codepage);
+        if (icdsc == (iconv_t) (-1)) {
+            free(buf);
+            return false;
+        }
+    }
+#endif
+
+    bool ok = true;
+    size_t left = 0;    // incomplete character kept from the last chunk
+    while (ok) {
+        size_t size = fread(buf + left, 1, READ_CHUNK_SIZE - left, fp);
+        if (ferror(fp)) {
+            ass_msg(library, MSGL_INFO, "Read failed, %d: %s", errno,
+                    strerror(errno));
+            ok = false;
+            break;
+        }
+        bool last = feof(fp);
+#ifdef CONFIG_ICONV
+        if (icdsc != (iconv_t) (-1)) {
+            size += left;
+            left = size;
+            ok = feed_recoded(track, icdsc, buf, &left, last);
+            memmove(buf, buf + size - left, left);
+        } else
+#endif
+            ok = ass_track_feed(track, buf, size) >= 0;
+        if (last)
+            break;
+    }
+#ifdef CONFIG_ICONV
+    close_recoder(library, icdsc);
+#endif
+    free(buf);
+    return ok;
 }
 
 /**
@@ -1594,64 +1765,29 @@ static ASS_Track *parse_memory(ASS_Library *library, char *buf)
 ASS_Track *ass_read_memory(ASS_Library *library, char *buf,
                            size_t bufsize, const char *codepage)
 {
-    ASS_Track *track;
-    int copied = 0;
-
     if (!buf)
         return 0;
 
-#ifdef CONFIG_ICONV
-    if (codepage) {
-        buf = sub_recode(library, buf, bufsize, codepage);
-        if (!buf)
-            return 0;
-        else
-            copied = 1;
-    }
-#endif
-    if (!copied) {
-        char *newbuf = malloc(bufsize + 1);
-        if (!newbuf)
-            return 0;
-        memcpy(newbuf, buf, bufsize);
-        newbuf[bufsize] = '\0';
-        buf = newbuf;
-    }
-    track = parse_memory(library, buf);
-    free(buf);
+    ASS_Track *track = ass_new_track(library);
     if (!track)
         return 0;
 
+    if (!feed_buffer(track, buf, bufsize, codepage) ||
+            ass_track_feed_end(track) < 0) {
+        ass_free_track(track);
+        return 0;
+    }
+
     ass_msg(library, MSGL_INFO, "Added subtitle file: "
             "<memory> (%d styles, %d events)",
             track->n_styles, track->n_events);
     return track;
 }
 
-static char *read_file_recode(ASS_Library *library, const char *fname,
-                              const char *codepage, size_t *size)
-{
-    char *buf;
-    size_t bufsize;
-
-    buf = ass_load_file(library, fname, FN_EXTERNAL, &bufsize);
-    if (!buf)
-        return 0;
-#ifdef CONFIG_ICONV
-    if (codepage) {
-        char *tmpbuf = sub_recode(library, buf, bufsize, codepage);
-        free(buf);
-        buf = tmpbuf;
-    }
-    if (!buf)
-        return 0;
-#endif
-    *size = bufsize;
-    return buf;
-}
-
 /**
  * \brief Read subtitles from file.
+ * The file is mapped into memory where possible, and read and parsed
+ * in chunks otherwise, so it never has to be copied as a whole.
  * \param library libass library object
  * \param fname file name
  * \param codepage recode buffer contents from given codepage
@@ -1660,17 +1796,34 @@ static char *read_file_recode(ASS_Library *library, const char *fname,
 ASS_Track *ass_read_file(ASS_Library *library, const char *fname,
                          const char *codepage)
 {
-    char *buf;
-    ASS_Track *track;
-    size_t bufsize;
+    FILE *fp = ass_open_file(fname, FN_EXTERNAL);
+    if (!fp) {
+        ass_msg(library, MSGL_WARN,
+                "ass_read_file(%s): fopen failed", fname);
+        return 0;
+    }
 
-    buf = read_file_recode(library, fname, codepage, &bufsize);
-    if (!buf)
+    ASS_Track *track = ass_new_track(library);
+    if (!track) {
+        fclose(fp);
         return 0;
-    track = parse_memory(library, buf);
-    free(buf);
-    if (!track)
+    }
+
+    bool ok;
+    size_t size;
+    char *data = ass_map_file(fp, &size);
+    if (data) {
+        ass_msg(library, MSGL_V, "File size: %zu", size);
+        ok = feed_buffer(track, data, size, codepage);
+        ass_unmap_file(data, size);
+    } else
+        ok = feed_stream(track, fp, codepage);
+    fclose(fp);
+
+    if (!ok || ass_track_feed_end(track) < 0) {
+        ass_free_track(track);
         return 0;
+    }
 
     track->name = strdup(fname);
 
@@ -1713,9 +1866,244 @@ int ass_read_styles(ASS_Track *track, const char *fname, const char *codepage)
     return 0;
 }
 
+// Minimum number of events added since the last update
+// before they are merged into the event index
+#define EVENT_INDEX_MIN_PENDING 64
+
+static inline long long event_end(const ASS_Event *event)
+{
+    return event->Start + event->Duration;
+}
+
+static int cmp_event_time(const void *p1, const void *p2)
+{
+    const EventTime *t1 = p1, *t2 = p2;
+    if (t1->time != t2->time)
+        return t1->time < t2->time ? -1 : 1;
+    return t1->id - t2->id;
+}
+
+/**
+ * \brief Merge sorted new entries into the entries of an index
+ * The merge runs from the back, so it never overwrites entries
+ * that haven't been moved yet.
+ */
+static void merge_event_times(EventTime *times, int n_old,
+                              const EventTime *src, int n_new)
+{
+    int i = n_old - 1, j = n_new - 1, k = n_old + n_new - 1;
+    while (j >= 0) {
+        if (i >= 0 && cmp_event_time(&times[i], &src[j]) > 0)
+            times[k--] = times[i--];
+        else
+            times[k--] = src[j--];
+    }
+}
+
+/**
+ * \brief Index the events added since the last update
+ * As that involves sorting the whole index, a small number of new events
+ * is only merged if full is set; until then, they are scanned linearly.
+ * After ass_track_changed, all events are indexed anew.
+ * Modifies the track only if there is something to update, so it's safe
+ * to call while the track is pre-rendered.
+ */
+void ass_update_event_index(ASS_Track *track, bool full)
+{
+    EventIndex *index = &track->parser_priv->event_index;
+    unsigned generation = track->parser_priv->generation;
+    if (track->n_events < index->n_events || index->generation != generation) {
+        index->n_events = 0;
+        index->generation = generation;
+    }
+
+    int n_old = index->n_events, n = track->n_events;
+    int n_new = n - n_old;
+    if (!n_new || (!full && n_new < FFMAX(EVENT_INDEX_MIN_PENDING, n_old / 8)))
+        return;
+
+    if (n > index->max_events) {
+        int max = track->max_events;
+        if (!ASS_REALLOC_ARRAY(index->by_start, max) ||
+                !ASS_REALLOC_ARRAY(index->by_end, max))
+            return;
+        index->max_events = max;
+    }
+    int tree_size = 1;
+    while (tree_size < n)
+        tree_size *= 2;
+    if (tree_size > index->tree_size) {
+        if (!ASS_REALLOC_ARRAY(index->max_end, 2 * (size_t) tree_size))
+            return;
+        index->tree_size = tree_size;
+    }
+
+    EventTime *new_times = ass_realloc_array(NULL, n_new, sizeof(EventTime));
+    if (!new_times)
+        return;
+    for (int i = 0; i < n_new; i++)
+        new_times[i] = (EventTime) { track->events[n_old + i].Start, n_old + i };
+    qsort(new_times, n_new, sizeof(EventTime), cmp_event_time);
+    merge_event_times(index->by_start, n_old, new_times, n_new);
+    for (int i = 0; i < n_new; i++)
+        new_times[i] = (EventTime) { event_end(track->events + n_old + i), n_old + i };
+    qsort(new_times, n_new, sizeof(EventTime), cmp_event_time);
+    merge_event_times(index->by_end, n_old, new_times, n_new);
+    free(new_times);
+    index->n_events = n;
+
+    long long *max_end = index->max_end;
+    tree_size = index->tree_size;
+    for (int i = 0; i < tree_size; i++)
+        max_end[tree_size + i] = i < n ?
+            event_end(track->events + index->by_start[i].id) : LLONG_MIN;
+    for (int i = tree_size - 1; i > 0; i--)
+        max_end[i] = FFMAX(max_end[2 * i], max_end[2 * i + 1]);
+}
+
+/**
+ * \brief Count the entries before a time
+ * \param inclusive whether to count entries at the time itself
+ */
+static int count_event_times(const EventTime *times, int n,
+                             long long time, bool inclusive)
+{
+    int lo = 0, hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (times[mid].time < time || (inclusive && times[mid].time == time))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static bool push_event_id(int **ids, int *n, int *max_ids, int id)
+{
+    if (*n >= *max_ids) {
+        int max = FFMAX(2 * *max_ids, 64);
+        if (!ASS_REALLOC_ARRAY(*ids, max))
+            return false;
+        *max_ids = max;
+    }
+    (*ids)[(*n)++] = id;
+    return true;
+}
+
+/**
+ * \brief Collect the events of a max_end subtree that are still active
+ * \param pos position in by_start of the first leaf of the subtree
+ * \param limit number of events started by now
+ */
+static bool collect_active_events(const EventIndex *index, int node,
+                                  int pos, int size, int limit, long long now,
+                                  int **ids, int *n, int *max_ids)
+{
+    if (pos >= limit || index->max_end[node] <= now)
+        return true;
+    if (size == 1)
+        return push_event_id(ids, n, max_ids, index->by_start[pos].id);
+    size /= 2;
+    return collect_active_events(index, 2 * node, pos, size,
+                                 limit, now, ids, n, max_ids) &&
+           collect_active_events(index, 2 * node + 1, pos + size, size,
+                                 limit, now, ids, n, max_ids);
+}
+
+static int cmp_event_id(const void *p1, const void *p2)
+{
+    return *(const int *) p1 - *(const int *) p2;
+}
+
+/**
+ * \brief Find the events active at a timestamp
+ * \param ids buffer for the ids of the events, in track order;
+ * reallocated as needed
+ * \param max_ids allocated size of ids
+ * \return number of events found, or -1 on allocation failure
+ */
+int ass_find_active_events(ASS_Track *track, long long now,
+                           int **ids, int *max_ids)
+{
+    const EventIndex *index = &track->parser_priv->event_index;
+    int n = 0;
+    if (index->n_events) {
+        int limit = count_event_times(index->by_start, index->n_events, now, true);
+        if (!collect_active_events(index, 1, 0, index->tree_size, limit, now,
+                                   ids, &n, max_ids))
+            return -1;
+        qsort(*ids, n, sizeof(int), cmp_event_id);
+    }
+    for (int i = index->n_events; i < track->n_events; i++) {
+        ASS_Event *event = track->events + i;
+        if (event->Start <= now && now < event_end(event) &&
+                !push_event_id(ids, &n, max_ids, i))
+            return -1;
+    }
+    return n;
+}
+
+/**
+ * \brief Find the event closest to a timestamp in the given direction
+ * If several events qualify, the same one as in a linear scan
+ * over the track is chosen.
+ * \param direction < 0: latest end before target;
+ * > 0: earliest start after target; 0: latest start before target
+ */
+static ASS_Event *find_closest_event(ASS_Track *track, long long target,
+                                     int direction, long long *time)
+{
+    const EventIndex *index = &track->parser_priv->event_index;
+    ASS_Event *closest = NULL;
+    int n = index->n_events;
+    if (direction < 0) {
+        int pos = count_event_times(index->by_end, n, target, false);
+        if (pos) {
+            // first of the events ending at the same time
+            *time = index->by_end[pos - 1].time;
+            pos = count_event_times(index->by_end, pos, *time, false);
+            closest = track->events + index->by_end[pos].id;
+        }
+    } else if (direction > 0) {
+        int pos = count_event_times(index->by_start, n, target, true);
+        if (pos < n) {
+            closest = track->events + index->by_start[pos].id;
+            *time = closest->Start;
+        }
+    } else {
+        int pos = count_event_times(index->by_start, n, target, false);
+        if (pos) {
+            closest = track->events + index->by_start[pos - 1].id;
+            *time = closest->Start;
+        }
+    }
+
+    for (int i = n; i < track->n_events; i++) {
+        ASS_Event *event = track->events + i;
+        if (direction < 0) {
+            long long end = event_end(event);
+            if (end < target && (!closest || end > *time)) {
+                closest = event;
+                *time = end;
+            }
+        } else if (direction > 0) {
+            if (event->Start > target && (!closest || event->Start < *time)) {
+                closest = event;
+                *time = event->Start;
+            }
+        } else {
+            if (event->Start < target && (!closest || event->Start >= *time)) {
+                closest = event;
+                *time = event->Start;
+            }
+        }
+    }
+    return closest;
+}
+
 long long ass_step_sub(ASS_Track *track, long long now, int movement)
 {
-    int i;
     ASS_Event *best = NULL;
     long long target = now;
     int direction = (movement > 0 ? 1 : -1) * !!movement;
@@ -1723,37 +2111,11 @@ long long ass_step_sub(ASS_Track *track, long long now, int movement)
     if (track->n_events == 0)
         return 0;
 
+    ass_update_event_index(track, false);
     do {
-        ASS_Event *closest = NULL;
         long long closest_time = now;
-        for (i = 0; i < track->n_events; i++) {
-            if (direction < 0) {
-                long long end =
-                    track->events[i].Start + track->events[i].Duration;
-                if (end < target) {
-                    if (!closest || end > closest_time) {
-                        closest = &track->events[i];
-                        closest_time = end;
-                    }
-                }
-            } else if (direction > 0) {
-                long long start = track->events[i].Start;
-                if (start > target) {
-                    if (!closest || start < closest_time) {
-                        closest = &track->events[i];
-                        closest_time = start;
-                    }
-                }
-            } else {
-                long long start = track->events[i].Start;
-                if (start < target) {
-                    if (!closest || start >= closest_time) {
-                        closest = &track->events[i];
-                        closest_time = start;
-                    }
-                }
-            }
-        }
+        ASS_Event *closest =
+            find_closest_event(track, target, direction, &closest_time);
         target = closest_time + direction;
         movement -= direction;
         if (closest)
@@ -1784,6 +2146,10 @@ ASS_Track *ass_new_track(ASS_Library *library)
     track->parser_priv->check_readorder = 1;
     track->parser_priv->prune_delay = -1;
     track->parser_priv->prune_next_ts = LLONG_MAX;
+#if CONFIG_THREADS
+    if (!ass_mutex_init(&track->parser_priv->render_lock))
+        goto fail;
+#endif
     return track;
 
 fail:
@@ -1798,6 +2164,77 @@ fail:
     return NULL;
 }
 
+static bool copy_string(char **str)
+{
+    return !*str || (*str = strdup(*str));
+}
+
+/**
+ * \brief Copy the header, the styles and some of the events of a track
+ * The copy shares nothing with the original, so both can be used
+ * on different threads.
+ * \param ids ids of the events to copy, in ascending order
+ * \return the copy or NULL on allocation failure
+ */
+ASS_Track *ass_copy_track_events(ASS_Track *track, const int *ids, int n_ids)
+{
+    ASS_Track *copy = ass_new_track(track->library);
+    if (!copy)
+        return NULL;
+
+    copy->track_type = track->track_type;
+    copy->PlayResX = track->PlayResX;
+    copy->PlayResY = track->PlayResY;
+    copy->Timer = track->Timer;
+    copy->WrapStyle = track->WrapStyle;
+    copy->ScaledBorderAndShadow = track->ScaledBorderAndShadow;
+    copy->Kerning = track->Kerning;
+    copy->Language = track->Language;
+    copy->YCbCrMatrix = track->YCbCrMatrix;
+    copy->LayoutResX = track->LayoutResX;
+    copy->LayoutResY = track->LayoutResY;
+    copy->parser_priv->header_flags = track->parser_priv->header_flags;
+    copy->parser_priv->feature_flags = track->parser_priv->feature_flags;
+    if (!copy_string(&copy->Language))
+        goto fail;
+
+    // replace the default style
+    ass_free_style(copy, 0);
+    copy->n_styles = 0;
+    for (int i = 0; i < track->n_styles; i++) {
+        int sid = ass_alloc_style(copy);
+        if (sid < 0)
+            goto fail;
+        ASS_Style *style = copy->styles + sid;
+        *style = track->styles[i];
+        bool ok = copy_string(&style->Name);
+        ok &= copy_string(&style->FontName);
+        if (!ok)
+            goto fail;
+    }
+    copy->default_style = track->default_style;
+
+    for (int i = 0; i < n_ids; i++) {
+        int eid = ass_alloc_event(copy);
+        if (eid < 0)
+            goto fail;
+        ASS_Event *event = copy->events + eid;
+        *event = track->events[ids[i]];
+        event->render_priv = NULL;
+        bool ok = copy_string(&event->Name);
+        ok &= copy_string(&event->Effect);
+        ok &= copy_string(&event->Text);
+        if (!ok)
+            goto fail;
+    }
+    ass_update_event_index(copy, true);
+    return copy;
+
+fail:
+    ass_free_track(copy);
+    return NULL;
+}
+
 int ass_track_set_feature(ASS_Track *track, ASS_Feature feature, int enable)
 {
     if (feature >= sizeof(track->parser_priv->feature_flags) * CHAR_BIT || feature < 0)
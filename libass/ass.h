@@ -24,7 +24,7 @@
 #include <stdarg.h>
 #include "ass_types.h"
 
-#define LIBASS_VERSION 0x01704000
+#define LIBASS_VERSION 0x017040c0
 
 #ifdef __cplusplus
 extern "C" {
@@ -85,6 +85,130 @@ typedef struct ass_image {
     // New fields can be added here in new ABI-compatible library releases.
 } ASS_Image;
 
+/*
+ * A rectangular region of the video frame, see ass_get_damage_rects.
+ * Covers the pixels with x0 <= x < x1 and y0 <= y < y1.
+ */
+typedef struct ass_damage_rect {
+    int x0, y0;
+    int x1, y1;
+} ASS_DamageRect;
+
+/*
+ * Pixel formats of frames for ass_blend_frame.
+ * All formats use 4 bytes per pixel with premultiplied alpha.
+ */
+typedef enum {
+    ASS_FRAME_RGBA,             // bytes in order R, G, B, A
+    ASS_FRAME_BGRA,             // bytes in order B, G, R, A
+} ASS_FrameFormat;
+
+/*
+ * Planar and semi-planar YUV formats with 4:2:0 chroma subsampling
+ * for ass_blend_frame_yuv.
+ */
+typedef enum {
+    ASS_YUV_I420,               // 8-bit planes Y, U and V
+    ASS_YUV_NV12,               // 8-bit planes Y and interleaved UV
+    ASS_YUV_P010,               // like NV12 with 16-bit samples in native
+                                // byte order, data in the upper 10 bits
+} ASS_YUVFormat;
+
+/*
+ * A page of the glyph atlas, see ass_set_atlas.
+ */
+typedef struct ass_atlas_page {
+    int w, h;                   // page width/height
+    int stride;                 // bitmap stride
+    unsigned char *bitmap;      // 1-byte-per-pixel alpha buffer
+    ASS_DamageRect dirty;       // region changed by the last frame,
+                                // empty if x0 >= x1
+} ASS_AtlasPage;
+
+/*
+ * Location of an ASS_Image's bitmap in the glyph atlas, see ass_set_atlas.
+ */
+typedef struct ass_atlas_image {
+    int page;                   // index of the atlas page, or -1 if the
+                                // image is not in the atlas
+    int x, y;                   // position of the bitmap within the page
+} ASS_AtlasImage;
+
+/*
+ * Eviction policies of the renderer's caches, see ass_set_cache_policy.
+ */
+typedef enum {
+    ASS_CACHE_LRU,              // evict the least recently used items
+    ASS_CACHE_CLOCK,            // evict items not used since the last
+                                // eviction pass (CLOCK/second chance)
+} ASS_CachePolicy;
+
+/*
+ * Usage statistics of one of the renderer's caches, see ass_get_render_stats.
+ * The counters accumulate from the creation of the cache; for caches shared
+ * between renderers (see ass_renderer_init_shared) they cover all of them.
+ */
+typedef struct ass_cache_stats {
+    unsigned long long hits;        // lookups that found a cached item
+    unsigned long long misses;      // lookups that had to create the item
+    unsigned long long evictions;   // items dropped to stay within the limits
+    size_t items;                   // number of items currently cached
+    size_t size;                    // current cache size, in bytes for the
+                                    // bitmap and composite caches and
+                                    // in items for all other caches
+} ASS_CacheStats;
+
+/*
+ * Usage statistics of the pool bitmap buffers are allocated from,
+ * see ass_get_bitmap_pool_stats. Buffers freed by the caches are kept for
+ * reuse up to a fraction of the cache limits (see ass_set_cache_limits).
+ * Like the caches, the pool is shared between renderers created with
+ * ass_renderer_init_shared. Sizes are in bytes.
+ */
+typedef struct ass_bitmap_pool_stats {
+    unsigned long long allocs;      // buffers allocated
+    unsigned long long reuses;      // allocations served by a freed buffer
+    size_t used;                    // size of the buffers in use
+    size_t cached;                  // size of the freed buffers kept
+} ASS_BitmapPoolStats;
+
+/*
+ * Statistics of the last frame rendered by ass_render_frame,
+ * see ass_get_render_stats. All times are in milliseconds. The times of
+ * the stages are summed over all rendering threads (see ass_set_threads),
+ * so their total may exceed frame_time. Work done for cache hits is
+ * skipped and thus does not appear in any of the stages.
+ *
+ * The caller sets size to sizeof(ASS_RenderStats) before calling
+ * ass_get_render_stats, which doesn't write beyond it. New members are
+ * only ever added at the end, so that programs built against an older
+ * version of this header keep working.
+ */
+typedef struct ass_render_stats {
+    size_t size;                // of the struct, set by the caller
+    double frame_time;          // wall-clock time of the whole frame
+    double parse_time;          // parsing of override tags
+    double shape_time;          // text shaping
+    double outline_time;        // loading glyphs, parsing drawings, stroking
+    double rasterize_time;      // rasterization of outlines
+    double blur_time;           // \blur and \be
+    double composite_time;      // combining glyph bitmaps, except blur
+    double collision_time;      // resolving collisions between events
+    int n_events;               // number of events rendered
+
+    ASS_CacheStats font_cache;
+    ASS_CacheStats outline_cache;
+    ASS_CacheStats bitmap_cache;
+    ASS_CacheStats composite_cache;
+    ASS_CacheStats face_size_metrics_cache;
+    ASS_CacheStats metrics_cache;
+
+    size_t scratch_size;        // temporary memory used for filters by all
+                                // rendering threads, in bytes, as of the end
+                                // of rendering; it is kept for later frames
+                                // until ass_set_cache_limits frees it
+} ASS_RenderStats;
+
 /*
  * Hinting type. (see ass_set_hinting below)
  *
@@ -317,6 +441,23 @@ void ass_library_done(ASS_Library *priv);
  */
 void ass_set_fonts_dir(ASS_Library *priv, const char *fonts_dir);
 
+/**
+ * \brief Set a file to cache font metadata in.
+ * Finding out the names and styles of fonts from fonts_dir and embedded
+ * fonts requires reading every font. If an index file is set, this
+ * information is stored in it and reused by later renderers and processes,
+ * so fonts that are already known don't have to be read at startup.
+ * Fonts from fonts_dir are recognized by their path, size and modification
+ * time, and other fonts by their contents.
+ * The file is created if it doesn't exist. It is replaced as a whole when
+ * new fonts are added, so it can be shared by concurrent processes.
+ * Filenames are handled like fonts_dir, see ass_set_fonts_dir.
+ *
+ * \param priv library handle
+ * \param path index file, or NULL to disable the index (default)
+ */
+void ass_set_font_index_file(ASS_Library *priv, const char *path);
+
 /**
  * \brief Whether fonts should be extracted from track data.
  * \param priv library handle
@@ -376,6 +517,29 @@ void ass_set_message_cb(ASS_Library *priv, void (*msg_cb)
  */
 ASS_Renderer *ass_renderer_init(ASS_Library *);
 
+/**
+ * \brief Initialize a renderer sharing fonts and caches with another one.
+ * All renderers created this way from the same original renderer form a
+ * group that uses a single font selection and a single set of glyph, outline,
+ * metrics, bitmap and composite caches. This avoids repeating the same work,
+ * e.g. when rendering one track for several outputs of different sizes.
+ * Other settings, like frame size or hinting, are independent per renderer
+ * and start at their defaults.
+ *
+ * Renderers of a group may render concurrently on different threads.
+ * Frames of the same track are still rendered one at a time, as collision
+ * handling keeps its state in the track's events: ass_render_frame() waits
+ * while another renderer is rendering the same track.
+ * ass_set_fonts() and ass_set_cache_limits() apply to the whole group;
+ * ass_set_fonts() must not be called while any renderer of the group
+ * is rendering. The group's resources are released together with its
+ * last renderer, regardless of creation order.
+ *
+ * \param source renderer to share fonts and caches with
+ * \return renderer handle or NULL if failed
+ */
+ASS_Renderer *ass_renderer_init_shared(ASS_Renderer *source);
+
 /**
  * \brief Finalize the renderer.
  * \param priv renderer handle
@@ -598,6 +762,9 @@ int ass_fonts_update(ASS_Renderer *priv);
 /**
  * \brief Set hard cache limits.  Do not set, or set to zero, for reasonable
  * defaults.
+ * If caches are shared with other renderers (see ass_renderer_init_shared),
+ * the limits apply to all of them together.
+ * Also frees the temporary filter memory of this renderer's threads.
  *
  * \param priv renderer handle
  * \param glyph_max maximum number of cached glyphs
@@ -606,6 +773,103 @@ int ass_fonts_update(ASS_Renderer *priv);
 void ass_set_cache_limits(ASS_Renderer *priv, int glyph_max,
                           int bitmap_max_size);
 
+/**
+ * \brief Set the policy that decides which items are evicted from the caches
+ * when they exceed the limits set with ass_set_cache_limits.
+ * ASS_CACHE_LRU keeps items in exact order of use, which requires reordering
+ * the items on every cache hit. ASS_CACHE_CLOCK only marks items on hits and
+ * approximates LRU, which is cheaper for large caches with many hits.
+ * If caches are shared with other renderers (see ass_renderer_init_shared),
+ * the policy applies to all of them.
+ * Default: ASS_CACHE_LRU.
+ *
+ * \param priv renderer handle
+ * \param policy eviction policy
+ */
+void ass_set_cache_policy(ASS_Renderer *priv, ASS_CachePolicy policy);
+
+/**
+ * \brief Set the number of threads used to render a frame.
+ * Events active at the same time are then rendered in parallel;
+ * the output of ass_render_frame is identical to single-threaded rendering.
+ * Font selection and shaping are still serialized, so the gain is largest
+ * for events with heavy blur, borders or large drawings.
+ * The calling thread of ass_render_frame counts as one of the threads.
+ * While rendering with more than one thread, the message callback
+ * may be invoked concurrently from several threads.
+ * Must not be called while ass_render_frame is running.
+ * Default: 1 (no additional threads).
+ *
+ * \param priv renderer handle
+ * \param threads total number of threads; values below 2 disable threading
+ * \return number of threads actually used; may be lower than requested,
+ * in particular 1 if libass was built without thread support
+ */
+int ass_set_threads(ASS_Renderer *priv, int threads);
+
+/**
+ * \brief Enable or disable measuring the time spent in each rendering stage.
+ * Timing adds a small overhead to every frame, so it is disabled by default.
+ * Cache statistics are always collected.
+ *
+ * \param priv renderer handle
+ * \param enable whether to measure times
+ */
+void ass_set_render_stats_enabled(ASS_Renderer *priv, int enable);
+
+/**
+ * \brief Get statistics about the last frame rendered by ass_render_frame
+ * and the current state of the caches.
+ * Times are zero unless enabled with ass_set_render_stats_enabled
+ * before rendering the frame.
+ *
+ * \param priv renderer handle
+ * \param stats the statistics are written here; its size member
+ * must be set to sizeof(ASS_RenderStats)
+ */
+void ass_get_render_stats(ASS_Renderer *priv, ASS_RenderStats *stats);
+
+/**
+ * \brief Get statistics about the allocation of bitmap buffers.
+ *
+ * \param priv renderer handle
+ * \param stats the statistics are written here
+ */
+void ass_get_bitmap_pool_stats(ASS_Renderer *priv, ASS_BitmapPoolStats *stats);
+
+/**
+ * \brief Pre-render frames in the background to warm up the caches.
+ * The frames are rendered on a separate thread, in the given order, using
+ * the renderer's current settings. The resulting glyphs and bitmaps are
+ * kept in the caches, so that a later ass_render_frame call for the same
+ * timestamp mostly consists of cache lookups. The cache limits set with
+ * ass_set_cache_limits apply, so pre-rendering too far ahead is useless.
+ * Timestamps queued by earlier calls and not yet started are discarded.
+ *
+ * The styles and the events active at the given timestamps are copied
+ * before returning, so the track may be modified, rendered or freed while
+ * the frames are pre-rendered. Changes made afterwards are not taken into
+ * account by the queued frames.
+ *
+ * \param priv renderer handle
+ * \param track subtitle track
+ * \param times timestamps of the frames to pre-render (ms)
+ * \param n number of timestamps
+ * \return number of timestamps queued; 0 on failure or
+ * if libass was built without thread support
+ */
+int ass_prerender_frames(ASS_Renderer *priv, ASS_Track *track,
+                         const long long *times, int n);
+
+/**
+ * \brief Discard pre-rendering requests queued with ass_prerender_frames.
+ * Waits for the frame currently being pre-rendered, if any, to finish,
+ * and releases the copy of the events made for them.
+ *
+ * \param priv renderer handle
+ */
+void ass_prerender_cancel(ASS_Renderer *priv);
+
 /**
  * \brief Render a frame, producing a list of ASS_Image.
  * \param priv renderer handle
@@ -617,6 +881,102 @@ void ass_set_cache_limits(ASS_Renderer *priv, int glyph_max,
 ASS_Image *ass_render_frame(ASS_Renderer *priv, ASS_Track *track,
                             long long now, int *detect_change);
 
+/**
+ * \brief Enable or disable the glyph atlas.
+ * With the atlas enabled, ass_render_frame additionally copies the bitmaps
+ * of all images into a small number of atlas pages, so that a GPU
+ * compositor can upload them as a few textures instead of one per image.
+ * Bitmaps stay at the same place in the atlas as long as they are used
+ * by consecutive frames, so only the dirty region of each page needs to be
+ * uploaded again. The space of bitmaps the last frame didn't use is reused
+ * for new ones; only when the pages are still full, the atlas is cleared
+ * and repacked from scratch. Use ass_get_atlas after each frame.
+ * The images returned by ass_render_frame keep their own bitmaps, too.
+ * Default: disabled.
+ *
+ * \param priv renderer handle
+ * \param page_size width and height of a page in pixels (at most 16384),
+ * or 0 to disable the atlas
+ * \param max_pages maximum number of pages
+ * \return 1 on success, 0 on failure or if disabled
+ */
+int ass_set_atlas(ASS_Renderer *priv, int page_size, int max_pages);
+
+/**
+ * \brief Get the glyph atlas of the last frame.
+ * The returned arrays are valid until the next call to ass_render_frame,
+ * ass_set_atlas or ass_renderer_done.
+ *
+ * \param priv renderer handle
+ * \param pages set to the array of atlas pages
+ * \param images set to an array with an element for every image returned
+ * by the last ass_render_frame call, in the same order; images that don't
+ * fit into a page have page set to -1 and must be drawn from their own bitmap
+ * \return number of pages; 0 if the atlas is disabled or failed,
+ * then both arrays are set to NULL
+ */
+int ass_get_atlas(ASS_Renderer *priv, const ASS_AtlasPage **pages,
+                  const ASS_AtlasImage **images);
+
+/**
+ * \brief Get the regions that changed in the last frame.
+ * Returns rectangles covering all images of the previous and the last frame
+ * rendered by ass_render_frame that differ between the two, so that only
+ * these regions need to be updated. Outside of them, the frames are
+ * identical. Rectangles that would exceed max_rects are merged.
+ * Damage is computed along with detect_change; if the last ass_render_frame
+ * call was passed a NULL detect_change, the whole frame is reported.
+ *
+ * \param priv renderer handle
+ * \param rects array of at least max_rects elements to write the regions to
+ * \param max_rects maximum number of rectangles to return
+ * \return number of rectangles written, 0 if nothing changed
+ */
+int ass_get_damage_rects(ASS_Renderer *priv, ASS_DamageRect *rects,
+                         int max_rects);
+
+/**
+ * \brief Blend images onto a frame.
+ * Draws a list of images as returned by ass_render_frame over the frame
+ * using SIMD code where available. The frame must use premultiplied alpha;
+ * for fully opaque frames, this is the same as straight alpha.
+ * Parts of images outside of the frame are skipped.
+ *
+ * \param images list of images to blend, may be NULL
+ * \param dst pointer to the top left pixel of the frame
+ * \param stride distance between frame rows in bytes, may be negative
+ * \param w frame width in pixels
+ * \param h frame height in pixels
+ * \param format pixel format of the frame
+ */
+void ass_blend_frame(const ASS_Image *images, unsigned char *dst, int stride,
+                     int w, int h, ASS_FrameFormat format);
+
+/**
+ * \brief Blend images onto a YUV frame.
+ * Like ass_blend_frame, but for video frames in YUV formats. Image colors
+ * are converted with the matrix selected by the YCbCr Matrix header of the
+ * track as described at ASS_YCbCrMatrix: if the header is missing or
+ * invalid, BT.601 TV range is used; if it is "None", the matrix of the
+ * frame is used. Chroma planes use the average of the 2x2 block of mask
+ * values they cover.
+ *
+ * \param images list of images to blend, may be NULL
+ * \param planes pointers to the top left sample of each plane;
+ * planes[2] is only used for ASS_YUV_I420
+ * \param strides distance between rows of each plane in bytes
+ * \param w frame width in pixels
+ * \param h frame height in pixels
+ * \param format format of the frame
+ * \param header_matrix YCbCrMatrix field of the track
+ * \param frame_matrix matrix and range of the frame, used with "None";
+ * if not one of the explicit YCBCR_* values, BT.601 TV range is assumed
+ */
+void ass_blend_frame_yuv(const ASS_Image *images, unsigned char *const planes[3],
+                         const int strides[3], int w, int h,
+                         ASS_YUVFormat format, ASS_YCbCrMatrix header_matrix,
+                         ASS_YCbCrMatrix frame_matrix);
+
 
 /*
  * The following functions operate on track objects and do not need
@@ -765,6 +1125,16 @@ void ass_configure_prune(ASS_Track *track, long long delay);
 */
 void ass_flush_events(ASS_Track *track);
 
+/**
+ * \brief Notify the library of manual changes to existing events or styles.
+ * Must be called after modifying fields of track->events or track->styles
+ * in place, e.g. the Start or Duration of an event, before the track is
+ * used by ass_render_frame, ass_prerender_frames or ass_step_sub again.
+ * Appending events or styles doesn't need this.
+ * \param track track
+ */
+void ass_track_changed(ASS_Track *track);
+
 /**
  * \brief Read subtitles from file.
  * \param library library handle
@@ -790,6 +1160,31 @@ ASS_Track *ass_read_file(ASS_Library *library, const char *fname,
 */
 ASS_Track *ass_read_memory(ASS_Library *library, char *buf,
                            size_t bufsize, const char *codepage);
+
+/**
+ * \brief Read subtitles incrementally.
+ * The data can be split into chunks at arbitrary positions. Only the
+ * last incomplete line is kept between calls, so the script never has
+ * to be held in memory as a whole. Embedded fonts are collected as their
+ * lines arrive and kept in their encoded form; they are only decoded
+ * when the font is read. Call ass_track_feed_end after the last chunk.
+ * \param track track, freshly created with ass_new_track
+ * \param data chunk of the script, in UTF-8
+ * \param size length of data
+ * \return 0 on success, negative on memory allocation failure
+ */
+int ass_track_feed(ASS_Track *track, const char *data, size_t size);
+
+/**
+ * \brief Finish reading subtitles with ass_track_feed.
+ * Processes the last line, also without a trailing line break, and
+ * completes the track like ass_read_memory does.
+ * \param track track
+ * \return 0 on success, negative if the data was not a valid script;
+ * the track still has to be freed then
+ */
+int ass_track_feed_end(ASS_Track *track);
+
 /**
  * \brief Read styles from file into already initialized track.
  * \param fname file name
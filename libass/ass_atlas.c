@@ -0,0 +1,454 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+#include "ass_compat.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ass_atlas.h"
+#include "ass_render.h"
+#include "ass_utils.h"
+
+/*
+ * Atlas pages are filled with shelf packing: each page is divided into
+ * horizontal shelves, and bitmaps are placed left to right on the shelf
+ * that fits their height best. Space at the end of a shelf is reclaimed
+ * as soon as its bitmap is dropped, the rest once the whole shelf is empty.
+ * Only when no page has room left, the whole atlas is cleared and the
+ * current frame is packed from scratch.
+ *
+ * Bitmaps that come from the composite cache are identified by their
+ * address. The atlas keeps a reference to the cache value while it holds
+ * a copy, so the address can't be reused for other contents, and such
+ * bitmaps are only copied once as long as consecutive frames use them.
+ * Bitmaps not used by a frame are dropped, so no references are held
+ * beyond the images of the last frame.
+ *
+ * All other bitmaps can't be recognized again. They go to transient
+ * shelves, which are emptied at the start of every frame.
+ */
+
+#define ATLAS_PADDING 1         // empty pixels between bitmaps
+#define ATLAS_SHELF_ALIGN 4
+
+typedef struct {
+    int y, h;                   // vertical extent
+    int x;                      // start of the free space
+    int n_used;                 // number of bitmaps on the shelf
+    bool transient;             // holds untracked bitmaps of this frame
+} AtlasShelf;
+
+typedef struct {
+    AtlasShelf *shelves;
+    size_t n_shelves, max_shelves;
+    int free_y;                 // start of the space below all shelves
+} AtlasPageAlloc;
+
+typedef struct {
+    const unsigned char *bitmap;
+    int w, h;
+    CompositeHashValue *source; // referenced as long as the entry exists
+    int page, x, y;
+    int shelf;                  // index in the page's shelves
+    bool used;                  // by the current frame
+} AtlasEntry;
+
+struct ass_atlas {
+    int page_size, max_pages;
+
+    int n_pages;
+    ASS_AtlasPage *pages;
+    AtlasPageAlloc *alloc;
+
+    // sorted by cmp_entry up to n_sorted, followed by entries added
+    // in the current frame
+    AtlasEntry *entries;
+    size_t n_entries, n_sorted, max_entries;
+
+    ASS_AtlasImage *images;     // for every image of the last frame
+    size_t max_images;
+    bool valid;                 // whether images matches the last frame
+};
+
+ASS_Atlas *ass_atlas_create(int page_size, int max_pages)
+{
+    if (page_size <= 0 || page_size > 16384 || max_pages <= 0)
+        return NULL;
+
+    ASS_Atlas *atlas = calloc(1, sizeof(ASS_Atlas));
+    if (!atlas)
+        return NULL;
+    atlas->page_size = page_size;
+    atlas->max_pages = max_pages;
+    return atlas;
+}
+
+static void release_entries(ASS_Atlas *atlas)
+{
+    for (size_t i = 0; i < atlas->n_entries; i++)
+        ass_cache_dec_ref(atlas->entries[i].source);
+    atlas->n_entries = atlas->n_sorted = 0;
+}
+
+void ass_atlas_done(ASS_Atlas *atlas)
+{
+    if (!atlas)
+        return;
+
+    release_entries(atlas);
+    for (int i = 0; i < atlas->n_pages; i++) {
+        ass_aligned_free(atlas->pages[i].bitmap);
+        free(atlas->alloc[i].shelves);
+    }
+    free(atlas->pages);
+    free(atlas->alloc);
+    free(atlas->entries);
+    free(atlas->images);
+    free(atlas);
+}
+
+static inline void mark_dirty(ASS_AtlasPage *page, int x0, int y0, int x1, int y1)
+{
+    ASS_DamageRect *r = &page->dirty;
+    if (r->x0 >= r->x1) {
+        *r = (ASS_DamageRect) { x0, y0, x1, y1 };
+        return;
+    }
+    r->x0 = FFMIN(r->x0, x0);
+    r->y0 = FFMIN(r->y0, y0);
+    r->x1 = FFMAX(r->x1, x1);
+    r->y1 = FFMAX(r->y1, y1);
+}
+
+static bool add_page(ASS_Atlas *atlas)
+{
+    int n = atlas->n_pages;
+    if (n >= atlas->max_pages ||
+            !ASS_REALLOC_ARRAY(atlas->pages, n + 1) ||
+            !ASS_REALLOC_ARRAY(atlas->alloc, n + 1))
+        return false;
+
+    int size = atlas->page_size;
+    ASS_AtlasPage *page = &atlas->pages[n];
+    page->bitmap = ass_aligned_alloc(32, (size_t) size * size, true);
+    if (!page->bitmap)
+        return false;
+    page->w = page->h = page->stride = size;
+    page->dirty = (ASS_DamageRect) { 0, 0, size, size };
+    atlas->alloc[n] = (AtlasPageAlloc) { 0 };
+    atlas->n_pages++;
+    return true;
+}
+
+static void release_entry(ASS_Atlas *atlas, const AtlasEntry *entry)
+{
+    AtlasShelf *shelf = &atlas->alloc[entry->page].shelves[entry->shelf];
+    if (entry->x + entry->w + ATLAS_PADDING == shelf->x)
+        shelf->x = entry->x;
+    if (!--shelf->n_used)
+        shelf->x = 0;
+    ass_cache_dec_ref(entry->source);
+}
+
+// empty shelves at the bottom are turned back into free space,
+// so that it can be divided into shelves of other heights
+static void trim_shelves(AtlasPageAlloc *alloc)
+{
+    while (alloc->n_shelves && !alloc->shelves[alloc->n_shelves - 1].n_used)
+        alloc->free_y = alloc->shelves[--alloc->n_shelves].y;
+}
+
+/**
+ * \brief Prepare for a new frame: empty the transient shelves
+ * and mark all entries as unused
+ */
+static void begin_frame(ASS_Atlas *atlas)
+{
+    for (int i = 0; i < atlas->n_pages; i++) {
+        AtlasPageAlloc *alloc = &atlas->alloc[i];
+        for (size_t j = 0; j < alloc->n_shelves; j++) {
+            AtlasShelf *shelf = &alloc->shelves[j];
+            if (shelf->transient)
+                shelf->x = shelf->n_used = 0;
+        }
+    }
+    for (size_t i = 0; i < atlas->n_entries; i++)
+        atlas->entries[i].used = false;
+}
+
+/**
+ * \brief Drop the entries not used by the current frame
+ * Keeps the order of the remaining entries.
+ */
+static void release_unused(ASS_Atlas *atlas)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < atlas->n_entries; i++) {
+        AtlasEntry *entry = &atlas->entries[i];
+        if (entry->used)
+            atlas->entries[n++] = *entry;
+        else
+            release_entry(atlas, entry);
+    }
+    atlas->n_entries = atlas->n_sorted = n;
+    for (int i = 0; i < atlas->n_pages; i++)
+        trim_shelves(&atlas->alloc[i]);
+}
+
+/**
+ * \brief Drop all bitmaps from the atlas
+ */
+static void reset_atlas(ASS_Atlas *atlas)
+{
+    release_entries(atlas);
+    int size = atlas->page_size;
+    for (int i = 0; i < atlas->n_pages; i++) {
+        ASS_AtlasPage *page = &atlas->pages[i];
+        memset(page->bitmap, 0, (size_t) size * size);
+        page->dirty = (ASS_DamageRect) { 0, 0, size, size };
+        atlas->alloc[i].n_shelves = 0;
+        atlas->alloc[i].free_y = 0;
+    }
+}
+
+static bool place_in_page(ASS_Atlas *atlas, AtlasPageAlloc *alloc,
+                          int w, int h, bool transient, AtlasEntry *entry)
+{
+    int size = atlas->page_size;
+    AtlasShelf *best = NULL;
+    for (size_t i = 0; i < alloc->n_shelves; i++) {
+        AtlasShelf *shelf = &alloc->shelves[i];
+        if ((shelf->transient == transient || !shelf->n_used) &&
+                shelf->h >= h && shelf->x + w <= size &&
+                (!best || shelf->h < best->h))
+            best = shelf;
+    }
+
+    // avoid wasting tall shelves on small bitmaps while there is room
+    int shelf_h = FFMIN(ass_align(ATLAS_SHELF_ALIGN, h), size);
+    bool can_add = alloc->free_y + shelf_h <= size;
+    if (!best || (best->h > 2 * h && can_add)) {
+        if (!can_add)
+            return false;
+        if (alloc->n_shelves >= alloc->max_shelves) {
+            size_t max = FFMAX(2 * alloc->max_shelves, 8);
+            if (!ASS_REALLOC_ARRAY(alloc->shelves, max))
+                return false;
+            alloc->max_shelves = max;
+        }
+        best = &alloc->shelves[alloc->n_shelves++];
+        best->y = alloc->free_y;
+        best->h = shelf_h;
+        best->x = 0;
+        best->n_used = 0;
+        alloc->free_y += shelf_h;
+    }
+
+    best->transient = transient;
+    best->n_used++;
+    entry->shelf = best - alloc->shelves;
+    entry->x = best->x;
+    entry->y = best->y;
+    best->x += w;
+    return true;
+}
+
+static bool place(ASS_Atlas *atlas, int w, int h, bool transient,
+                  AtlasEntry *entry)
+{
+    for (int i = 0; i < atlas->n_pages; i++)
+        if (place_in_page(atlas, &atlas->alloc[i], w, h, transient, entry)) {
+            entry->page = i;
+            return true;
+        }
+    if (!add_page(atlas))
+        return false;
+    entry->page = atlas->n_pages - 1;
+    return place_in_page(atlas, &atlas->alloc[entry->page], w, h,
+                         transient, entry);
+}
+
+static int cmp_entry(const void *p1, const void *p2)
+{
+    const AtlasEntry *e1 = p1, *e2 = p2;
+    uintptr_t b1 = (uintptr_t) e1->bitmap, b2 = (uintptr_t) e2->bitmap;
+    if (b1 != b2)
+        return b1 < b2 ? -1 : 1;
+    if (e1->w != e2->w)
+        return e1->w < e2->w ? -1 : 1;
+    if (e1->h != e2->h)
+        return e1->h < e2->h ? -1 : 1;
+    return 0;
+}
+
+static AtlasEntry *find_entry(ASS_Atlas *atlas, const AtlasEntry *key)
+{
+    if (atlas->n_sorted) {
+        AtlasEntry *entry = bsearch(key, atlas->entries, atlas->n_sorted,
+                                    sizeof(AtlasEntry), cmp_entry);
+        if (entry)
+            return entry;
+    }
+    for (size_t i = atlas->n_sorted; i < atlas->n_entries; i++)
+        if (!cmp_entry(key, &atlas->entries[i]))
+            return &atlas->entries[i];
+    return NULL;
+}
+
+static bool reserve_entry(ASS_Atlas *atlas)
+{
+    if (atlas->n_entries < atlas->max_entries)
+        return true;
+    size_t max = FFMAX(2 * atlas->max_entries, 64);
+    if (!ASS_REALLOC_ARRAY(atlas->entries, max))
+        return false;
+    atlas->max_entries = max;
+    return true;
+}
+
+static void set_location(ASS_AtlasImage *out, const AtlasEntry *entry)
+{
+    out->page = entry->page;
+    out->x = entry->x;
+    out->y = entry->y;
+}
+
+/**
+ * \brief Place all images of a frame in the atlas
+ * Bitmaps that are already in the atlas are reused; all others are
+ * copied, and the changed areas are recorded in the pages' dirty rects.
+ * Images that don't fit get page -1.
+ */
+bool ass_atlas_update(ASS_Atlas *atlas, ASS_Image *images)
+{
+    size_t n_images = 0;
+    for (ASS_Image *img = images; img; img = img->next)
+        n_images++;
+    atlas->valid = false;
+    if (n_images > atlas->max_images) {
+        if (!ASS_REALLOC_ARRAY(atlas->images, n_images))
+            return false;
+        atlas->max_images = n_images;
+    }
+
+    for (int i = 0; i < atlas->n_pages; i++)
+        atlas->pages[i].dirty = (ASS_DamageRect) { 0 };
+
+    bool was_reset = false;
+restart:
+    begin_frame(atlas);
+
+    // find the bitmaps kept from the last frame first,
+    // so that the space of all others can be reused
+    ASS_AtlasImage *out = atlas->images;
+    for (ASS_Image *img = images; img; img = img->next, out++) {
+        out->page = -1;
+        out->x = out->y = 0;
+        AtlasEntry key = {
+            .bitmap = img->bitmap,
+            .w = img->w,
+            .h = img->h,
+        };
+        AtlasEntry *entry = ((ASS_ImagePriv *) img)->source ?
+            find_entry(atlas, &key) : NULL;
+        if (entry) {
+            entry->used = true;
+            set_location(out, entry);
+        }
+    }
+    release_unused(atlas);
+
+    out = atlas->images;
+    for (ASS_Image *img = images; img; img = img->next, out++) {
+        int w = img->w + ATLAS_PADDING, h = img->h + ATLAS_PADDING;
+        if (out->page >= 0 || img->w <= 0 || img->h <= 0 ||
+                w > atlas->page_size || h > atlas->page_size)
+            continue;
+
+        AtlasEntry key = {
+            .bitmap = img->bitmap,
+            .w = img->w,
+            .h = img->h,
+            .source = ((ASS_ImagePriv *) img)->source,
+            .used = true,
+        };
+        if (key.source) {
+            // the same bitmap may occur several times in a frame
+            AtlasEntry *entry = find_entry(atlas, &key);
+            if (entry) {
+                set_location(out, entry);
+                continue;
+            }
+        }
+
+        // bitmaps without a cache value are owned by their image
+        // and can't be recognized again, so they aren't tracked
+        bool tracked = key.source && reserve_entry(atlas);
+        if (!place(atlas, w, h, !tracked, &key)) {
+            if (was_reset)
+                continue;
+            // start over with an empty atlas
+            reset_atlas(atlas);
+            was_reset = true;
+            goto restart;
+        }
+
+        // clear the padding, as the space may have been used before
+        ASS_AtlasPage *page = &atlas->pages[key.page];
+        unsigned char *dst = page->bitmap + key.y * page->stride + key.x;
+        const unsigned char *src = img->bitmap;
+        for (int y = 0; y < img->h; y++) {
+            memcpy(dst, src, img->w);
+            memset(dst + img->w, 0, ATLAS_PADDING);
+            dst += page->stride;
+            src += img->stride;
+        }
+        for (int y = 0; y < ATLAS_PADDING; y++, dst += page->stride)
+            memset(dst, 0, w);
+        mark_dirty(page, key.x, key.y, key.x + w, key.y + h);
+
+        if (tracked) {
+            atlas->entries[atlas->n_entries++] = key;
+            ass_cache_inc_ref(key.source);
+        }
+        set_location(out, &key);
+    }
+
+    if (atlas->n_sorted < atlas->n_entries) {
+        qsort(atlas->entries, atlas->n_entries, sizeof(AtlasEntry), cmp_entry);
+        atlas->n_sorted = atlas->n_entries;
+    }
+    atlas->valid = true;
+    return true;
+}
+
+int ass_atlas_get(ASS_Atlas *atlas, const ASS_AtlasPage **pages,
+                  const ASS_AtlasImage **images)
+{
+    if (!atlas->valid) {
+        *pages = NULL;
+        *images = NULL;
+        return 0;
+    }
+    *pages = atlas->pages;
+    *images = atlas->images;
+    return atlas->n_pages;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef LIBASS_ATLAS_H
+#define LIBASS_ATLAS_H
+
+#include <stdbool.h>
+
+#include "ass.h"
+
+typedef struct ass_atlas ASS_Atlas;
+
+ASS_Atlas *ass_atlas_create(int page_size, int max_pages);
+void ass_atlas_done(ASS_Atlas *atlas);
+bool ass_atlas_update(ASS_Atlas *atlas, ASS_Image *images);
+int ass_atlas_get(ASS_Atlas *atlas, const ASS_AtlasPage **pages,
+                  const ASS_AtlasImage **images);
+
+#endif /* LIBASS_ATLAS_H */
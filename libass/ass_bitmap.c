@@ -34,6 +34,7 @@
 #include "ass_outline.h"
 #include "ass_bitmap.h"
 #include "ass_render.h"
+#include "ass_threading.h"
 
 
 static void be_blur_pre(uint8_t *buf, intptr_t stride, intptr_t width, intptr_t height)
@@ -65,7 +66,36 @@ static void be_blur_post(uint8_t *buf, intptr_t stride, intptr_t width, intptr_t
     }
 }
 
-void ass_synth_blur(const BitmapEngine *engine, Bitmap *bm,
+/**
+ * \brief Get a scratch buffer of at least the given size
+ * The contents are undefined, and only valid until the next call.
+ * \return buffer aligned to BITMAP_POOL_ALIGN, or NULL on failure
+ */
+void *ass_scratch_get(ScratchBuffer *scratch, size_t size)
+{
+    if (size <= scratch->size)
+        return scratch->buf;
+
+    // round up to reduce the number of reallocations while growing
+    const size_t granularity = 64 * 1024;
+    if (size > SIZE_MAX - granularity)
+        return NULL;
+    size = (size + granularity - 1) & ~(granularity - 1);
+    ass_aligned_free(scratch->buf);
+    scratch->buf = ass_aligned_alloc(BITMAP_POOL_ALIGN, size, false);
+    scratch->size = scratch->buf ? size : 0;
+    return scratch->buf;
+}
+
+void ass_scratch_done(ScratchBuffer *scratch)
+{
+    ass_aligned_free(scratch->buf);
+    scratch->buf = NULL;
+    scratch->size = 0;
+}
+
+void ass_synth_blur(BitmapPool *pool, const BitmapEngine *engine,
+                    ScratchBuffer *scratch, Bitmap *bm,
                     int be, double blur_r2x, double blur_r2y)
 {
     if (!bm->buffer)
@@ -73,15 +103,15 @@ void ass_synth_blur(const BitmapEngine *engine, Bitmap *bm,
 
     // Apply gaussian blur
     if (blur_r2x > 0.001 || blur_r2y > 0.001)
-        ass_gaussian_blur(engine, bm, blur_r2x, blur_r2y);
+        ass_gaussian_blur(pool, engine, scratch, bm, blur_r2x, blur_r2y);
 
     if (!be)
         return;
 
     // Apply box blur (multiple passes, if requested)
-    unsigned align = 1 << engine->align_order;
+    assert((1 << engine->align_order) <= BITMAP_POOL_ALIGN);
     size_t size = sizeof(uint16_t) * bm->stride * 2;
-    uint16_t *tmp = ass_aligned_alloc(align, size, false);
+    uint16_t *tmp = ass_scratch_get(scratch, size);
     if (!tmp)
         return;
 
@@ -97,18 +127,18 @@ void ass_synth_blur(const BitmapEngine *engine, Bitmap *bm,
         be_blur_post(buf, stride, w, h);
     }
     engine->be_blur(buf, stride, w, h, tmp);
-    ass_aligned_free(tmp);
 }
 
-bool ass_alloc_bitmap(const BitmapEngine *engine, Bitmap *bm,
-                      int32_t w, int32_t h, bool zero)
+bool ass_alloc_bitmap(BitmapPool *pool, const BitmapEngine *engine,
+                      Bitmap *bm, int32_t w, int32_t h, bool zero)
 {
     unsigned align = 1 << engine->align_order;
     size_t s = ass_align(align, w);
     // Too often we use ints as offset for bitmaps => use INT_MAX.
     if (s > (INT_MAX - align) / FFMAX(h, 1))
         return false;
-    uint8_t *buf = ass_aligned_alloc(align, s * h + align, zero);
+    assert(align <= BITMAP_POOL_ALIGN);
+    uint8_t *buf = ass_bitmap_pool_alloc(pool, s * h + align, zero);
     if (!buf)
         return false;
     bm->w = w;
@@ -118,27 +148,29 @@ bool ass_alloc_bitmap(const BitmapEngine *engine, Bitmap *bm,
     return true;
 }
 
-bool ass_realloc_bitmap(const BitmapEngine *engine, Bitmap *bm, int32_t w, int32_t h)
+bool ass_realloc_bitmap(BitmapPool *pool, const BitmapEngine *engine,
+                        Bitmap *bm, int32_t w, int32_t h)
 {
     uint8_t *old = bm->buffer;
-    if (!ass_alloc_bitmap(engine, bm, w, h, false))
+    if (!ass_alloc_bitmap(pool, engine, bm, w, h, false))
         return false;
-    ass_aligned_free(old);
+    ass_bitmap_pool_free(old);
     return true;
 }
 
 void ass_free_bitmap(Bitmap *bm)
 {
-    ass_aligned_free(bm->buffer);
+    ass_bitmap_pool_free(bm->buffer);
 }
 
-bool ass_copy_bitmap(const BitmapEngine *engine, Bitmap *dst, const Bitmap *src)
+bool ass_copy_bitmap(BitmapPool *pool, const BitmapEngine *engine,
+                     Bitmap *dst, const Bitmap *src)
 {
     if (!src->buffer) {
         memset(dst, 0, sizeof(*dst));
         return true;
     }
-    if (!ass_alloc_bitmap(engine, dst, src->w, src->h, false))
+    if (!ass_alloc_bitmap(pool, engine, dst, src->w, src->h, false))
         return false;
     dst->left = src->left;
     dst->top  = src->top;
@@ -181,7 +213,8 @@ bool ass_outline_to_bitmap(RenderContext *state, Bitmap *bm,
 
     int32_t tile_w = (w + mask) & ~mask;
     int32_t tile_h = (h + mask) & ~mask;
-    if (!ass_alloc_bitmap(&render_priv->engine, bm, tile_w, tile_h, false))
+    if (!ass_alloc_bitmap(render_priv->cache->bitmap_pool, &render_priv->engine,
+                          bm, tile_w, tile_h, false))
         return false;
     bm->left = x_min;
     bm->top  = y_min;
@@ -258,3 +291,227 @@ void ass_shift_bitmap(Bitmap *bm, int shift_x, int shift_y)
             }
         }
 }
+
+// The frame blending functions have no renderer to take the engine from,
+// so they share one, which is set up by the first call
+static BitmapEngine blend_engine;
+#if CONFIG_THREADS
+static ASS_Once blend_engine_once = ASS_ONCE_INIT;
+#else
+static bool blend_engine_ready;
+#endif
+
+static void init_blend_engine(void)
+{
+    blend_engine = ass_bitmap_engine_init(ASS_CPU_FLAG_ALL);
+}
+
+static const BitmapEngine *get_blend_engine(void)
+{
+#if CONFIG_THREADS
+    ass_once(&blend_engine_once, init_blend_engine);
+#else
+    if (!blend_engine_ready) {
+        init_blend_engine();
+        blend_engine_ready = true;
+    }
+#endif
+    return &blend_engine;
+}
+
+void ass_blend_frame(const ASS_Image *img, unsigned char *dst, int stride,
+                     int w, int h, ASS_FrameFormat format)
+{
+    const BitmapEngine *engine = get_blend_engine();
+
+    for (; img; img = img->next) {
+        uint32_t alpha = 255 - (img->color & 0xFF);
+        int x0 = FFMAX(img->dst_x, 0), x1 = FFMIN(img->dst_x + img->w, w);
+        int y0 = FFMAX(img->dst_y, 0), y1 = FFMIN(img->dst_y + img->h, h);
+        if (!alpha || x0 >= x1 || y0 >= y1)
+            continue;
+
+        uint32_t r = img->color >> 24;
+        uint32_t g = (img->color >> 16) & 0xFF;
+        uint32_t b = (img->color >> 8) & 0xFF;
+        uint32_t color = alpha << 24 | g << 8;
+        color |= format == ASS_FRAME_BGRA ? r << 16 | b : b << 16 | r;
+
+        engine->blend_rgba(dst + y0 * (ptrdiff_t) stride + 4 * x0, stride,
+                          img->bitmap + (y0 - img->dst_y) * (ptrdiff_t) img->stride
+                                      + (x0 - img->dst_x), img->stride,
+                          x1 - x0, y1 - y0, color);
+    }
+}
+
+static ASS_YCbCrMatrix blend_matrix(ASS_YCbCrMatrix header, ASS_YCbCrMatrix frame)
+{
+    if (header == YCBCR_NONE)
+        header = frame;
+    if (header < YCBCR_BT601_TV || header > YCBCR_FCC_PC)
+        return YCBCR_BT601_TV;
+    return header;
+}
+
+/**
+ * \brief Convert the RGB part of an image color to Y, U and V samples
+ * with the given bit depth
+ */
+static void rgb_to_yuv(uint32_t color, ASS_YCbCrMatrix matrix, int depth,
+                       unsigned yuv[3])
+{
+    double kr, kb;
+    bool full_range = false;
+    switch (matrix) {
+    case YCBCR_BT601_PC:
+        full_range = true;
+        // fallthrough
+    default:
+        kr = 0.299, kb = 0.114;
+        break;
+    case YCBCR_BT709_PC:
+        full_range = true;
+        // fallthrough
+    case YCBCR_BT709_TV:
+        kr = 0.2126, kb = 0.0722;
+        break;
+    case YCBCR_SMPTE240M_PC:
+        full_range = true;
+        // fallthrough
+    case YCBCR_SMPTE240M_TV:
+        kr = 0.212, kb = 0.087;
+        break;
+    case YCBCR_FCC_PC:
+        full_range = true;
+        // fallthrough
+    case YCBCR_FCC_TV:
+        kr = 0.3, kb = 0.11;
+        break;
+    }
+
+    double r = (color >> 24) / 255.0;
+    double g = ((color >> 16) & 0xFF) / 255.0;
+    double b = ((color >> 8) & 0xFF) / 255.0;
+    double y = kr * r + (1 - kr - kb) * g + kb * b;
+    double u = (b - y) / (2 * (1 - kb));
+    double v = (r - y) / (2 * (1 - kr));
+
+    int max = (1 << depth) - 1;
+    double mid = 1 << (depth - 1);
+    if (full_range) {
+        y *= max;
+        u = mid + u * max;
+        v = mid + v * max;
+    } else {
+        double scale = 1 << (depth - 8);
+        y = (16 + 219 * y) * scale;
+        u = mid + 224 * scale * u;
+        v = mid + 224 * scale * v;
+    }
+    yuv[0] = FFMINMAX(ass_lrint(y), 0, max);
+    yuv[1] = FFMINMAX(ass_lrint(u), 0, max);
+    yuv[2] = FFMINMAX(ass_lrint(v), 0, max);
+}
+
+static inline unsigned mask_pair(const ASS_Image *img, int x, int y)
+{
+    if (y < 0 || y >= img->h)
+        return 0;
+    const unsigned char *row = img->bitmap + y * (ptrdiff_t) img->stride;
+    unsigned sum = 0;
+    if (x >= 0 && x < img->w)
+        sum += row[x];
+    if (x + 1 >= 0 && x + 1 < img->w)
+        sum += row[x + 1];
+    return sum;
+}
+
+/**
+ * \brief Average the mask of an image over 2x2 blocks for 4:2:0 chroma
+ * \param dup number of copies of each value, for interleaved planes
+ */
+static void downsample_mask(uint8_t *dst, ptrdiff_t dst_stride, int dup,
+                            const ASS_Image *img, int cx0, int cy0,
+                            int cw, int ch)
+{
+    for (int cy = 0; cy < ch; cy++) {
+        int y = 2 * (cy0 + cy) - img->dst_y;
+        for (int cx = 0; cx < cw; cx++) {
+            int x = 2 * (cx0 + cx) - img->dst_x;
+            unsigned sum = mask_pair(img, x, y) + mask_pair(img, x, y + 1);
+            for (int i = 0; i < dup; i++)
+                dst[dup * cx + i] = (sum + 2) >> 2;
+        }
+        dst += dst_stride;
+    }
+}
+
+void ass_blend_frame_yuv(const ASS_Image *img, unsigned char *const planes[3],
+                         const int strides[3], int w, int h,
+                         ASS_YUVFormat format, ASS_YCbCrMatrix header_matrix,
+                         ASS_YCbCrMatrix frame_matrix)
+{
+    const BitmapEngine *engine = get_blend_engine();
+    ASS_YCbCrMatrix matrix = blend_matrix(header_matrix, frame_matrix);
+    bool deep = format == ASS_YUV_P010;
+    int dup = format == ASS_YUV_I420 ? 1 : 2;
+
+    uint8_t *mask = NULL;
+    size_t mask_size = 0;
+
+    for (; img; img = img->next) {
+        uint32_t alpha = 255 - (img->color & 0xFF);
+        int x0 = FFMAX(img->dst_x, 0), x1 = FFMIN(img->dst_x + img->w, w);
+        int y0 = FFMAX(img->dst_y, 0), y1 = FFMIN(img->dst_y + img->h, h);
+        if (!alpha || x0 >= x1 || y0 >= y1)
+            continue;
+
+        unsigned yuv[3];
+        rgb_to_yuv(img->color, matrix, deep ? 10 : 8, yuv);
+
+        const uint8_t *src = img->bitmap + (y0 - img->dst_y) * (ptrdiff_t) img->stride
+                                         + (x0 - img->dst_x);
+        uint8_t *dst = planes[0] + y0 * (ptrdiff_t) strides[0];
+        if (deep) {
+            uint32_t c = yuv[0] << 6;
+            engine->blend_plane16((uint16_t *) dst + x0, strides[0],
+                                 src, img->stride, x1 - x0, y1 - y0,
+                                 c | c << 16, alpha);
+        } else {
+            engine->blend_plane8(dst + x0, strides[0],
+                                src, img->stride, x1 - x0, y1 - y0,
+                                yuv[0] * 0x101 | alpha << 24);
+        }
+
+        int cx0 = x0 >> 1, cx1 = (x1 + 1) >> 1;
+        int cy0 = y0 >> 1, cy1 = (y1 + 1) >> 1;
+        size_t cw = (size_t) (cx1 - cx0) * dup, ch = cy1 - cy0;
+        if (cw * ch > mask_size) {
+            if (!ASS_REALLOC_ARRAY(mask, cw * ch))
+                break;
+            mask_size = cw * ch;
+        }
+        downsample_mask(mask, cw, dup, img, cx0, cy0, cx1 - cx0, ch);
+
+        dst = planes[1] + cy0 * (ptrdiff_t) strides[1];
+        switch (format) {
+        case ASS_YUV_I420:
+            engine->blend_plane8(dst + cx0, strides[1], mask, cw, cw, ch,
+                                yuv[1] * 0x101 | alpha << 24);
+            dst = planes[2] + cy0 * (ptrdiff_t) strides[2];
+            engine->blend_plane8(dst + cx0, strides[2], mask, cw, cw, ch,
+                                yuv[2] * 0x101 | alpha << 24);
+            break;
+        case ASS_YUV_NV12:
+            engine->blend_plane8(dst + 2 * cx0, strides[1], mask, cw, cw, ch,
+                                yuv[1] | yuv[2] << 8 | alpha << 24);
+            break;
+        case ASS_YUV_P010:
+            engine->blend_plane16((uint16_t *) dst + 2 * cx0, strides[1],
+                                 mask, cw, cw, ch,
+                                 yuv[1] << 6 | yuv[2] << 22, alpha);
+            break;
+        }
+    }
+    free(mask);
+}
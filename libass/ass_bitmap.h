@@ -26,6 +26,7 @@
 #include "ass.h"
 #include "ass_outline.h"
 #include "ass_bitmap_engine.h"
+#include "ass_bitmap_pool.h"
 
 typedef struct {
     int32_t left, top;
@@ -34,9 +35,24 @@ typedef struct {
     uint8_t *buffer;      // h * stride buffer
 } Bitmap;
 
-bool ass_alloc_bitmap(const BitmapEngine *engine, Bitmap *bm, int32_t w, int32_t h, bool zero);
-bool ass_realloc_bitmap(const BitmapEngine *engine, Bitmap *bm, int32_t w, int32_t h);
-bool ass_copy_bitmap(const BitmapEngine *engine, Bitmap *dst, const Bitmap *src);
+// Temporary memory for filters, kept between calls to avoid
+// reallocating large buffers for every bitmap. It only grows,
+// so its size is the largest amount needed so far.
+// Every rendering thread has its own.
+typedef struct {
+    void *buf;
+    size_t size;
+} ScratchBuffer;
+
+void *ass_scratch_get(ScratchBuffer *scratch, size_t size);
+void ass_scratch_done(ScratchBuffer *scratch);
+
+bool ass_alloc_bitmap(BitmapPool *pool, const BitmapEngine *engine,
+                      Bitmap *bm, int32_t w, int32_t h, bool zero);
+bool ass_realloc_bitmap(BitmapPool *pool, const BitmapEngine *engine,
+                        Bitmap *bm, int32_t w, int32_t h);
+bool ass_copy_bitmap(BitmapPool *pool, const BitmapEngine *engine,
+                     Bitmap *dst, const Bitmap *src);
 void ass_free_bitmap(Bitmap *bm);
 
 struct render_context;
@@ -44,10 +60,13 @@ struct render_context;
 bool ass_outline_to_bitmap(struct render_context *state, Bitmap *bm,
                            ASS_Outline *outline1, ASS_Outline *outline2);
 
-void ass_synth_blur(const BitmapEngine *engine, Bitmap *bm,
+void ass_synth_blur(BitmapPool *pool, const BitmapEngine *engine,
+                    ScratchBuffer *scratch, Bitmap *bm,
                     int be, double blur_r2x, double blur_r2y);
 
-bool ass_gaussian_blur(const BitmapEngine *engine, Bitmap *bm, double r2x, double r2y);
+bool ass_gaussian_blur(BitmapPool *pool, const BitmapEngine *engine,
+                       ScratchBuffer *scratch, Bitmap *bm,
+                       double r2x, double r2y);
 void ass_shift_bitmap(Bitmap *bm, int shift_x, int shift_y);
 void ass_fix_outline(Bitmap *bm_g, Bitmap *bm_o);
 
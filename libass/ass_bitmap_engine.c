@@ -20,10 +20,18 @@
 #include "ass_compat.h"
 
 #include <stdbool.h>
+#if CONFIG_ASM && CONFIG_SVE && defined(__linux__)
+#include <sys/auxv.h>
+#endif
 
 #include "ass_bitmap_engine.h"
 #include "x86/cpuid.h"
 
+#if CONFIG_ASM && ARCH_AARCH64 && CONFIG_SVE
+// SVE vector length in bytes, see aarch64/blur.S
+size_t ass_get_sve_vl(void);
+#endif
+
 
 #define RASTERIZER_PROTOTYPES(tile_size, suffix) \
     FillSolidTileFunc     ass_fill_solid_tile     ## tile_size ## _ ## suffix; \
@@ -44,19 +52,25 @@
 
 
 #define GENERIC_PROTOTYPES(suffix) \
-    BitmapBlendFunc ass_add_bitmaps_  ## suffix; \
-    BitmapBlendFunc ass_imul_bitmaps_ ## suffix; \
-    BitmapMulFunc   ass_mul_bitmaps_  ## suffix; \
-    BeBlurFunc      ass_be_blur_      ## suffix;
+    BitmapBlendFunc  ass_add_bitmaps_   ## suffix; \
+    BitmapBlendFunc  ass_imul_bitmaps_  ## suffix; \
+    BitmapMulFunc    ass_mul_bitmaps_   ## suffix; \
+    FrameBlendFunc   ass_blend_rgba_    ## suffix; \
+    FrameBlendFunc   ass_blend_plane8_  ## suffix; \
+    FrameBlend16Func ass_blend_plane16_ ## suffix; \
+    BeBlurFunc       ass_be_blur_       ## suffix;
 
 #define GENERIC_FUNCTION(name, suffix) \
     engine.name = ass_ ## name ## _ ## suffix;
 
 #define GENERIC_FUNCTIONS(suffix) \
-    GENERIC_FUNCTION(add_bitmaps,  suffix) \
-    GENERIC_FUNCTION(imul_bitmaps, suffix) \
-    GENERIC_FUNCTION(mul_bitmaps,  suffix) \
-    GENERIC_FUNCTION(be_blur,      suffix)
+    GENERIC_FUNCTION(add_bitmaps,   suffix) \
+    GENERIC_FUNCTION(imul_bitmaps,  suffix) \
+    GENERIC_FUNCTION(mul_bitmaps,   suffix) \
+    GENERIC_FUNCTION(blend_rgba,    suffix) \
+    GENERIC_FUNCTION(blend_plane8,  suffix) \
+    GENERIC_FUNCTION(blend_plane16, suffix) \
+    GENERIC_FUNCTION(be_blur,       suffix)
 
 
 #define PARAM_BLUR_SET(suffix) \
@@ -123,7 +137,7 @@ unsigned ass_get_cpu_flags(unsigned mask)
     ass_get_cpuid(&eax, &ebx, &ecx, &edx);
     uint32_t max_leaf = eax;
 
-    bool avx = false;
+    bool avx = false, avx512 = false;
     if (max_leaf >= 1) {
         eax = 1;
         ass_get_cpuid(&eax, &ebx, &ecx, &edx);
@@ -141,6 +155,9 @@ unsigned ass_get_cpu_flags(unsigned mask)
             if (xcr0l & (1 << 1) &&  // XSAVE for XMM
                 xcr0l & (1 << 2))    // XSAVE for YMM
                     avx = true;
+            if (avx &&
+                (xcr0l & 0xE0) == 0xE0)  // XSAVE for opmask and ZMM
+                    avx512 = true;
         }
     }
 
@@ -149,12 +166,21 @@ unsigned ass_get_cpu_flags(unsigned mask)
         ass_get_cpuid(&eax, &ebx, &ecx, &edx);
         if (avx && ebx & (1 << 5))  // AVX2
             flags |= ASS_CPU_FLAG_X86_AVX2;
+        if (avx512 &&
+            ebx & (1 << 16) &&  // AVX512F
+            ebx & (1 << 30) &&  // AVX512BW
+            ebx & (1u << 31))   // AVX512VL
+                flags |= ASS_CPU_FLAG_X86_AVX512;
     }
 
 #endif
 
 #if ARCH_AARCH64
     flags = ASS_CPU_FLAG_ARM_NEON;
+#if CONFIG_ASM && CONFIG_SVE && defined(__linux__) && defined(HWCAP_SVE)
+    if (getauxval(AT_HWCAP) & HWCAP_SVE)
+        flags |= ASS_CPU_FLAG_ARM_SVE;
+#endif
 #endif
 
     return flags & mask;
@@ -164,14 +190,35 @@ BitmapEngine ass_bitmap_engine_init(unsigned mask)
 {
     ALL_PROTOTYPES(16, c)
     BLUR_PROTOTYPES(32, c)
+    BLUR_PROTOTYPES(64, c)
     BitmapEngine engine = {0};
     engine.tile_order = mask & ASS_FLAG_LARGE_TILES ? 5 : 4;
 
 #if CONFIG_ASM
     unsigned flags = ass_get_cpu_flags(mask);
 #if ARCH_X86
+    ALL_PROTOTYPES(32, avx2)
+#if ARCH_X86_64 && CONFIG_AVX512
+    if (flags & ASS_CPU_FLAG_X86_AVX512) {
+        // rasterizer tiles are at most 32 bytes wide and frame blends
+        // work on unaligned user frames, so these stay at AVX2
+        BitmapBlendFunc ass_add_bitmaps_avx512, ass_imul_bitmaps_avx512;
+        BitmapMulFunc   ass_mul_bitmaps_avx512;
+        BeBlurFunc      ass_be_blur_avx512;
+        BLUR_PROTOTYPES(64, avx512)
+        RASTERIZER_FUNCTIONS(avx2)
+        GENERIC_FUNCTION(add_bitmaps,   avx512)
+        GENERIC_FUNCTION(imul_bitmaps,  avx512)
+        GENERIC_FUNCTION(mul_bitmaps,   avx512)
+        GENERIC_FUNCTION(blend_rgba,    avx2)
+        GENERIC_FUNCTION(blend_plane8,  avx2)
+        GENERIC_FUNCTION(blend_plane16, avx2)
+        GENERIC_FUNCTION(be_blur,       avx512)
+        BLUR_FUNCTIONS(6, 64, avx512)
+        return engine;
+    }
+#endif
     if (flags & ASS_CPU_FLAG_X86_AVX2) {
-        ALL_PROTOTYPES(32, avx2)
         ALL_FUNCTIONS(5, 32, avx2)
         return engine;
     } else if (flags & ASS_CPU_FLAG_X86_SSE2) {
@@ -188,8 +235,34 @@ BitmapEngine ass_bitmap_engine_init(unsigned mask)
         return engine;
     }
 #elif ARCH_AARCH64
+    ALL_PROTOTYPES(16, neon)
+#if CONFIG_SVE
+    if (flags & ASS_CPU_FLAG_ARM_SVE) {
+        // blur stripes are one vector wide, so SVE is only used
+        // for vectors wider than NEON that fit the bitmap alignment
+        size_t vl = ass_get_sve_vl();
+        if (vl == 32 || vl == 64) {
+            BitmapBlendFunc ass_add_bitmaps_sve, ass_imul_bitmaps_sve;
+            BitmapMulFunc   ass_mul_bitmaps_sve;
+            BLUR_PROTOTYPES(_vl, sve)
+            RASTERIZER_FUNCTIONS(neon)
+            GENERIC_FUNCTION(add_bitmaps,   sve)
+            GENERIC_FUNCTION(imul_bitmaps,  sve)
+            GENERIC_FUNCTION(mul_bitmaps,   sve)
+            GENERIC_FUNCTION(blend_rgba,    neon)
+            GENERIC_FUNCTION(blend_plane8,  neon)
+            GENERIC_FUNCTION(blend_plane16, neon)
+            GENERIC_FUNCTION(be_blur,       neon)
+            if (vl == 64) {
+                BLUR_FUNCTIONS(6, _vl, sve)
+            } else {
+                BLUR_FUNCTIONS(5, _vl, sve)
+            }
+            return engine;
+        }
+    }
+#endif
     if (flags & ASS_CPU_FLAG_ARM_NEON) {
-        ALL_PROTOTYPES(16, neon)
         ALL_FUNCTIONS(4, 16, neon)
         return engine;
     }
@@ -197,7 +270,9 @@ BitmapEngine ass_bitmap_engine_init(unsigned mask)
 #endif
 
     ALL_FUNCTIONS(4, 16, c)
-    if (mask & ASS_FLAG_WIDE_STRIPE) {
+    if (mask & ASS_FLAG_WIDER_STRIPE) {
+        BLUR_FUNCTIONS(6, 64, c)
+    } else if (mask & ASS_FLAG_WIDE_STRIPE) {
         BLUR_FUNCTIONS(5, 32, c)
     }
     return engine;
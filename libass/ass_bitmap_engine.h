@@ -29,6 +29,8 @@
  * - All strides must be multiples of the engine alignment
  * - All buffers, except for BitmapBlendFunc and sources of BitmapMulFunc,
  *   must be aligned to the engine alignment
+ * - FrameBlendFunc and FrameBlend16Func work on user frames
+ *   and have no alignment requirements
  */
 
 struct segment;
@@ -48,6 +50,23 @@ typedef void BitmapMulFunc(uint8_t *restrict dst, ptrdiff_t dst_stride,
                            const uint8_t *restrict src2, ptrdiff_t src2_stride,
                            size_t width, size_t height);
 
+// blend a monochrome bitmap onto frame pixels with the opacity
+// in the top byte of color:
+// - blend_rgba takes 4-byte premultiplied pixels, color holds the first
+//   three channels in memory order, the fourth is blended towards 255
+// - blend_plane8 takes 1-byte samples, color holds the values for samples
+//   at even and odd positions in its two lowest bytes
+typedef void FrameBlendFunc(uint8_t *restrict dst, ptrdiff_t dst_stride,
+                            const uint8_t *restrict src, ptrdiff_t src_stride,
+                            size_t width, size_t height, uint32_t color);
+// blend a monochrome bitmap onto 16-bit samples with 10 significant bits
+// in the upper part; color holds the values for samples at even and odd
+// positions in the same representation in its low and high word
+typedef void FrameBlend16Func(uint16_t *restrict dst, ptrdiff_t dst_stride,
+                              const uint8_t *restrict src, ptrdiff_t src_stride,
+                              size_t width, size_t height,
+                              uint32_t color, unsigned alpha);
+
 typedef void BeBlurFunc(uint8_t *restrict buf, ptrdiff_t stride,
                         size_t width, size_t height, uint16_t *restrict tmp);
 
@@ -75,6 +94,8 @@ typedef struct {
     // blend functions
     BitmapBlendFunc *add_bitmaps, *imul_bitmaps;
     BitmapMulFunc *mul_bitmaps;
+    FrameBlendFunc *blend_rgba, *blend_plane8;
+    FrameBlend16Func *blend_plane16;
 
     // be blur function
     BeBlurFunc *be_blur;
@@ -93,12 +114,15 @@ enum {
     ASS_CPU_FLAG_X86_SSE2      = 0x0001,
     ASS_CPU_FLAG_X86_SSSE3     = 0x0002,
     ASS_CPU_FLAG_X86_AVX2      = 0x0004,
+    ASS_CPU_FLAG_X86_AVX512    = 0x0008,
 #elif ARCH_AARCH64
     ASS_CPU_FLAG_ARM_NEON      = 0x0001,
+    ASS_CPU_FLAG_ARM_SVE       = 0x0002,
 #endif
     ASS_CPU_FLAG_ALL           = 0x0FFF,
     ASS_FLAG_LARGE_TILES       = 0x1000,
     ASS_FLAG_WIDE_STRIPE       = 0x2000,  // for C version only
+    ASS_FLAG_WIDER_STRIPE      = 0x4000,  // for C version only
 };
 
 unsigned ass_get_cpu_flags(unsigned mask);
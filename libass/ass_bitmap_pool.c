@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+#include "ass_compat.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ass_bitmap_pool.h"
+#include "ass_threading.h"
+
+/*
+ * Bitmap buffers are rounded up to size classes, four per power of two,
+ * and freed buffers are kept in a list per class instead of being
+ * returned to the system, up to a limit on their total size.
+ * Bitmaps mostly have tile-aligned dimensions, so the same sizes recur
+ * often, and rounding wastes at most a fifth of a buffer.
+ * Buffers larger than the largest class are allocated directly.
+ *
+ * Every buffer is preceded by a header, so it can be freed without
+ * knowing the pool. Buffers can outlive the pool's owner, as cache
+ * values stay alive as long as they are referenced. The pool itself
+ * is thus only destroyed once all its buffers are freed.
+ */
+
+#define MIN_CLASS_ORDER 8       // 256 bytes
+#define MAX_CLASS_ORDER 22      // 4 MiB
+#define CLASS_STEP_ORDER 2      // 4 classes per power of two
+#define N_CLASSES (((MAX_CLASS_ORDER - MIN_CLASS_ORDER) << CLASS_STEP_ORDER) + 1)
+#define NO_CLASS N_CLASSES
+
+typedef struct {
+    void *allocation;           // as returned by malloc
+    BitmapPool *pool;           // NULL for buffers not tracked by a pool
+    size_t size;                // usable size
+    unsigned size_class;
+} BufferHeader;
+
+typedef struct free_buffer {
+    struct free_buffer *next;
+} FreeBuffer;
+
+struct bitmap_pool {
+#if CONFIG_THREADS
+    ASS_Mutex lock;
+#endif
+    FreeBuffer *free[N_CLASSES];
+    size_t max_cached;
+    size_t n_live;              // buffers handed out and not yet freed
+    bool released;              // the owner is done with the pool
+    ASS_BitmapPoolStats stats;
+};
+
+static inline void pool_lock(BitmapPool *pool)
+{
+#if CONFIG_THREADS
+    ass_mutex_lock(&pool->lock);
+#endif
+}
+
+static inline void pool_unlock(BitmapPool *pool)
+{
+#if CONFIG_THREADS
+    ass_mutex_unlock(&pool->lock);
+#endif
+}
+
+static unsigned size_to_class(size_t size)
+{
+    if (size <= (size_t) 1 << MIN_CLASS_ORDER)
+        return 0;
+    if (size > (size_t) 1 << MAX_CLASS_ORDER)
+        return NO_CLASS;
+    size--;
+    unsigned order = MIN_CLASS_ORDER;
+    while (size >> (order + 1))
+        order++;
+    size_t step = (size - ((size_t) 1 << order)) >> (order - CLASS_STEP_ORDER);
+    return ((order - MIN_CLASS_ORDER) << CLASS_STEP_ORDER) + step + 1;
+}
+
+static size_t class_size(unsigned size_class)
+{
+    if (!size_class)
+        return (size_t) 1 << MIN_CLASS_ORDER;
+    size_class--;
+    unsigned order = MIN_CLASS_ORDER + (size_class >> CLASS_STEP_ORDER);
+    size_t step = (size_class & ((1 << CLASS_STEP_ORDER) - 1)) + 1;
+    return ((size_t) 1 << order) + (step << (order - CLASS_STEP_ORDER));
+}
+
+static inline BufferHeader *get_header(void *ptr)
+{
+    return (BufferHeader *) ptr - 1;
+}
+
+BitmapPool *ass_bitmap_pool_create(size_t max_cached)
+{
+    BitmapPool *pool = calloc(1, sizeof(BitmapPool));
+    if (!pool)
+        return NULL;
+#if CONFIG_THREADS
+    if (!ass_mutex_init(&pool->lock)) {
+        free(pool);
+        return NULL;
+    }
+#endif
+    pool->max_cached = max_cached;
+    return pool;
+}
+
+static void destroy_pool(BitmapPool *pool)
+{
+#if CONFIG_THREADS
+    ass_mutex_destroy(&pool->lock);
+#endif
+    free(pool);
+}
+
+// Free cached buffers until at most max_cached bytes are left.
+// Must be called with the pool locked.
+static void trim_locked(BitmapPool *pool, size_t max_cached)
+{
+    for (unsigned i = N_CLASSES; i-- > 0;) {
+        size_t size = class_size(i);
+        while (pool->stats.cached > max_cached && pool->free[i]) {
+            FreeBuffer *buf = pool->free[i];
+            pool->free[i] = buf->next;
+            pool->stats.cached -= size;
+            free(get_header(buf)->allocation);
+        }
+    }
+}
+
+/**
+ * \brief Give up ownership of the pool
+ * Cached buffers are freed, buffers still in use are freed normally later.
+ */
+void ass_bitmap_pool_release(BitmapPool *pool)
+{
+    if (!pool)
+        return;
+
+    pool_lock(pool);
+    pool->released = true;
+    trim_locked(pool, 0);
+    bool destroy = !pool->n_live;
+    pool_unlock(pool);
+    if (destroy)
+        destroy_pool(pool);
+}
+
+void ass_bitmap_pool_trim(BitmapPool *pool, size_t max_cached)
+{
+    pool_lock(pool);
+    pool->max_cached = max_cached;
+    trim_locked(pool, max_cached);
+    pool_unlock(pool);
+}
+
+void ass_bitmap_pool_get_stats(BitmapPool *pool, ASS_BitmapPoolStats *stats)
+{
+    pool_lock(pool);
+    *stats = pool->stats;
+    pool_unlock(pool);
+}
+
+/**
+ * \brief Allocate a buffer aligned to BITMAP_POOL_ALIGN
+ * \param pool pool to reuse buffers of, or NULL
+ * \param zero whether to clear the buffer
+ * \return the buffer, to be freed with ass_bitmap_pool_free
+ */
+void *ass_bitmap_pool_alloc(BitmapPool *pool, size_t size, bool zero)
+{
+    unsigned size_class = pool ? size_to_class(size) : NO_CLASS;
+    size_t alloc_size = size_class == NO_CLASS ? size : class_size(size_class);
+
+    if (size_class != NO_CLASS) {
+        pool_lock(pool);
+        FreeBuffer *buf = pool->free[size_class];
+        if (buf) {
+            pool->free[size_class] = buf->next;
+            pool->n_live++;
+            pool->stats.cached -= alloc_size;
+            pool->stats.used += alloc_size;
+            pool->stats.allocs++;
+            pool->stats.reuses++;
+        }
+        pool_unlock(pool);
+        if (buf) {
+            if (zero)
+                memset(buf, 0, size);
+            return buf;
+        }
+    }
+
+    size_t overhead = sizeof(BufferHeader) + BITMAP_POOL_ALIGN - 1;
+    if (alloc_size >= SIZE_MAX - overhead)
+        return NULL;
+    char *allocation = zero ? calloc(1, alloc_size + overhead)
+                            : malloc(alloc_size + overhead);
+    if (!allocation)
+        return NULL;
+    char *ptr = allocation + sizeof(BufferHeader);
+    unsigned misalign = (uintptr_t) ptr & (BITMAP_POOL_ALIGN - 1);
+    if (misalign)
+        ptr += BITMAP_POOL_ALIGN - misalign;
+    BufferHeader *header = get_header(ptr);
+    header->allocation = allocation;
+    header->pool = pool;
+    header->size = alloc_size;
+    header->size_class = size_class;
+
+    if (pool) {
+        pool_lock(pool);
+        pool->n_live++;
+        pool->stats.used += alloc_size;
+        pool->stats.allocs++;
+        pool_unlock(pool);
+    }
+    return ptr;
+}
+
+void ass_bitmap_pool_free(void *ptr)
+{
+    if (!ptr)
+        return;
+
+    BufferHeader *header = get_header(ptr);
+    BitmapPool *pool = header->pool;
+    if (!pool) {
+        free(header->allocation);
+        return;
+    }
+
+    pool_lock(pool);
+    pool->n_live--;
+    pool->stats.used -= header->size;
+    bool keep = header->size_class != NO_CLASS && !pool->released &&
+        pool->stats.cached + header->size <= pool->max_cached;
+    if (keep) {
+        FreeBuffer *buf = ptr;
+        buf->next = pool->free[header->size_class];
+        pool->free[header->size_class] = buf;
+        pool->stats.cached += header->size;
+    }
+    bool destroy = pool->released && !pool->n_live;
+    pool_unlock(pool);
+
+    if (!keep)
+        free(header->allocation);
+    if (destroy)
+        destroy_pool(pool);
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef LIBASS_BITMAP_POOL_H
+#define LIBASS_BITMAP_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ass.h"
+
+#define BITMAP_POOL_ALIGN 64    // maximal alignment of buffers
+
+typedef struct bitmap_pool BitmapPool;
+
+BitmapPool *ass_bitmap_pool_create(size_t max_cached);
+void ass_bitmap_pool_release(BitmapPool *pool);
+void ass_bitmap_pool_trim(BitmapPool *pool, size_t max_cached);
+void ass_bitmap_pool_get_stats(BitmapPool *pool, ASS_BitmapPoolStats *stats);
+
+void *ass_bitmap_pool_alloc(BitmapPool *pool, size_t size, bool zero);
+void ass_bitmap_pool_free(void *ptr);
+
+#endif /* LIBASS_BITMAP_POOL_H */
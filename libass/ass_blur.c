@@ -165,12 +165,132 @@ static void find_best_method(BlurMethod *blur, double r2)
         blur->coeff[i] = (int) (0x10000 * mu[i] + 0.5);
 }
 
+/*
+ * Sparse Processing
+ *
+ * Text bitmaps often consist of separate words or glyphs with empty space
+ * between them. Every pass only touches the ranges of stripes that can
+ * be nonzero, treating everything else as zero. The contents of stripes
+ * outside these ranges are undefined, and they are zeroed only if a pass
+ * needs to read them. As all filters map zero to zero, the result
+ * is the same as if the whole bitmap had been processed.
+ *
+ * Horizontal filters spread a range into neighboring columns, so ranges
+ * whose outputs would share a stripe are merged before such a pass.
+ */
+
+// 0 processes whole rows in every pass, which serves as a reference in unittest/
+#ifndef BLUR_SPARSE
+#define BLUR_SPARSE 1
+#endif
+
+typedef struct {
+    uint32_t start, end;        // stripe-aligned start, exclusive end in columns
+} ColumnRange;
+
+// columns [start * num / den, (end * num + add) / den) of the output
+// of a horizontal filter depend on columns [start, end) of its input
+typedef struct {
+    uint32_t num, den, add;
+} RangeMap;
+
+static void zero_columns(int16_t *buf, uint32_t height, uint32_t x0, uint32_t x1)
+{
+    if (x1 > x0)
+        memset(buf + (size_t) x0 * height, 0, sizeof(int16_t) * (x1 - x0) * height);
+}
+
+/**
+ * \brief Find ranges of column blocks that have nonzero pixels
+ * \param block width of a block, alignment of the range starts
+ * \param nonempty scratch space for a flag per block
+ * \return number of ranges
+ */
+static size_t find_ranges(ColumnRange *ranges, bool *nonempty,
+                          const Bitmap *bm, uint32_t block)
+{
+    if (!BLUR_SPARSE) {
+        ranges[0] = (ColumnRange) { 0, bm->w };
+        return 1;
+    }
+
+    uint32_t n_blocks = (bm->w + block - 1) / block;
+    memset(nonempty, 0, n_blocks);
+    const uint8_t *row = bm->buffer;
+    for (int32_t y = 0; y < bm->h; y++, row += bm->stride) {
+        for (uint32_t i = 0; i < n_blocks; i++) {
+            if (nonempty[i])
+                continue;
+            // the bitmap is padded with zeros up to its stride
+            uint8_t acc = 0;
+            for (uint32_t k = 0; k < block; k++)
+                acc |= row[i * block + k];
+            nonempty[i] = acc;
+        }
+    }
+
+    size_t n = 0;
+    for (uint32_t i = 0; i < n_blocks; i++) {
+        if (!nonempty[i])
+            continue;
+        uint32_t start = i * block, end = FFMIN(start + block, bm->w);
+        if (n && ranges[n - 1].end == start)
+            ranges[n - 1].end = end;
+        else
+            ranges[n++] = (ColumnRange) { start, end };
+    }
+    return n;
+}
+
+/**
+ * \brief Prepare ranges for a horizontal filter
+ * Range starts are aligned so that their outputs start at stripe boundaries.
+ * Ranges with overlapping outputs are merged, and columns that become
+ * part of a range are zeroed.
+ * \return new number of ranges
+ */
+static size_t merge_ranges(ColumnRange *ranges, size_t n, int16_t *src,
+                           uint32_t height, uint32_t stripe_width,
+                           const RangeMap *map)
+{
+    uint32_t align = stripe_width * map->den;
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t start = ranges[i].start & ~(align - 1);
+        uint32_t prev_end = 0;
+        if (count) {
+            ColumnRange *prev = &ranges[count - 1];
+            prev_end = (prev->end + stripe_width - 1) & ~(stripe_width - 1);
+            uint32_t prev_out = (prev->end * map->num + map->add) / map->den;
+            prev_out = (prev_out + stripe_width - 1) & ~(stripe_width - 1);
+            if (start * map->num / map->den < prev_out) {
+                zero_columns(src, height, prev_end, ranges[i].start);
+                prev->end = ranges[i].end;
+                continue;
+            }
+        }
+        zero_columns(src, height, FFMAX(start, prev_end), ranges[i].start);
+        ranges[count].start = start;
+        ranges[count].end = ranges[i].end;
+        count++;
+    }
+    return count;
+}
+
+static inline void map_range(ColumnRange *range, const RangeMap *map)
+{
+    range->start = range->start * map->num / map->den;
+    range->end = (range->end * map->num + map->add) / map->den;
+}
+
 /**
  * \brief Perform approximate gaussian blur
  * \param r2x in: desired standard deviation along X axis squared
  * \param r2y in: desired standard deviation along Y axis squared
  */
-bool ass_gaussian_blur(const BitmapEngine *engine, Bitmap *bm, double r2x, double r2y)
+bool ass_gaussian_blur(BitmapPool *pool, const BitmapEngine *engine,
+                       ScratchBuffer *scratch, Bitmap *bm,
+                       double r2x, double r2y)
 {
     BlurMethod blur_x, blur_y;
     find_best_method(&blur_x, r2x);
@@ -189,53 +309,103 @@ bool ass_gaussian_blur(const BitmapEngine *engine, Bitmap *bm, double r2x, doubl
     if (size > INT_MAX / 4)
         return false;
 
-    int16_t *tmp = ass_aligned_alloc(2 * stripe_width, 4 * size, false);
+    // unpacking needs ranges aligned like the bitmap rows
+    const uint32_t block = 2 * stripe_width;
+    uint32_t n_blocks = (w + block - 1) / block;
+
+    assert(2 * stripe_width <= BITMAP_POOL_ALIGN);
+    int16_t *tmp = ass_scratch_get(scratch, 4 * size +
+                                   n_blocks * (sizeof(ColumnRange) + sizeof(bool)));
     if (!tmp)
         return false;
+    ColumnRange *ranges = (ColumnRange *) (tmp + 2 * size);
+    size_t n = find_ranges(ranges, (bool *) (ranges + n_blocks), bm, block);
 
-    engine->stripe_unpack(tmp, bm->buffer, bm->stride, w, h);
     int16_t *buf[2] = {tmp, tmp + size};
     int index = 0;
+    for (size_t i = 0; i < n; i++)
+        engine->stripe_unpack(buf[index] + (size_t) ranges[i].start * h,
+                              bm->buffer + ranges[i].start, bm->stride,
+                              ranges[i].end - ranges[i].start, h);
 
     for (int i = 0; i < blur_y.level; i++) {
-        engine->shrink_vert(buf[index ^ 1], buf[index], w, h);
-        h = (h + 5) >> 1;
+        uint32_t dst_h = (h + 5) >> 1;
+        for (size_t j = 0; j < n; j++)
+            engine->shrink_vert(buf[index ^ 1] + (size_t) ranges[j].start * dst_h,
+                                buf[index] + (size_t) ranges[j].start * h,
+                                ranges[j].end - ranges[j].start, h);
+        h = dst_h;
         index ^= 1;
     }
+    const RangeMap shrink_map = { 1, 2, 5 };
     for (int i = 0; i < blur_x.level; i++) {
-        engine->shrink_horz(buf[index ^ 1], buf[index], w, h);
+        n = merge_ranges(ranges, n, buf[index], h, stripe_width, &shrink_map);
+        for (size_t j = 0; j < n; j++) {
+            engine->shrink_horz(buf[index ^ 1] + (size_t) ranges[j].start / 2 * h,
+                                buf[index] + (size_t) ranges[j].start * h,
+                                ranges[j].end - ranges[j].start, h);
+            map_range(&ranges[j], &shrink_map);
+        }
         w = (w + 5) >> 1;
         index ^= 1;
     }
     assert(blur_x.radius >= 4 && blur_x.radius <= 8);
-    engine->blur_horz[blur_x.radius - 4](buf[index ^ 1], buf[index], w, h, blur_x.coeff);
+    const RangeMap blur_map = { 1, 1, 2 * blur_x.radius };
+    n = merge_ranges(ranges, n, buf[index], h, stripe_width, &blur_map);
+    for (size_t j = 0; j < n; j++) {
+        engine->blur_horz[blur_x.radius - 4](buf[index ^ 1] + (size_t) ranges[j].start * h,
+                                             buf[index] + (size_t) ranges[j].start * h,
+                                             ranges[j].end - ranges[j].start, h,
+                                             blur_x.coeff);
+        map_range(&ranges[j], &blur_map);
+    }
     w += 2 * blur_x.radius;
     index ^= 1;
     assert(blur_y.radius >= 4 && blur_y.radius <= 8);
-    engine->blur_vert[blur_y.radius - 4](buf[index ^ 1], buf[index], w, h, blur_y.coeff);
-    h += 2 * blur_y.radius;
+    uint32_t dst_h = h + 2 * blur_y.radius;
+    for (size_t j = 0; j < n; j++)
+        engine->blur_vert[blur_y.radius - 4](buf[index ^ 1] + (size_t) ranges[j].start * dst_h,
+                                             buf[index] + (size_t) ranges[j].start * h,
+                                             ranges[j].end - ranges[j].start, h,
+                                             blur_y.coeff);
+    h = dst_h;
     index ^= 1;
+    const RangeMap expand_map = { 2, 1, 4 };
     for (int i = 0; i < blur_x.level; i++) {
-        engine->expand_horz(buf[index ^ 1], buf[index], w, h);
+        n = merge_ranges(ranges, n, buf[index], h, stripe_width, &expand_map);
+        for (size_t j = 0; j < n; j++) {
+            engine->expand_horz(buf[index ^ 1] + (size_t) ranges[j].start * 2 * h,
+                                buf[index] + (size_t) ranges[j].start * h,
+                                ranges[j].end - ranges[j].start, h);
+            map_range(&ranges[j], &expand_map);
+        }
         w = 2 * w + 4;
         index ^= 1;
     }
     for (int i = 0; i < blur_y.level; i++) {
-        engine->expand_vert(buf[index ^ 1], buf[index], w, h);
-        h = 2 * h + 4;
+        dst_h = 2 * h + 4;
+        for (size_t j = 0; j < n; j++)
+            engine->expand_vert(buf[index ^ 1] + (size_t) ranges[j].start * dst_h,
+                                buf[index] + (size_t) ranges[j].start * h,
+                                ranges[j].end - ranges[j].start, h);
+        h = dst_h;
         index ^= 1;
     }
     assert(w == end_w && h == end_h);
 
-    if (!ass_realloc_bitmap(engine, bm, w, h)) {
-        ass_aligned_free(tmp);
-        return false;
+    // fill the gaps between ranges for packing
+    uint32_t prev_end = 0;
+    for (size_t j = 0; j < n; j++) {
+        zero_columns(buf[index], h, prev_end, ranges[j].start);
+        prev_end = (ranges[j].end + stripe_width - 1) & ~(stripe_width - 1);
     }
+    zero_columns(buf[index], h, prev_end, (w + stripe_width - 1) & ~(stripe_width - 1));
+
+    if (!ass_realloc_bitmap(pool, engine, bm, w, h))
+        return false;
     bm->left -= ((blur_x.radius + 4) << blur_x.level) - 4;
     bm->top  -= ((blur_y.radius + 4) << blur_y.level) - 4;
 
     engine->stripe_pack(bm->buffer, bm->stride, buf[index], w, h);
-    ass_aligned_free(tmp);
     return true;
 }
-
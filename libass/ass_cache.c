@@ -29,6 +29,7 @@
 #include "ass_font.h"
 #include "ass_outline.h"
 #include "ass_cache.h"
+#include "ass_threading.h"
 
 // Always enable native-endian mode, since we don't care about cross-platform consistency of the hash
 #define WYHASH_LITTLE_ENDIAN 1
@@ -327,24 +328,66 @@ const CacheDesc glyph_metrics_cache_desc = {
 
 
 // Cache data
+typedef struct cache_shard CacheShard;
+
 typedef struct cache_item {
-    Cache *cache;
+    CacheShard *shard;
     const CacheDesc *desc;
-    struct cache_item *next, **prev;
+    ass_hashcode hash;
     struct cache_item *queue_next, **queue_prev;
     size_t size, ref_count;
+    bool referenced;            // hit since last seen by cut_shard, for CLOCK
 } CacheItem;
 
-struct cache {
-    unsigned buckets;
-    CacheItem **map;
-    CacheItem *queue_first, **queue_last;
+// Slot of the open-addressing hash map; the hash is stored
+// so that most mismatches are rejected without calling compare_func
+typedef struct {
+    ass_hashcode hash;
+    CacheItem *item;            // NULL if the slot is free
+} CacheSlot;
+
+// Every item belongs to one shard, selected by its hash.
+// Shards are independent: each has its own lock, map and LRU queue,
+// so that threads and renderers sharing a cache rarely contend.
+struct cache_shard {
+    // linear probing with power-of-two size, grown and shrunk
+    // with the number of items; NULL while empty
+    CacheSlot *map;
+    size_t map_mask;            // number of slots - 1
+    size_t map_items;
 
-    const CacheDesc *desc;
+    CacheItem *queue_first, **queue_last;
+    ASS_CachePolicy policy;
 
     size_t cache_size;
+    ASS_CacheStats stats;       // except size
+
+#if CONFIG_THREADS
+    // Guards the map, the stats, the queue, the policy, cache_size
+    // and the links and referenced flags of all items of the shard.
+    // Reference counts are atomic; they can be increased
+    // without holding the lock, but can only reach zero under it.
+    // construct_func and destruct_func are always called without
+    // holding any lock; key_move_func may be called with it held.
+    ASS_Mutex mutex;
+    // Signaled whenever an item finishes construction
+    ASS_Cond cond;
+#endif
+};
+
+struct cache {
+    const CacheDesc *desc;
+    unsigned n_shards;
+    CacheShard *shards;
 };
 
+#if CONFIG_THREADS
+#define CACHE_SHARDS 16
+#else
+#define CACHE_SHARDS 1
+#endif
+#define CACHE_MIN_SLOTS 16
+
 #define CACHE_ALIGN 8
 #define CACHE_ITEM_SIZE ((sizeof(CacheItem) + (CACHE_ALIGN - 1)) & ~(CACHE_ALIGN - 1))
 
@@ -358,6 +401,51 @@ static inline CacheItem *value_to_item(void *value)
     return (CacheItem *) ((char *) value - CACHE_ITEM_SIZE);
 }
 
+static inline void shard_lock(CacheShard *shard)
+{
+#if CONFIG_THREADS
+    ass_mutex_lock(&shard->mutex);
+#endif
+}
+
+static inline void shard_unlock(CacheShard *shard)
+{
+#if CONFIG_THREADS
+    ass_mutex_unlock(&shard->mutex);
+#endif
+}
+
+static inline size_t ref_count_inc(CacheItem *item)
+{
+#if CONFIG_THREADS
+    return ass_atomic_add(&item->ref_count, 1);
+#else
+    return ++item->ref_count;
+#endif
+}
+
+// must be called with the shard locked (if any)
+static inline size_t ref_count_dec(CacheItem *item)
+{
+#if CONFIG_THREADS
+    return ass_atomic_sub(&item->ref_count, 1);
+#else
+    return --item->ref_count;
+#endif
+}
+
+// Decrement the reference count without locking unless it may reach zero
+static inline bool ref_count_dec_fast(CacheItem *item)
+{
+#if CONFIG_THREADS
+    size_t ref_count = ass_atomic_load(&item->ref_count);
+    while (ref_count > 1)
+        if (ass_atomic_cas(&item->ref_count, &ref_count, ref_count - 1))
+            return true;
+#endif
+    return false;
+}
+
 
 // Create a cache with type-specific hash/compare/destruct/size functions
 Cache *ass_cache_create(const CacheDesc *desc)
@@ -365,47 +453,173 @@ Cache *ass_cache_create(const CacheDesc *desc)
     Cache *cache = calloc(1, sizeof(*cache));
     if (!cache)
         return NULL;
-    cache->buckets = 0xFFFF;
-    cache->queue_last = &cache->queue_first;
     cache->desc = desc;
-    cache->map = calloc(cache->buckets, sizeof(CacheItem *));
-    if (!cache->map) {
-        free(cache);
-        return NULL;
+    cache->shards = calloc(CACHE_SHARDS, sizeof(CacheShard));
+    if (!cache->shards)
+        goto fail;
+
+    for (; cache->n_shards < CACHE_SHARDS; cache->n_shards++) {
+        CacheShard *shard = &cache->shards[cache->n_shards];
+        shard->queue_last = &shard->queue_first;
+#if CONFIG_THREADS
+        if (!ass_mutex_init(&shard->mutex))
+            goto fail;
+        if (!ass_cond_init(&shard->cond)) {
+            ass_mutex_destroy(&shard->mutex);
+            goto fail;
+        }
+#endif
     }
 
     return cache;
+
+fail:
+    ass_cache_done(cache);
+    return NULL;
+}
+
+static bool resize_map(CacheShard *shard, size_t n_slots)
+{
+    CacheSlot *map = calloc(n_slots, sizeof(CacheSlot));
+    if (!map)
+        return false;
+
+    size_t mask = n_slots - 1;
+    if (shard->map) {
+        for (size_t i = 0; i <= shard->map_mask; i++) {
+            CacheSlot *slot = &shard->map[i];
+            if (!slot->item)
+                continue;
+            size_t j = slot->hash & mask;
+            while (map[j].item)
+                j = (j + 1) & mask;
+            map[j] = *slot;
+        }
+        free(shard->map);
+    }
+    shard->map = map;
+    shard->map_mask = mask;
+    return true;
+}
+
+// Keep the load factor at most 3/4, fail only if the map is full
+static bool insert_item(CacheShard *shard, CacheItem *item)
+{
+    size_t n_slots = shard->map ? shard->map_mask + 1 : 0;
+    if (4 * (shard->map_items + 1) > 3 * n_slots &&
+            !resize_map(shard, n_slots ? 2 * n_slots : CACHE_MIN_SLOTS) &&
+            shard->map_items + 1 >= n_slots)
+        return false;
+
+    size_t mask = shard->map_mask;
+    size_t i = item->hash & mask;
+    while (shard->map[i].item)
+        i = (i + 1) & mask;
+    shard->map[i].hash = item->hash;
+    shard->map[i].item = item;
+    shard->map_items++;
+    return true;
+}
+
+// Remove an item with backward shift deletion, which keeps
+// every remaining item reachable from its home slot without tombstones
+static void remove_item(CacheShard *shard, CacheItem *item)
+{
+    CacheSlot *map = shard->map;
+    size_t mask = shard->map_mask;
+    size_t i = item->hash & mask;
+    while (map[i].item != item)
+        i = (i + 1) & mask;
+
+    for (size_t j = (i + 1) & mask; map[j].item; j = (j + 1) & mask) {
+        size_t home = map[j].hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            map[i] = map[j];
+            i = j;
+        }
+    }
+    map[i].item = NULL;
+    shard->map_items--;
+}
+
+// Give memory back after many items have been evicted
+static void shrink_map(CacheShard *shard)
+{
+    if (!shard->map)
+        return;
+    size_t n_slots = shard->map_mask + 1;
+    while (n_slots > CACHE_MIN_SLOTS && 8 * shard->map_items < n_slots)
+        n_slots /= 2;
+    if (n_slots <= shard->map_mask)
+        resize_map(shard, n_slots);
+}
+
+// Find an item in the map and make it the most recently used one.
+// With the CLOCK policy, items in the queue are only marked instead,
+// which avoids touching their neighbors.
+// Must be called with the shard locked, may temporarily unlock it.
+static CacheItem *find_item(Cache *cache, CacheShard *shard,
+                            ass_hashcode hash, void *key)
+{
+    const CacheDesc *desc = cache->desc;
+    size_t key_offs = CACHE_ITEM_SIZE + align_cache(desc->value_size);
+#if CONFIG_THREADS
+restart:
+#endif
+    if (!shard->map)
+        return NULL;
+    for (size_t i = hash & shard->map_mask; ; i = (i + 1) & shard->map_mask) {
+        CacheSlot *slot = &shard->map[i];
+        CacheItem *item = slot->item;
+        if (!item)
+            return NULL;
+        if (slot->hash != hash || !desc->compare_func(key, (char *) item + key_offs))
+            continue;
+#if CONFIG_THREADS
+        if (!item->size) {
+            // under construction; the map may change while waiting
+            ass_cond_wait(&shard->cond, &shard->mutex);
+            goto restart;
+        }
+#endif
+        assert(item->size);
+        if (shard->policy == ASS_CACHE_CLOCK && item->queue_prev) {
+            if (!item->referenced)
+                item->referenced = true;
+        } else if (!item->queue_prev || item->queue_next) {
+            if (item->queue_prev) {
+                item->queue_next->queue_prev = item->queue_prev;
+                *item->queue_prev = item->queue_next;
+            } else
+                ref_count_inc(item);
+            *shard->queue_last = item;
+            item->queue_prev = shard->queue_last;
+            shard->queue_last = &item->queue_next;
+            item->queue_next = NULL;
+        }
+        shard->stats.hits++;
+        return item;
+    }
 }
 
 // Retrieve a value corresponding to a particular cache key,
 // creating one if it does not already exist.
 // The returned item is guaranteed to be valid until the next ass_cache_cut call;
 // to extend its lifetime further, call ass_cache_inc_ref().
+// Safe to call concurrently from several threads: if the item is
+// being constructed by another thread, wait for it to be finished.
 void *ass_cache_get(Cache *cache, void *key, void *priv)
 {
     const CacheDesc *desc = cache->desc;
     size_t key_offs = CACHE_ITEM_SIZE + align_cache(desc->value_size);
-    unsigned bucket = desc->hash_func(key, ASS_HASH_INIT) % cache->buckets;
-    CacheItem *item = cache->map[bucket];
-    while (item) {
-        if (desc->compare_func(key, (char *) item + key_offs)) {
-            assert(item->size);
-            if (!item->queue_prev || item->queue_next) {
-                if (item->queue_prev) {
-                    item->queue_next->queue_prev = item->queue_prev;
-                    *item->queue_prev = item->queue_next;
-                } else
-                    item->ref_count++;
-                *cache->queue_last = item;
-                item->queue_prev = cache->queue_last;
-                cache->queue_last = &item->queue_next;
-                item->queue_next = NULL;
-            }
-            desc->key_move_func(NULL, key);
-
-            return (char *) item + CACHE_ITEM_SIZE;
-        }
-        item = item->next;
+    ass_hashcode hash = desc->hash_func(key, ASS_HASH_INIT);
+    CacheShard *shard = &cache->shards[(hash >> 32) % cache->n_shards];
+    shard_lock(shard);
+    CacheItem *item = find_item(cache, shard, hash, key);
+    shard_unlock(shard);
+    if (item) {
+        desc->key_move_func(NULL, key);
+        return (char *) item + CACHE_ITEM_SIZE;
     }
 
     item = malloc(key_offs + desc->key_size);
@@ -413,31 +627,66 @@ void *ass_cache_get(Cache *cache, void *key, void *priv)
         desc->key_move_func(NULL, key);
         return NULL;
     }
-    item->cache = cache;
+    item->shard = shard;
     item->desc = desc;
+    item->hash = hash;
+
+    shard_lock(shard);
+#if CONFIG_THREADS
+    // another thread may have added the same item in the meantime
+    CacheItem *found = find_item(cache, shard, hash, key);
+    if (found) {
+        shard_unlock(shard);
+        desc->key_move_func(NULL, key);
+        free(item);
+        return (char *) found + CACHE_ITEM_SIZE;
+    }
+#endif
+
+    // Publish the item before constructing it, so that other threads
+    // wait for it instead of duplicating the work.
+    // Until then it has zero size and is not in the queue.
+    if (!insert_item(shard, item)) {
+        shard_unlock(shard);
+        desc->key_move_func(NULL, key);
+        free(item);
+        return NULL;
+    }
+    // The key is only moved once the item is known to be new, as the move
+    // takes references and copies data that nothing would release otherwise.
+    // It only increases reference counts atomically and allocates,
+    // so it is safe with the lock held.
     void *new_key = (char *) item + key_offs;
     if (!desc->key_move_func(new_key, key)) {
+        remove_item(shard, item);
+        shard_unlock(shard);
         free(item);
         return NULL;
     }
-    void *value = (char *) item + CACHE_ITEM_SIZE;
-    item->size = desc->construct_func(new_key, value, priv);
-    assert(item->size);
-
-    CacheItem **bucketptr = &cache->map[bucket];
-    if (*bucketptr)
-        (*bucketptr)->prev = &item->next;
-    item->prev = bucketptr;
-    item->next = *bucketptr;
-    *bucketptr = item;
-
-    *cache->queue_last = item;
-    item->queue_prev = cache->queue_last;
-    cache->queue_last = &item->queue_next;
+    item->queue_prev = NULL;
     item->queue_next = NULL;
+    item->size = 0;
     item->ref_count = 1;
+    item->referenced = false;
+    shard->stats.misses++;
+    shard->stats.items++;
+    shard_unlock(shard);
 
-    cache->cache_size += item->size + (item->size == 1 ? 0 : CACHE_ITEM_SIZE);
+    void *value = (char *) item + CACHE_ITEM_SIZE;
+    size_t size = desc->construct_func(new_key, value, priv);
+    assert(size);
+
+    shard_lock(shard);
+    item->size = size;
+    *shard->queue_last = item;
+    item->queue_prev = shard->queue_last;
+    shard->queue_last = &item->queue_next;
+
+    shard->cache_size += item->size + (item->size == 1 ? 0 : CACHE_ITEM_SIZE);
+#if CONFIG_THREADS
+    ass_cond_broadcast(&shard->cond);
+#endif
+    shard_unlock(shard);
     return value;
 }
 
@@ -461,7 +710,7 @@ void ass_cache_inc_ref(void *value)
         return;
     CacheItem *item = value_to_item(value);
     assert(item->size && item->ref_count);
-    item->ref_count++;
+    ref_count_inc(item);
 }
 
 void ass_cache_dec_ref(void *value)
@@ -470,77 +719,195 @@ void ass_cache_dec_ref(void *value)
         return;
     CacheItem *item = value_to_item(value);
     assert(item->size && item->ref_count);
-    if (--item->ref_count)
+    if (ref_count_dec_fast(item))
         return;
 
-    Cache *cache = item->cache;
-    if (cache) {
-        if (item->next)
-            item->next->prev = item->prev;
-        *item->prev = item->next;
+    CacheShard *shard = item->shard;
+    if (shard)
+        shard_lock(shard);
+    if (ref_count_dec(item)) {
+        if (shard)
+            shard_unlock(shard);
+        return;
+    }
 
-        cache->cache_size -= item->size + (item->size == 1 ? 0 : CACHE_ITEM_SIZE);
+    if (shard) {
+        remove_item(shard, item);
+        shard->cache_size -= item->size + (item->size == 1 ? 0 : CACHE_ITEM_SIZE);
+        shard->stats.items--;
+        shard_unlock(shard);
     }
     destroy_item(item->desc, item);
 }
 
-void ass_cache_cut(Cache *cache, size_t max_size)
+size_t ass_cache_size(Cache *cache)
+{
+    size_t size = 0;
+    for (unsigned i = 0; i < cache->n_shards; i++) {
+        CacheShard *shard = &cache->shards[i];
+        shard_lock(shard);
+        size += shard->cache_size;
+        shard_unlock(shard);
+    }
+    return size;
+}
+
+void ass_cache_get_stats(Cache *cache, ASS_CacheStats *stats)
 {
-    if (cache->cache_size <= max_size)
+    memset(stats, 0, sizeof(*stats));
+    for (unsigned i = 0; i < cache->n_shards; i++) {
+        CacheShard *shard = &cache->shards[i];
+        shard_lock(shard);
+        stats->hits += shard->stats.hits;
+        stats->misses += shard->stats.misses;
+        stats->evictions += shard->stats.evictions;
+        stats->items += shard->stats.items;
+        stats->size += shard->cache_size;
+        shard_unlock(shard);
+    }
+}
+
+static void cut_shard(Cache *cache, CacheShard *shard, size_t max_size)
+{
+    shard_lock(shard);
+    if (shard->cache_size <= max_size) {
+        shard_unlock(shard);
         return;
+    }
 
+    // evicted items are collected here and destroyed after unlocking,
+    // as their destructors may release references into other caches
+    CacheItem *evicted = NULL;
     do {
-        CacheItem *item = cache->queue_first;
+        CacheItem *item = shard->queue_first;
         if (!item)
             break;
         assert(item->size);
 
-        cache->queue_first = item->queue_next;
-        if (--item->ref_count) {
-            item->queue_prev = NULL;
+        if (shard->policy == ASS_CACHE_CLOCK && item->referenced) {
+            // second chance: clear the mark and move to the back
+            item->referenced = false;
+            if (!item->queue_next)
+                continue;
+            shard->queue_first = item->queue_next;
+            *shard->queue_last = item;
+            item->queue_prev = shard->queue_last;
+            shard->queue_last = &item->queue_next;
+            item->queue_next = NULL;
             continue;
         }
 
-        if (item->next)
-            item->next->prev = item->prev;
-        *item->prev = item->next;
+        shard->queue_first = item->queue_next;
+        if (ref_count_dec(item)) {
+            item->queue_prev = NULL;
+            continue;
+        }
 
-        cache->cache_size -= item->size + (item->size == 1 ? 0 : CACHE_ITEM_SIZE);
-        destroy_item(cache->desc, item);
-    } while (cache->cache_size > max_size);
-    if (cache->queue_first)
-        cache->queue_first->queue_prev = &cache->queue_first;
+        remove_item(shard, item);
+        shard->cache_size -= item->size + (item->size == 1 ? 0 : CACHE_ITEM_SIZE);
+        shard->stats.items--;
+        shard->stats.evictions++;
+        item->queue_next = evicted;
+        evicted = item;
+    } while (shard->cache_size > max_size);
+    if (shard->queue_first)
+        shard->queue_first->queue_prev = &shard->queue_first;
     else
-        cache->queue_last = &cache->queue_first;
+        shard->queue_last = &shard->queue_first;
+    shrink_map(shard);
+    shard_unlock(shard);
+
+    while (evicted) {
+        CacheItem *next = evicted->queue_next;
+        destroy_item(cache->desc, evicted);
+        evicted = next;
+    }
 }
 
+// The limit applies to the total size of all shards. Only if it's exceeded,
+// every shard gives up its share of the excess in proportion to its size.
+// This is exact for the single-shard case and close to LRU order otherwise,
+// as the hash spreads items of all ages evenly between the shards.
+void ass_cache_cut(Cache *cache, size_t max_size)
+{
+    size_t shard_size[CACHE_SHARDS];
+    size_t total = 0;
+    for (unsigned i = 0; i < cache->n_shards; i++) {
+        CacheShard *shard = &cache->shards[i];
+        shard_lock(shard);
+        shard_size[i] = shard->cache_size;
+        shard_unlock(shard);
+        total += shard_size[i];
+    }
+    if (total <= max_size)
+        return;
+
+    size_t excess = total - max_size, cut = 0, sum = 0;
+    for (unsigned i = 0; i < cache->n_shards; i++) {
+        sum += shard_size[i];
+        size_t next_cut = i + 1 < cache->n_shards ?
+            (size_t) ((double) excess / total * sum) : excess;
+        if (next_cut <= cut)
+            continue;
+        size_t share = FFMIN(next_cut - cut, shard_size[i]);
+        cut = next_cut;
+        cut_shard(cache, &cache->shards[i], shard_size[i] - share);
+    }
+}
+
+void ass_cache_set_policy(Cache *cache, ASS_CachePolicy policy)
+{
+    for (unsigned i = 0; i < cache->n_shards; i++) {
+        CacheShard *shard = &cache->shards[i];
+        shard_lock(shard);
+        shard->policy = policy;
+        shard_unlock(shard);
+    }
+}
+
+// Not thread-safe: no other thread may be using the cache.
 void ass_cache_empty(Cache *cache)
 {
-    for (int i = 0; i < cache->buckets; i++) {
-        CacheItem *item = cache->map[i];
-        while (item) {
+    for (unsigned i = 0; i < cache->n_shards; i++) {
+        CacheShard *shard = &cache->shards[i];
+        for (size_t j = 0; shard->map && j <= shard->map_mask; j++) {
+            CacheItem *item = shard->map[j].item;
+            if (!item)
+                continue;
             assert(item->size);
-            CacheItem *next = item->next;
             if (item->queue_prev)
                 item->ref_count--;
             if (item->ref_count)
-                item->cache = NULL;
+                item->shard = NULL;
             else
                 destroy_item(cache->desc, item);
-            item = next;
         }
-        cache->map[i] = NULL;
+        free(shard->map);
+        shard->map = NULL;
+        shard->map_mask = 0;
+        shard->map_items = 0;
+
+        shard->queue_first = NULL;
+        shard->queue_last = &shard->queue_first;
+        shard->cache_size = 0;
+        shard->stats.items = 0;
     }
-
-    cache->queue_first = NULL;
-    cache->queue_last = &cache->queue_first;
-    cache->cache_size = 0;
 }
 
 void ass_cache_done(Cache *cache)
 {
+    if (!cache)
+        return;
     ass_cache_empty(cache);
-    free(cache->map);
+    for (unsigned i = 0; i < cache->n_shards; i++) {
+        CacheShard *shard = &cache->shards[i];
+#if CONFIG_THREADS
+        ass_cond_destroy(&shard->cond);
+        ass_mutex_destroy(&shard->mutex);
+#endif
+        free(shard->map);
+    }
+    free(cache->shards);
     free(cache);
 }
 
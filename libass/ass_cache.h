@@ -103,7 +103,10 @@ void *ass_cache_get(Cache *cache, void *key, void *priv);
 void *ass_cache_key(void *value);
 void ass_cache_inc_ref(void *value);
 void ass_cache_dec_ref(void *value);
+size_t ass_cache_size(Cache *cache);
+void ass_cache_get_stats(Cache *cache, ASS_CacheStats *stats);
 void ass_cache_cut(Cache *cache, size_t max_size);
+void ass_cache_set_policy(Cache *cache, ASS_CachePolicy policy);
 void ass_cache_empty(Cache *cache);
 void ass_cache_done(Cache *cache);
 Cache *ass_font_cache_create(void);
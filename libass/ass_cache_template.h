@@ -93,6 +93,7 @@ START(glyph, glyph_hash_key)
     GENERIC(int, bold)
     GENERIC(int, italic)
     GENERIC(unsigned, flags) // glyph decoration flags
+    GENERIC(int, hinting)    // ASS_Hinting of the renderer
 END(GlyphHashKey)
 
 // describes an outline drawing
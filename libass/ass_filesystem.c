@@ -53,12 +53,85 @@ static bool alloc_path(ASS_Dir *dir, size_t size)
 #if !defined(_WIN32) || defined(__CYGWIN__)
 
 #include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 FILE *ass_open_file(const char *filename, FileNameSource hint)
 {
     return fopen(filename, "rb");
 }
 
+/**
+ * \brief Map the whole contents of an open file read-only
+ * The mapping stays valid after the file is closed.
+ * \param size out: file size
+ * \return pointer to file contents, or NULL if the file can't be mapped
+ * and has to be read instead. Release with ass_unmap_file.
+ */
+void *ass_map_file(FILE *fp, size_t *size)
+{
+#ifdef HAVE_MMAP
+    struct stat st;
+    int fd = fileno(fp);
+    if (fd < 0 || fstat(fd, &st) || !S_ISREG(st.st_mode) ||
+            st.st_size <= 0 || (uintmax_t) st.st_size > SIZE_MAX)
+        return NULL;
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+        return NULL;
+    *size = st.st_size;
+    return data;
+#else
+    return NULL;
+#endif
+}
+
+void ass_unmap_file(void *data, size_t size)
+{
+#ifdef HAVE_MMAP
+    munmap(data, size);
+#endif
+}
+
+/**
+ * \brief Get the modification time of an open file
+ * The unit is unspecified, the value is only meant to be compared.
+ */
+bool ass_file_mtime(FILE *fp, int64_t *mtime)
+{
+    struct stat st;
+    int fd = fileno(fp);
+    if (fd < 0 || fstat(fd, &st))
+        return false;
+    *mtime = st.st_mtime;
+    return true;
+}
+
+/**
+ * \brief Create a new file for writing
+ * Fails if the file exists already.
+ */
+FILE *ass_create_file(const char *filename)
+{
+    return fopen(filename, "wbx");
+}
+
+/**
+ * \brief Rename a file, replacing the destination if it exists
+ */
+bool ass_replace_file(const char *src, const char *dst)
+{
+    return !rename(src, dst);
+}
+
+unsigned long ass_process_id(void)
+{
+    return getpid();
+}
+
 bool ass_open_dir(ASS_Dir *dir, const char *path)
 {
     dir->handle = NULL;
@@ -118,6 +191,7 @@ void ass_close_dir(ASS_Dir *dir)
 #else  // Windows
 
 #include <windows.h>
+#include <io.h>
 
 
 static const uint8_t wtf8_len_table[256] = {
@@ -249,7 +323,7 @@ static char *convert_wtf16to8(char *dst, const WCHAR *src, size_t wlen)
     return dst;
 }
 
-static FILE *open_file_wtf8(const char *filename)
+static WCHAR *filename_wtf8to16(const char *filename)
 {
     size_t size = sizeof(WCHAR);
     ASS_StringView name = { filename, strlen(filename) };
@@ -259,23 +333,94 @@ static FILE *open_file_wtf8(const char *filename)
     if (!wname)
         return NULL;
     WCHAR *end = convert_wtf8to16(wname, name);
-    FILE *fp = NULL;
-    if (end) {
-        *end = L'\0';
-        fp = _wfopen(wname, L"rb");
+    if (!end) {
+        free(wname);
+        return NULL;
     }
+    *end = L'\0';
+    return wname;
+}
+
+static FILE *open_file_wtf8(const char *filename, const WCHAR *mode)
+{
+    WCHAR *wname = filename_wtf8to16(filename);
+    if (!wname)
+        return NULL;
+    FILE *fp = _wfopen(wname, mode);
     free(wname);
     return fp;
 }
 
 FILE *ass_open_file(const char *filename, FileNameSource hint)
 {
-    FILE *fp = open_file_wtf8(filename);
+    FILE *fp = open_file_wtf8(filename, L"rb");
     if (fp || hint == FN_DIR_LIST)
         return fp;
     return fopen(filename, "rb");
 }
 
+void *ass_map_file(FILE *fp, size_t *size)
+{
+#if ASS_WINAPI_DESKTOP
+    HANDLE file = (HANDLE) _get_osfhandle(_fileno(fp));
+    LARGE_INTEGER file_size;
+    if (file == INVALID_HANDLE_VALUE || GetFileType(file) != FILE_TYPE_DISK ||
+            !GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0 ||
+            (uint64_t) file_size.QuadPart > SIZE_MAX)
+        return NULL;
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+        return NULL;
+    // the view keeps the mapping object alive
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!data)
+        return NULL;
+    *size = file_size.QuadPart;
+    return data;
+#else
+    return NULL;
+#endif
+}
+
+void ass_unmap_file(void *data, size_t size)
+{
+#if ASS_WINAPI_DESKTOP
+    UnmapViewOfFile(data);
+#endif
+}
+
+bool ass_file_mtime(FILE *fp, int64_t *mtime)
+{
+    HANDLE file = (HANDLE) _get_osfhandle(_fileno(fp));
+    FILETIME time;
+    if (file == INVALID_HANDLE_VALUE || !GetFileTime(file, NULL, NULL, &time))
+        return false;
+    *mtime = (int64_t) time.dwHighDateTime << 32 | time.dwLowDateTime;
+    return true;
+}
+
+FILE *ass_create_file(const char *filename)
+{
+    return open_file_wtf8(filename, L"wbx");
+}
+
+bool ass_replace_file(const char *src, const char *dst)
+{
+    WCHAR *wsrc = filename_wtf8to16(src);
+    WCHAR *wdst = filename_wtf8to16(dst);
+    bool ok = wsrc && wdst &&
+        MoveFileExW(wsrc, wdst, MOVEFILE_REPLACE_EXISTING);
+    free(wsrc);
+    free(wdst);
+    return ok;
+}
+
+unsigned long ass_process_id(void)
+{
+    return GetCurrentProcessId();
+}
+
 
 static const WCHAR dir_tail[] = L"\\*";
 
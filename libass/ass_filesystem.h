@@ -18,6 +18,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifndef LIBASS_FILESYSTEM_H
 #define LIBASS_FILESYSTEM_H
@@ -29,6 +30,14 @@ typedef enum {
 
 FILE *ass_open_file(const char *filename, FileNameSource hint);
 
+void *ass_map_file(FILE *fp, size_t *size);
+void ass_unmap_file(void *data, size_t size);
+bool ass_file_mtime(FILE *fp, int64_t *mtime);
+
+FILE *ass_create_file(const char *filename);
+bool ass_replace_file(const char *src, const char *dst);
+unsigned long ass_process_id(void);
+
 typedef struct {
     void *handle;
     char *path;
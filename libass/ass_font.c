@@ -476,7 +476,7 @@ fail:
  */
 ASS_Font *ass_font_new(ASS_Renderer *render_priv, ASS_FontDesc *desc)
 {
-    ASS_Font *font = ass_cache_get(render_priv->cache.font_cache, desc, render_priv);
+    ASS_Font *font = ass_cache_get(render_priv->cache->font_cache, desc, render_priv);
     if (!font)
         return NULL;
     if (font->library)
@@ -491,14 +491,14 @@ size_t ass_font_construct(void *key, void *value, void *priv)
     ASS_Font *font = value;
 
     font->library = render_priv->library;
-    font->ftlibrary = render_priv->ftlibrary;
+    font->ftlibrary = render_priv->shared->ftlibrary;
     font->n_faces = 0;
     font->desc.family = desc->family;
     font->desc.bold = desc->bold;
     font->desc.italic = desc->italic;
     font->desc.vertical = desc->vertical;
 
-    int error = add_face(render_priv->fontselect, font, 0);
+    int error = add_face(render_priv->shared->fontselect, font, 0);
     if (error == -1)
         font->library = NULL;
     return 1;
@@ -522,15 +522,14 @@ bool ass_face_is_postscript(FT_Face face)
 }
 
 /**
- * \brief Get face weight
+ * \brief Convert an OS/2 usWeightClass to a font weight
+ * \param style_flags used if the weight class isn't set
  **/
-int ass_face_get_weight(FT_Face face)
+int ass_os2_get_weight(unsigned weight_class, FT_Long style_flags)
 {
-    TT_OS2 *os2 = FT_Get_Sfnt_Table(face, FT_SFNT_OS2);
-    FT_UShort os2Weight = os2 ? os2->usWeightClass : 0;
-    switch (os2Weight) {
+    switch (weight_class) {
     case 0:
-        return 300 * !!(face->style_flags & FT_STYLE_FLAG_BOLD) + 400;
+        return 300 * !!(style_flags & FT_STYLE_FLAG_BOLD) + 400;
     case 1:
         return 100;
     case 2:
@@ -550,29 +549,38 @@ int ass_face_get_weight(FT_Face face)
     case 9:
         return 900;
     default:
-        return os2Weight;
+        return weight_class;
     }
 }
 
-static FT_Long fsSelection_to_style_flags(uint16_t fsSelection)
+FT_Long ass_os2_get_style_flags(unsigned fs_selection)
 {
     FT_Long ret = 0;
 
-    if (fsSelection & 1)
+    if (fs_selection & 1)
         ret |= FT_STYLE_FLAG_ITALIC;
-    if (fsSelection & (1 << 5))
+    if (fs_selection & (1 << 5))
         ret |= FT_STYLE_FLAG_BOLD;
 
     return ret;
 }
 
+/**
+ * \brief Get face weight
+ **/
+int ass_face_get_weight(FT_Face face)
+{
+    TT_OS2 *os2 = FT_Get_Sfnt_Table(face, FT_SFNT_OS2);
+    return ass_os2_get_weight(os2 ? os2->usWeightClass : 0, face->style_flags);
+}
+
 FT_Long ass_face_get_style_flags(FT_Face face)
 {
     // If we have an OS/2 table, compute this ourselves, since FreeType
     // will mix in some flags that GDI ignores.
     TT_OS2 *os2 = FT_Get_Sfnt_Table(face, FT_SFNT_OS2);
     if (os2)
-        return fsSelection_to_style_flags(os2->fsSelection);
+        return ass_os2_get_style_flags(os2->fsSelection);
 
     return face->style_flags;
 }
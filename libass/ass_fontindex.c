@@ -0,0 +1,556 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "config.h"
+#include "ass_compat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ass_fontindex.h"
+#include "ass_threading.h"
+#include "ass_utils.h"
+
+// The index is only shared between processes on the same machine,
+// so there's no need for a portable hash
+#define WYHASH_LITTLE_ENDIAN 1
+#include "wyhash.h"
+
+/*
+ * The index file consists of a header followed by the entries,
+ * all integers stored in little-endian order:
+ *
+ *   header:  magic (8 bytes), number of entries (u32)
+ *   entry:   size (u64), stamp (u64), path (string),
+ *            face index, number of faces, weight,
+ *            style flags, is_postscript (u32 each),
+ *            PostScript name (string),
+ *            number of families (u32), families (strings),
+ *            number of full names (u32), full names (strings)
+ *   string:  length + 1 (u32, 0 for NULL), characters without terminator
+ *
+ * Any error while reading makes the whole file be ignored; it's then
+ * rebuilt from scratch. The file is never modified in place, but written
+ * to a temporary file first, which then replaces it. Temporary files are
+ * named after the process and a counter, so writers never share one.
+ * Should a crashed writer have left one with the same name behind,
+ * it's never touched and the next number is tried.
+ */
+
+#define INDEX_MAGIC "ASSFIDX1"
+#define INDEX_MAGIC_SIZE 8
+#define INDEX_HASH_SEED 0x5d1e7f4a6c0b3928ULL
+#define INDEX_MAX_ENTRIES 65536
+#define INDEX_MAX_NAMES 100
+#define INDEX_MAX_STRING 4096
+#define INDEX_MAX_TEMP_FILES 16
+
+typedef struct {
+    char *path;
+    uint64_t size, stamp;
+    int face_index, num_faces;
+    ASS_FontProviderMetaData meta;
+    bool used;                  // looked up or added since loading
+} IndexEntry;
+
+struct font_index {
+    ASS_Library *library;
+    char *path;
+
+    // sorted by cmp_entry up to n_sorted, followed by added entries
+    IndexEntry *entries;
+    size_t n_entries, n_sorted, max_entries;
+    bool dirty;
+};
+
+static void free_names(char **names, int n)
+{
+    if (!names)
+        return;
+    for (int i = 0; i < n; i++)
+        free(names[i]);
+    free(names);
+}
+
+static void free_entry(IndexEntry *entry)
+{
+    free(entry->path);
+    free_names(entry->meta.families, entry->meta.n_family);
+    free_names(entry->meta.fullnames, entry->meta.n_fullname);
+    free(entry->meta.postscript_name);
+}
+
+static int cmp_entry(const void *p1, const void *p2)
+{
+    const IndexEntry *e1 = p1, *e2 = p2;
+    if (e1->stamp != e2->stamp)
+        return e1->stamp < e2->stamp ? -1 : 1;
+    if (e1->size != e2->size)
+        return e1->size < e2->size ? -1 : 1;
+    if (e1->face_index != e2->face_index)
+        return e1->face_index < e2->face_index ? -1 : 1;
+    if (!e1->path || !e2->path)
+        return !!e1->path - !!e2->path;
+    return strcmp(e1->path, e2->path);
+}
+
+static void sort_entries(ASS_FontIndex *index)
+{
+    if (index->n_sorted == index->n_entries)
+        return;
+    qsort(index->entries, index->n_entries, sizeof(IndexEntry), cmp_entry);
+    index->n_sorted = index->n_entries;
+}
+
+static IndexEntry *add_entry(ASS_FontIndex *index)
+{
+    if (index->n_entries >= index->max_entries) {
+        size_t max = FFMAX(2 * index->max_entries, 64);
+        if (!ASS_REALLOC_ARRAY(index->entries, max))
+            return NULL;
+        index->max_entries = max;
+    }
+    IndexEntry *entry = &index->entries[index->n_entries];
+    memset(entry, 0, sizeof(*entry));
+    return entry;
+}
+
+
+typedef struct {
+    const unsigned char *pos, *end;
+    bool error;
+} Reader;
+
+static uint32_t read_u32(Reader *r)
+{
+    if (r->error || r->end - r->pos < 4) {
+        r->error = true;
+        return 0;
+    }
+    const unsigned char *p = r->pos;
+    r->pos += 4;
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 |
+           (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static uint64_t read_u64(Reader *r)
+{
+    uint64_t lo = read_u32(r);
+    return lo | (uint64_t) read_u32(r) << 32;
+}
+
+static char *read_string(Reader *r)
+{
+    uint32_t len = read_u32(r);
+    if (!len)
+        return NULL;
+    len--;
+    if (r->error || len > INDEX_MAX_STRING || r->end - r->pos < len) {
+        r->error = true;
+        return NULL;
+    }
+    char *str = malloc(len + 1);
+    if (!str) {
+        r->error = true;
+        return NULL;
+    }
+    memcpy(str, r->pos, len);
+    str[len] = '\0';
+    r->pos += len;
+    return str;
+}
+
+static char **read_names(Reader *r, int *count)
+{
+    uint32_t n = read_u32(r);
+    *count = 0;
+    if (r->error || !n)
+        return NULL;
+    char **names = n <= INDEX_MAX_NAMES ? calloc(n, sizeof(char *)) : NULL;
+    if (!names) {
+        r->error = true;
+        return NULL;
+    }
+    for (; *count < n; ++*count) {
+        names[*count] = read_string(r);
+        if (!names[*count]) {
+            r->error = true;
+            break;
+        }
+    }
+    return names;
+}
+
+static bool read_entry(Reader *r, IndexEntry *entry)
+{
+    entry->size = read_u64(r);
+    entry->stamp = read_u64(r);
+    entry->path = read_string(r);
+    entry->face_index = read_u32(r);
+    entry->num_faces = read_u32(r);
+    ASS_FontProviderMetaData *meta = &entry->meta;
+    meta->weight = read_u32(r);
+    meta->style_flags = read_u32(r);
+    meta->is_postscript = read_u32(r);
+    meta->postscript_name = read_string(r);
+    meta->families = read_names(r, &meta->n_family);
+    meta->fullnames = read_names(r, &meta->n_fullname);
+
+    if (!r->error && meta->n_family && entry->face_index >= 0 &&
+            entry->face_index < entry->num_faces)
+        return true;
+    free_entry(entry);
+    return false;
+}
+
+static bool read_index(ASS_FontIndex *index, const unsigned char *data,
+                       size_t size)
+{
+    Reader r = { data, data + size, false };
+    if (size < INDEX_MAGIC_SIZE || memcmp(data, INDEX_MAGIC, INDEX_MAGIC_SIZE))
+        return false;
+    r.pos += INDEX_MAGIC_SIZE;
+    uint32_t n = read_u32(&r);
+    if (r.error || n > INDEX_MAX_ENTRIES)
+        return false;
+    for (uint32_t i = 0; i < n; i++) {
+        IndexEntry *entry = add_entry(index);
+        if (!entry || !read_entry(&r, entry))
+            return false;
+        index->n_entries++;
+    }
+    return r.pos == r.end;
+}
+
+/**
+ * \brief Load the index from a file
+ * A missing or invalid file results in an empty index,
+ * which will be written to the file when fonts are added.
+ */
+ASS_FontIndex *ass_font_index_load(ASS_Library *library, const char *path)
+{
+    ASS_FontIndex *index = calloc(1, sizeof(ASS_FontIndex));
+    if (!index)
+        return NULL;
+    index->library = library;
+    index->path = strdup(path);
+    if (!index->path) {
+        free(index);
+        return NULL;
+    }
+
+    FILE *fp = ass_open_file(path, FN_EXTERNAL);
+    if (!fp) {
+        ass_msg(library, MSGL_V, "Creating font index '%s'", path);
+        return index;
+    }
+
+    unsigned char *data = NULL;
+    long size = -1;
+    if (!fseek(fp, 0, SEEK_END) && (size = ftell(fp)) >= 0) {
+        rewind(fp);
+        data = malloc(size + 1);
+        if (data && fread(data, 1, size, fp) != size)
+            size = -1;
+    }
+    fclose(fp);
+
+    if (!data || size < 0 || !read_index(index, data, size)) {
+        ass_msg(library, MSGL_WARN, "Ignoring invalid font index '%s'", path);
+        for (size_t i = 0; i < index->n_entries; i++)
+            free_entry(&index->entries[i]);
+        index->n_entries = 0;
+        index->dirty = true;
+    }
+    free(data);
+
+    sort_entries(index);
+    ass_msg(library, MSGL_V, "Loaded font index '%s' with %zu entries",
+            path, index->n_entries);
+    return index;
+}
+
+
+typedef struct {
+    unsigned char *buf;
+    size_t len, size;
+    bool error;
+} Writer;
+
+static void write_bytes(Writer *w, const void *data, size_t len)
+{
+    if (w->error)
+        return;
+    if (w->size - w->len < len) {
+        size_t size = FFMAX(2 * w->size, w->len + len);
+        if (!ASS_REALLOC_ARRAY(w->buf, size)) {
+            w->error = true;
+            return;
+        }
+        w->size = size;
+    }
+    memcpy(w->buf + w->len, data, len);
+    w->len += len;
+}
+
+static void write_u32(Writer *w, uint32_t val)
+{
+    unsigned char buf[4] = { val, val >> 8, val >> 16, val >> 24 };
+    write_bytes(w, buf, sizeof(buf));
+}
+
+static void write_u64(Writer *w, uint64_t val)
+{
+    write_u32(w, val);
+    write_u32(w, val >> 32);
+}
+
+static void write_string(Writer *w, const char *str)
+{
+    if (!str) {
+        write_u32(w, 0);
+        return;
+    }
+    size_t len = FFMIN(strlen(str), INDEX_MAX_STRING);
+    write_u32(w, len + 1);
+    write_bytes(w, str, len);
+}
+
+static void write_names(Writer *w, char *const *names, int n)
+{
+    write_u32(w, n);
+    for (int i = 0; i < n; i++)
+        write_string(w, names[i]);
+}
+
+static void write_entry(Writer *w, const IndexEntry *entry)
+{
+    const ASS_FontProviderMetaData *meta = &entry->meta;
+    write_u64(w, entry->size);
+    write_u64(w, entry->stamp);
+    write_string(w, entry->path);
+    write_u32(w, entry->face_index);
+    write_u32(w, entry->num_faces);
+    write_u32(w, meta->weight);
+    write_u32(w, meta->style_flags);
+    write_u32(w, meta->is_postscript);
+    write_string(w, meta->postscript_name);
+    write_names(w, meta->families, meta->n_family);
+    write_names(w, meta->fullnames, meta->n_fullname);
+}
+
+// numbers temporary files of all indexes of the process
+static size_t temp_counter;
+
+static bool write_file(ASS_FontIndex *index, const Writer *w)
+{
+    size_t size = strlen(index->path) + 48;
+    char *tmp = malloc(size);
+    if (!tmp)
+        return false;
+
+    unsigned long pid = ass_process_id();
+    FILE *fp = NULL;
+    for (int i = 0; i < INDEX_MAX_TEMP_FILES && !fp; i++) {
+#if CONFIG_THREADS
+        size_t n = ass_atomic_add(&temp_counter, 1);
+#else
+        size_t n = ++temp_counter;
+#endif
+        snprintf(tmp, size, "%s.%lu.%zu.tmp", index->path, pid, n);
+        fp = ass_create_file(tmp);
+    }
+    if (!fp) {
+        free(tmp);
+        return false;
+    }
+
+    bool ok = fwrite(w->buf, 1, w->len, fp) == w->len;
+    ok = !fclose(fp) && ok;
+    ok = ok && ass_replace_file(tmp, index->path);
+    if (!ok)
+        remove(tmp);
+    free(tmp);
+    return ok;
+}
+
+/**
+ * \brief Write the index to its file if it has changed
+ * If there are too many entries, those not used since loading are dropped.
+ */
+bool ass_font_index_save(ASS_FontIndex *index)
+{
+    if (!index->dirty)
+        return true;
+
+    size_t n = index->n_entries;
+    if (n > INDEX_MAX_ENTRIES) {
+        size_t n_used = 0;
+        for (size_t i = 0; i < index->n_entries; i++)
+            n_used += index->entries[i].used;
+        n = FFMIN(n_used, INDEX_MAX_ENTRIES);
+    }
+
+    Writer w = {0};
+    write_bytes(&w, INDEX_MAGIC, INDEX_MAGIC_SIZE);
+    write_u32(&w, n);
+    size_t n_written = 0;
+    for (size_t i = 0; i < index->n_entries && n_written < n; i++) {
+        const IndexEntry *entry = &index->entries[i];
+        if (n < index->n_entries && !entry->used)
+            continue;
+        write_entry(&w, entry);
+        n_written++;
+    }
+
+    bool ok = !w.error && write_file(index, &w);
+    free(w.buf);
+    if (!ok) {
+        ass_msg(index->library, MSGL_WARN,
+                "Failed to write font index '%s'", index->path);
+        return false;
+    }
+    ass_msg(index->library, MSGL_V, "Saved font index '%s' with %zu entries",
+            index->path, n);
+    index->dirty = false;
+    return true;
+}
+
+void ass_font_index_free(ASS_FontIndex *index)
+{
+    if (!index)
+        return;
+    for (size_t i = 0; i < index->n_entries; i++)
+        free_entry(&index->entries[i]);
+    free(index->entries);
+    free(index->path);
+    free(index);
+}
+
+
+/**
+ * \brief Get the key identifying a font in the index
+ * Fonts loaded from files are identified by their path, size and
+ * modification time, others by their contents.
+ * The key refers to fd and is only valid as long as it is.
+ */
+void ass_font_index_make_key(ASS_FontIndexKey *key, const ASS_Fontdata *fd)
+{
+    key->path = fd->path;
+    key->size = fd->size;
+    if (fd->path) {
+        key->stamp = fd->mtime;
+        return;
+    }
+    // hash the data as it is stored, encoded fonts with a different seed
+    key->stamp = wyhash(fd->data, ass_font_data_stored_size(fd),
+                        INDEX_HASH_SEED + fd->encoded, _wyp);
+}
+
+/**
+ * \brief Look up the metadata of a face
+ * \param num_faces out: number of faces in the font
+ * \param meta out: metadata, valid until the index is changed
+ */
+bool ass_font_index_find(ASS_FontIndex *index, const ASS_FontIndexKey *key,
+                         int face_index, int *num_faces,
+                         const ASS_FontProviderMetaData **meta)
+{
+    IndexEntry probe = {
+        .path = (char *) key->path,
+        .size = key->size,
+        .stamp = key->stamp,
+        .face_index = face_index,
+    };
+    IndexEntry *entry = NULL;
+    if (index->n_sorted)
+        entry = bsearch(&probe, index->entries, index->n_sorted,
+                        sizeof(IndexEntry), cmp_entry);
+    for (size_t i = index->n_sorted; !entry && i < index->n_entries; i++)
+        if (!cmp_entry(&probe, &index->entries[i]))
+            entry = &index->entries[i];
+    if (!entry)
+        return false;
+
+    entry->used = true;
+    *num_faces = entry->num_faces;
+    *meta = &entry->meta;
+    return true;
+}
+
+static char **copy_names(char *const *names, int n)
+{
+    if (!n)
+        return NULL;
+    char **copy = calloc(n, sizeof(char *));
+    if (!copy)
+        return NULL;
+    for (int i = 0; i < n; i++) {
+        copy[i] = strdup(names[i]);
+        if (!copy[i]) {
+            free_names(copy, i);
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+/**
+ * \brief Add the metadata of a face that isn't in the index yet
+ */
+void ass_font_index_add(ASS_FontIndex *index, const ASS_FontIndexKey *key,
+                        int face_index, int num_faces,
+                        const ASS_FontProviderMetaData *meta)
+{
+    IndexEntry *entry = add_entry(index);
+    if (!entry)
+        return;
+
+    entry->size = key->size;
+    entry->stamp = key->stamp;
+    entry->face_index = face_index;
+    entry->num_faces = num_faces;
+    entry->used = true;
+
+    ASS_FontProviderMetaData *copy = &entry->meta;
+    copy->weight = meta->weight;
+    copy->style_flags = meta->style_flags;
+    copy->is_postscript = meta->is_postscript;
+    copy->n_family = meta->n_family;
+    copy->n_fullname = meta->n_fullname;
+    copy->families = copy_names(meta->families, meta->n_family);
+    copy->fullnames = copy_names(meta->fullnames, meta->n_fullname);
+    if ((key->path && !(entry->path = strdup(key->path))) ||
+            (meta->postscript_name &&
+             !(copy->postscript_name = strdup(meta->postscript_name))) ||
+            !copy->families || (meta->n_fullname && !copy->fullnames)) {
+        if (!copy->families)
+            copy->n_family = 0;
+        if (!copy->fullnames)
+            copy->n_fullname = 0;
+        free_entry(entry);
+        return;
+    }
+
+    index->n_entries++;
+    index->dirty = true;
+    // keep lookups fast while many fonts are added
+    if (index->n_entries - index->n_sorted > 64)
+        sort_entries(index);
+}
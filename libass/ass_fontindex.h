@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef LIBASS_FONTINDEX_H
+#define LIBASS_FONTINDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ass_fontselect.h"
+#include "ass_library.h"
+
+typedef struct font_index ASS_FontIndex;
+
+typedef struct {
+    const char *path;       // NULL if the font is identified by its contents
+    uint64_t size;
+    uint64_t stamp;         // modification time or hash of the contents
+} ASS_FontIndexKey;
+
+ASS_FontIndex *ass_font_index_load(ASS_Library *library, const char *path);
+bool ass_font_index_save(ASS_FontIndex *index);
+void ass_font_index_free(ASS_FontIndex *index);
+
+void ass_font_index_make_key(ASS_FontIndexKey *key, const ASS_Fontdata *fd);
+bool ass_font_index_find(ASS_FontIndex *index, const ASS_FontIndexKey *key,
+                         int face_index, int *num_faces,
+                         const ASS_FontProviderMetaData **meta);
+void ass_font_index_add(ASS_FontIndex *index, const ASS_FontIndexKey *key,
+                        int face_index, int num_faces,
+                        const ASS_FontProviderMetaData *meta);
+
+#endif /* LIBASS_FONTINDEX_H */
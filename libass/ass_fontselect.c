@@ -41,6 +41,7 @@
 #include "ass_library.h"
 #include "ass_filesystem.h"
 #include "ass_fontselect.h"
+#include "ass_fontindex.h"
 #include "ass_fontconfig.h"
 #include "ass_coretext.h"
 #include "ass_directwrite.h"
@@ -82,6 +83,11 @@ struct font_info {
     bool is_postscript;
 };
 
+typedef struct {
+    uint32_t hash;              // ass_strcasehash of one of the font's names
+    int font;                   // index in font_infos
+} FontNameEntry;
+
 struct font_selector {
     ASS_Library *library;
     FT_Library ftlibrary;
@@ -99,8 +105,16 @@ struct font_selector {
     int alloc_font;
     ASS_FontInfo *font_infos;
 
+    // all names of all fonts, sorted by hash and font if names_sorted;
+    // unusable and rebuilt on demand if !names_valid
+    FontNameEntry *names;
+    size_t n_names, max_names;
+    bool names_valid, names_sorted;
+
     ASS_FontProvider *default_provider;
     ASS_FontProvider *embedded_provider;
+
+    ASS_FontIndex *font_index;  // metadata of embedded fonts, if enabled
 };
 
 struct font_provider {
@@ -112,10 +126,50 @@ struct font_provider {
 typedef struct font_data_ft FontDataFT;
 struct font_data_ft {
     ASS_Library *lib;
-    FT_Face face;
+    FT_Library ftlib;
+    FT_Face face;               // opened on the first glyph check
+    bool open_failed;
     int idx;
+    int face_index;
 };
 
+static size_t
+get_data_embedded(void *data, unsigned char *buf, size_t offset, size_t len)
+{
+    FontDataFT *ft = (FontDataFT *)data;
+    ASS_Fontdata *fd = &ft->lib->fontdata[ft->idx];
+
+    if (buf == NULL)
+        return fd->size;
+
+    return ass_read_font_data(fd, buf, offset, len);
+}
+
+static FT_Face open_face_ft(FontDataFT *ft)
+{
+    ASS_Fontdata *fd = &ft->lib->fontdata[ft->idx];
+
+    FT_Face face;
+    if (fd->encoded) {
+        // FreeType reads and decodes only what it needs
+        ASS_FontStream stream = {
+            .func = get_data_embedded,
+            .priv = ft,
+        };
+        face = ass_face_stream(ft->lib, ft->ftlib, fd->name, &stream,
+                               ft->face_index);
+    } else if (FT_New_Memory_Face(ft->ftlib, (unsigned char *) fd->data,
+                                  fd->size, ft->face_index, &face)) {
+        ass_msg(ft->lib, MSGL_WARN, "Error opening memory font '%s'",
+                fd->name);
+        face = NULL;
+    }
+
+    if (face)
+        ass_charmap_magic(ft->lib, face);
+    return face;
+}
+
 static bool check_glyph_ft(void *data, uint32_t codepoint)
 {
     FontDataFT *fd = (FontDataFT *)data;
@@ -123,6 +177,13 @@ static bool check_glyph_ft(void *data, uint32_t codepoint)
     if (!codepoint)
         return true;
 
+    if (!fd->face && !fd->open_failed) {
+        fd->face = open_face_ft(fd);
+        fd->open_failed = !fd->face;
+    }
+    if (!fd->face)
+        return false;
+
     return !!FT_Get_Char_Index(fd->face, codepoint);
 }
 
@@ -130,36 +191,50 @@ static void destroy_font_ft(void *data)
 {
     FontDataFT *fd = (FontDataFT *)data;
 
-    FT_Done_Face(fd->face);
+    if (fd->face)
+        FT_Done_Face(fd->face);
     free(fd);
 }
 
-static size_t
-get_data_embedded(void *data, unsigned char *buf, size_t offset, size_t len)
-{
-    FontDataFT *ft = (FontDataFT *)data;
-    ASS_Fontdata *fd = ft->lib->fontdata;
-    int i = ft->idx;
-
-    if (buf == NULL)
-        return fd[i].size;
-
-    if (offset >= fd[i].size)
-        return 0;
-
-    if (len > fd[i].size - offset)
-        len = fd[i].size - offset;
-
-    memcpy(buf, fd[i].data + offset, len);
-    return len;
-}
-
 static ASS_FontProviderFuncs ft_funcs = {
     .get_data          = get_data_embedded,
     .check_glyph       = check_glyph_ft,
     .destroy_font      = destroy_font_ft,
 };
 
+/**
+ * \brief Add a font file, mapping it instead of reading it if possible
+ * Only the parts FreeType actually reads are then loaded, and the pages
+ * are shared with other processes that use the same fonts.
+ */
+static void add_font_file(ASS_Library *library, const char *name,
+                          const char *path)
+{
+    FILE *fp = ass_open_file(path, FN_DIR_LIST);
+    if (!fp) {
+        ass_msg(library, MSGL_WARN, "Error opening font file '%s'", path);
+        return;
+    }
+    // the file is only identified by its path if it can't have changed
+    // unnoticed, and by its contents otherwise
+    int64_t mtime = 0;
+    bool has_mtime = ass_file_mtime(fp, &mtime);
+    size_t size;
+    void *data = ass_map_file(fp, &size);
+    fclose(fp);
+
+    bool mapped = data;
+    if (!mapped)
+        data = ass_load_file(library, path, FN_DIR_LIST, &size);
+    if (!data || ass_add_font_file(library, name, has_mtime ? path : NULL,
+                                   mtime, data, size, mapped))
+        return;
+    if (mapped)
+        ass_unmap_file(data, size);
+    else
+        free(data);
+}
+
 static void load_fonts_from_dir(ASS_Library *library, const char *dir)
 {
     ASS_Dir d;
@@ -175,12 +250,7 @@ static void load_fonts_from_dir(ASS_Library *library, const char *dir)
         if (!path)
             continue;
         ass_msg(library, MSGL_INFO, "Loading font file '%s'", path);
-        size_t size = 0;
-        void *data = ass_load_file(library, path, FN_DIR_LIST, &size);
-        if (data) {
-            ass_add_font(library, name, data, size);
-            free(data);
-        }
+        add_font_file(library, name, path);
     }
     ass_close_dir(&d);
 }
@@ -370,6 +440,97 @@ static void free_font_info(ASS_FontProviderMetaData *meta)
     }
 }
 
+static bool add_font_name(ASS_FontSelector *selector, const char *name,
+                          int font)
+{
+    if (selector->n_names >= selector->max_names) {
+        size_t max = FFMAX(2 * selector->max_names, 256);
+        if (!ASS_REALLOC_ARRAY(selector->names, max))
+            return false;
+        selector->max_names = max;
+    }
+    FontNameEntry *entry = &selector->names[selector->n_names++];
+    entry->hash = ass_strcasehash(name);
+    entry->font = font;
+    return true;
+}
+
+/**
+ * \brief Add all names find_font can match a font by to the name index
+ */
+static bool add_font_names(ASS_FontSelector *selector, int font)
+{
+    ASS_FontInfo *info = &selector->font_infos[font];
+    for (int i = 0; i < info->n_family; i++)
+        if (!add_font_name(selector, info->families[i], font))
+            return false;
+    for (int i = 0; i < info->n_fullname; i++)
+        if (!add_font_name(selector, info->fullnames[i], font))
+            return false;
+    if (info->extended_family &&
+            !add_font_name(selector, info->extended_family, font))
+        return false;
+    if (info->postscript_name &&
+            !add_font_name(selector, info->postscript_name, font))
+        return false;
+    selector->names_sorted = false;
+    return true;
+}
+
+static int cmp_font_name(const void *p1, const void *p2)
+{
+    const FontNameEntry *e1 = p1, *e2 = p2;
+    if (e1->hash != e2->hash)
+        return e1->hash < e2->hash ? -1 : 1;
+    if (e1->font != e2->font)
+        return e1->font < e2->font ? -1 : 1;
+    return 0;
+}
+
+/**
+ * \brief Make the name index usable, rebuilding it if necessary
+ */
+static bool update_font_names(ASS_FontSelector *selector)
+{
+    if (!selector->names_valid) {
+        selector->n_names = 0;
+        for (int i = 0; i < selector->n_font; i++)
+            if (!add_font_names(selector, i))
+                return false;
+        selector->names_valid = true;
+    }
+    if (!selector->names_sorted) {
+        qsort(selector->names, selector->n_names, sizeof(FontNameEntry),
+              cmp_font_name);
+        selector->names_sorted = true;
+    }
+    return true;
+}
+
+/**
+ * \brief Find the fonts that may have the given name
+ * The returned entries are ordered by font and include all fonts
+ * with that name, but also fonts whose names merely have the same hash.
+ */
+static const FontNameEntry *
+find_font_names(ASS_FontSelector *selector, const char *name, size_t *n)
+{
+    uint32_t hash = ass_strcasehash(name);
+    size_t lo = 0, hi = selector->n_names;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (selector->names[mid].hash < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    size_t end = lo;
+    while (end < selector->n_names && selector->names[end].hash == hash)
+        end++;
+    *n = end - lo;
+    return selector->names + lo;
+}
+
 /**
  * \brief Add a font to a font provider.
  * \param provider the font provider
@@ -510,6 +671,9 @@ ass_font_provider_add_font(ASS_FontProvider *provider,
     info->priv  = data;
     info->provider = provider;
 
+    if (selector->names_valid &&
+            !add_font_names(selector, selector->n_font))
+        selector->names_valid = false;
     selector->n_font++;
 
     free_font_info(&implicit_meta);
@@ -552,6 +716,7 @@ static void ass_fontselect_cleanup(ASS_FontSelector *selector)
     }
 
     selector->n_font = w;
+    selector->names_valid = false;
 }
 
 void ass_font_provider_free(ASS_FontProvider *provider)
@@ -723,12 +888,27 @@ find_font(ASS_FontSelector *priv,
     req.style_flags = (italic ? FT_STYLE_FLAG_ITALIC : 0);
     req.weight      = bold;
 
+    // Only look at fonts that have one of the names if there is an index
+    bool use_index = update_font_names(priv);
+
     // Match font family name against font list
     unsigned score_min = UINT_MAX;
     for (int i = 0; i < meta.n_fullname; i++) {
         const char *fullname = meta.fullnames[i];
 
-        for (int x = 0; x < priv->n_font; x++) {
+        const FontNameEntry *candidates = NULL;
+        size_t n_candidates = priv->n_font;
+        if (use_index)
+            candidates = find_font_names(priv, fullname, &n_candidates);
+
+        for (size_t c = 0; c < n_candidates; c++) {
+            int x = c;
+            if (use_index) {
+                x = candidates[c].font;
+                // a font is listed once for every name with this hash
+                if (c && candidates[c - 1].font == x)
+                    continue;
+            }
             ASS_FontInfo *font = &priv->font_infos[x];
             unsigned score = UINT_MAX;
 
@@ -941,69 +1121,369 @@ char *ass_font_select(ASS_FontSelector *priv,
 }
 
 
+#define SFNT_TAG(a, b, c, d) \
+    ((uint32_t) (a) << 24 | (uint32_t) (b) << 16 | (uint32_t) (c) << 8 | (d))
+
+#define SFNT_MAX_TABLES 1024
+#define SFNT_MAX_NAMES  4096
+// longer UTF-16 names don't fit in the conversion buffer anyway
+#define SFNT_MAX_NAME_LEN 2048
+
+static inline uint16_t sfnt_u16(const unsigned char *p)
+{
+    return p[0] << 8 | p[1];
+}
+
+static inline uint32_t sfnt_u32(const unsigned char *p)
+{
+    return (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | p[2] << 8 | p[3];
+}
+
+typedef struct {
+    uint32_t offset, length;
+} SfntTable;
+
+typedef struct {
+    const ASS_Fontdata *fd;
+    unsigned char *buf;
+    size_t buf_size;
+} SfntReader;
+
+/**
+ * \brief Read a range of the font into the reader's buffer
+ * \return pointer to the data, or NULL if it's out of bounds
+ */
+static const unsigned char *sfnt_read(SfntReader *r, size_t offset,
+                                      size_t len)
+{
+    if (len > r->buf_size) {
+        if (!ASS_REALLOC_ARRAY(r->buf, len))
+            return NULL;
+        r->buf_size = len;
+    }
+    if (ass_read_font_data(r->fd, r->buf, offset, len) != len)
+        return NULL;
+    return r->buf;
+}
+
+static bool sfnt_is_postscript(unsigned char c)
+{
+    return c >= 33 && c <= 126 && !strchr("[](){}<>/%", c);
+}
+
+/**
+ * \brief Read a PostScript name the way FreeType does
+ * Names with characters not allowed in PostScript names are rejected.
+ */
+static char *sfnt_read_ps_name(SfntReader *r, size_t offset, size_t len,
+                               bool utf16)
+{
+    const unsigned char *p = sfnt_read(r, offset, len);
+    if (!p)
+        return NULL;
+    size_t step = utf16 ? 2 : 1;
+    char *name = malloc(len / step + 1), *q = name;
+    if (!name)
+        return NULL;
+    for (size_t i = 0; i + step <= len; i += step) {
+        unsigned char c = p[i + step - 1];
+        if ((utf16 && p[i]) || !sfnt_is_postscript(c)) {
+            free(name);
+            return NULL;
+        }
+        *q++ = c;
+    }
+    *q = '\0';
+    return name;
+}
+
+/**
+ * \brief Collect metadata from the name and OS/2 tables of a face
+ * This is much cheaper than opening the face with FreeType, which loads
+ * and checks many more tables, and it only touches those two tables of
+ * encoded fonts. It's equivalent to get_font_info for plain OpenType
+ * and TrueType fonts and gives up on anything else.
+ * \param face_index face to read, must be less than *num_faces
+ * \param num_faces out: number of faces in the file
+ * \return success; on failure FreeType has to be asked instead
+ */
+static bool scan_sfnt_info(const ASS_Fontdata *fd, int face_index,
+                           int *num_faces, ASS_FontProviderMetaData *info)
+{
+    SfntReader r = { .fd = fd };
+    int num_family = 0, num_fullname = 0;
+    char *families[MAX_FULLNAME];
+    char *fullnames[MAX_FULLNAME];
+    char *postscript_name = NULL;
+    const unsigned char *p;
+
+    if (!(p = sfnt_read(&r, 0, 12)))
+        goto fail;
+    uint32_t offset = 0;
+    if (sfnt_u32(p) == SFNT_TAG('t', 't', 'c', 'f')) {
+        uint32_t n = sfnt_u32(p + 8);
+        if (!n || n > INT_MAX)
+            goto fail;
+        *num_faces = n;
+        if (face_index >= n || !(p = sfnt_read(&r, 12 + 4 * face_index, 4)))
+            goto fail;
+        offset = sfnt_u32(p);
+        if (!(p = sfnt_read(&r, offset, 12)))
+            goto fail;
+    } else {
+        *num_faces = 1;
+    }
+
+    uint32_t version = sfnt_u32(p);
+    bool is_cff = version == SFNT_TAG('O', 'T', 'T', 'O');
+    if (!is_cff && version != 0x00010000 && version != SFNT_TAG('t', 'r', 'u', 'e'))
+        goto fail;
+    unsigned num_tables = sfnt_u16(p + 4);
+    if (num_tables > SFNT_MAX_TABLES ||
+            !(p = sfnt_read(&r, offset + 12, 16 * num_tables)))
+        goto fail;
+
+    SfntTable name = {0}, os2 = {0};
+    unsigned required = 0;
+    for (unsigned i = 0; i < num_tables; i++, p += 16) {
+        SfntTable table = { sfnt_u32(p + 8), sfnt_u32(p + 12) };
+        switch (sfnt_u32(p)) {
+        case SFNT_TAG('n', 'a', 'm', 'e'):
+            name = table;
+            break;
+        case SFNT_TAG('O', 'S', '/', '2'):
+            os2 = table;
+            break;
+        case SFNT_TAG('h', 'e', 'a', 'd'):
+        case SFNT_TAG('m', 'a', 'x', 'p'):
+        case SFNT_TAG('c', 'm', 'a', 'p'):
+            required++;
+            break;
+        case SFNT_TAG('C', 'F', 'F', ' '):
+        case SFNT_TAG('g', 'l', 'y', 'f'):
+            if (is_cff == (sfnt_u32(p) == SFNT_TAG('C', 'F', 'F', ' ')))
+                required++;
+            break;
+        case SFNT_TAG('C', 'F', 'F', '2'):
+        case SFNT_TAG('f', 'v', 'a', 'r'):
+            // variable fonts get synthesized names
+            goto fail;
+        }
+    }
+    // FreeType ignores OS/2 tables shorter than version 0
+    if (required != 4 || !name.length || os2.length < 78)
+        goto fail;
+
+    if (!(p = sfnt_read(&r, os2.offset, 64)))
+        goto fail;
+    info->style_flags = ass_os2_get_style_flags(sfnt_u16(p + 62));
+    info->weight = ass_os2_get_weight(sfnt_u16(p + 4), info->style_flags);
+    info->is_postscript = is_cff;
+
+    if (!(p = sfnt_read(&r, name.offset, 6)))
+        goto fail;
+    // format 1 adds language tags, leave it to FreeType
+    unsigned format = sfnt_u16(p);
+    unsigned num_names = sfnt_u16(p + 2);
+    size_t storage = sfnt_u16(p + 4);
+    size_t records_size = 12 * num_names;
+    // strings must lie behind the records, as in FreeType's tt_face_load_name
+    size_t storage_start = 6 + records_size;
+    if (format != 0 || num_names > SFNT_MAX_NAMES ||
+            storage > name.length || storage_start > name.length)
+        goto fail;
+    unsigned char *records = malloc(records_size);
+    if (!records || !(p = sfnt_read(&r, name.offset + 6, records_size))) {
+        free(records);
+        goto fail;
+    }
+    memcpy(records, p, records_size);
+
+    int ps_win = -1, ps_apple = -1;
+    for (unsigned i = 0; i < num_names; i++) {
+        const unsigned char *rec = records + 12 * i;
+        unsigned platform = sfnt_u16(rec), encoding = sfnt_u16(rec + 2);
+        unsigned language = sfnt_u16(rec + 4), name_id = sfnt_u16(rec + 6);
+        size_t len = sfnt_u16(rec + 8), pos = storage + sfnt_u16(rec + 10);
+        bool valid = len && pos >= storage_start && pos <= name.length &&
+                     len <= name.length - pos;
+
+        if (name_id == TT_NAME_ID_PS_NAME) {
+            // same choice as FreeType's sfnt_get_name_id: US English
+            // or else the first language found
+            if (!valid)
+                continue;
+            if (platform == TT_PLATFORM_MICROSOFT &&
+                    (encoding == TT_MS_ID_SYMBOL_CS ||
+                     encoding == TT_MS_ID_UNICODE_CS) &&
+                    (language == TT_MS_LANGID_ENGLISH_UNITED_STATES || ps_win < 0))
+                ps_win = i;
+            if (platform == TT_PLATFORM_MACINTOSH &&
+                    encoding == TT_MAC_ID_ROMAN &&
+                    (language == TT_MAC_LANGID_ENGLISH || ps_apple < 0))
+                ps_apple = i;
+            continue;
+        }
+
+        if (platform != TT_PLATFORM_MICROSOFT)
+            continue;
+        bool is_family = name_id == TT_NAME_ID_FONT_FAMILY &&
+                         num_family < MAX_FULLNAME;
+        bool is_fullname = name_id == TT_NAME_ID_FULL_NAME &&
+                           num_fullname < MAX_FULLNAME;
+        if (!is_family && !is_fullname)
+            continue;
+        // FreeType reports these as empty names, leave them to it
+        if (!valid)
+            goto fail_records;
+
+        len = FFMIN(len, SFNT_MAX_NAME_LEN);
+        if (!(p = sfnt_read(&r, name.offset + pos, len)))
+            continue;
+        char buf[1024];
+        ass_utf16be_to_utf8(buf, sizeof(buf), (uint8_t *) p, len);
+        char *str = strdup(buf);
+        if (!str)
+            goto fail_records;
+        if (is_family)
+            families[num_family++] = str;
+        else
+            fullnames[num_fullname++] = str;
+    }
+
+    // the family name FreeType would fall back to may come
+    // from other platforms, so leave this case to FreeType
+    if (!num_family)
+        goto fail_records;
+
+    for (int i = 0; i < 2 && !postscript_name; i++) {
+        int idx = i ? ps_apple : ps_win;
+        if (idx < 0)
+            continue;
+        const unsigned char *rec = records + 12 * idx;
+        size_t len = sfnt_u16(rec + 8), pos = storage + sfnt_u16(rec + 10);
+        postscript_name = sfnt_read_ps_name(&r, name.offset + pos, len, !i);
+    }
+    // FreeType may still find a name elsewhere, e.g. in the CFF table
+    if (!postscript_name)
+        goto fail_records;
+    free(records);
+    free(r.buf);
+
+    info->families = malloc(num_family * sizeof(char *));
+    info->fullnames = num_fullname ? malloc(num_fullname * sizeof(char *)) : NULL;
+    if (!info->families || (num_fullname && !info->fullnames)) {
+        free(info->families);
+        free(info->fullnames);
+        info->families = info->fullnames = NULL;
+        goto fail_names;
+    }
+    memcpy(info->families, families, num_family * sizeof(char *));
+    if (num_fullname)
+        memcpy(info->fullnames, fullnames, num_fullname * sizeof(char *));
+    info->n_family = num_family;
+    info->n_fullname = num_fullname;
+    info->postscript_name = postscript_name;
+    return true;
+
+fail_records:
+    free(records);
+fail:
+    free(r.buf);
+fail_names:
+    for (int i = 0; i < num_family; i++)
+        free(families[i]);
+    for (int i = 0; i < num_fullname; i++)
+        free(fullnames[i]);
+    free(postscript_name);
+    return false;
+}
+
 /**
  * \brief Process memory font.
  * \param priv private data
  * \param idx index of the processed font in priv->library->fontdata
  *
- * Builds a FontInfo with FreeType and some table reading.
+ * Takes the FontInfo from the font index if it's known there. Otherwise
+ * builds it from the font's tables where possible, and with FreeType
+ * if not. Faces are only opened when they are actually needed, except
+ * when FreeType was used here.
 */
 static void process_fontdata(ASS_FontProvider *priv, int idx)
 {
     ASS_FontSelector *selector = priv->parent;
     ASS_Library *library = selector->library;
-
-    int rc;
     const char *name = library->fontdata[idx].name;
-    const char *data = library->fontdata[idx].data;
-    int data_size = library->fontdata[idx].size;
 
-    FT_Face face;
+    ASS_FontIndex *index = selector->font_index;
+    ASS_FontIndexKey key;
+    if (index)
+        ass_font_index_make_key(&key, &library->fontdata[idx]);
+
     int face_index, num_faces = 1;
 
     for (face_index = 0; face_index < num_faces; ++face_index) {
         ASS_FontProviderMetaData info;
+        const ASS_FontProviderMetaData *indexed;
         FontDataFT *ft;
 
-        rc = FT_New_Memory_Face(selector->ftlibrary, (unsigned char *) data,
-                                data_size, face_index, &face);
-        if (rc) {
-            ass_msg(library, MSGL_WARN, "Error opening memory font '%s'",
-                   name);
+        ft = calloc(1, sizeof(FontDataFT));
+        if (ft == NULL)
             continue;
-        }
-
-        num_faces = face->num_faces;
 
-        ass_charmap_magic(library, face);
-
-        memset(&info, 0, sizeof(ASS_FontProviderMetaData));
-        if (!get_font_info(selector->ftlibrary, face, NULL, &info)) {
-            ass_msg(library, MSGL_WARN,
-                    "Error getting metadata for embedded font '%s'", name);
-            FT_Done_Face(face);
+        ft->lib  = library;
+        ft->ftlib = selector->ftlibrary;
+        ft->idx  = idx;
+        ft->face_index = face_index;
+
+        if (index && ass_font_index_find(index, &key, face_index,
+                                         &num_faces, &indexed)) {
+            // owned by the index
+            info = *indexed;
+            if (!ass_font_provider_add_font(priv, &info, NULL, face_index, ft))
+                ass_msg(library, MSGL_WARN,
+                        "Failed to add embedded font '%s'", name);
             continue;
         }
 
-        ft = calloc(1, sizeof(FontDataFT));
+        memset(&info, 0, sizeof(ASS_FontProviderMetaData));
+        char *scanned_ps_name = NULL;
+        if (scan_sfnt_info(&library->fontdata[idx], face_index,
+                           &num_faces, &info)) {
+            scanned_ps_name = info.postscript_name;
+        } else {
+            FT_Face face = open_face_ft(ft);
+            if (!face) {
+                free(ft);
+                continue;
+            }
 
-        if (ft == NULL) {
-            free_font_info(&info);
-            FT_Done_Face(face);
-            continue;
+            num_faces = face->num_faces;
+
+            memset(&info, 0, sizeof(ASS_FontProviderMetaData));
+            if (!get_font_info(selector->ftlibrary, face, NULL, &info)) {
+                ass_msg(library, MSGL_WARN,
+                        "Error getting metadata for embedded font '%s'", name);
+                FT_Done_Face(face);
+                free(ft);
+                continue;
+            }
+
+            // the postscript name belongs to the face, so keep it
+            ft->face = face;
         }
 
-        ft->lib  = library;
-        ft->face = face;
-        ft->idx  = idx;
+        if (index)
+            ass_font_index_add(index, &key, face_index, num_faces, &info);
 
         if (!ass_font_provider_add_font(priv, &info, NULL, face_index, ft)) {
+            // ft has been destroyed along with its face
             ass_msg(library, MSGL_WARN, "Failed to add embedded font '%s'",
                     name);
-            free(ft);
         }
 
         free_font_info(&info);
+        free(scanned_ps_name);
     }
 }
 
@@ -1026,10 +1506,16 @@ ass_embedded_fonts_add_provider(ASS_FontSelector *selector, size_t *num_emfonts)
         load_fonts_from_dir(lib, lib->fonts_dir);
     }
 
+    if (lib->font_index_file && lib->font_index_file[0])
+        selector->font_index = ass_font_index_load(lib, lib->font_index_file);
+
     for (size_t i = 0; i < lib->num_fontdata; i++)
         process_fontdata(priv, i);
     *num_emfonts = lib->num_fontdata;
 
+    if (selector->font_index)
+        ass_font_index_save(selector->font_index);
+
     return priv;
 }
 
@@ -1166,8 +1652,10 @@ void ass_fontselect_free(ASS_FontSelector *priv)
         ass_font_provider_free(priv->embedded_provider);
 
     free(priv->font_infos);
+    free(priv->names);
     free(priv->path_default);
     free(priv->family_default);
+    ass_font_index_free(priv->font_index);
 
     free(priv);
 }
@@ -1196,5 +1684,7 @@ size_t ass_update_embedded_fonts(ASS_FontSelector *selector, size_t num_loaded)
     size_t num_fontdata = selector->library->num_fontdata;
     for (size_t i = num_loaded; i < num_fontdata; i++)
         process_fontdata(selector->embedded_provider, i);
+    if (selector->font_index)
+        ass_font_index_save(selector->font_index);
     return num_fontdata;
 }
@@ -20,6 +20,7 @@
 #include "ass_compat.h"
 
 #include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -58,6 +59,7 @@ void ass_library_done(ASS_Library *priv)
 {
     if (priv) {
         ass_set_fonts_dir(priv, NULL);
+        ass_set_font_index_file(priv, NULL);
         ass_set_style_overrides(priv, NULL);
         ass_clear_fonts(priv);
         free(priv);
@@ -71,6 +73,13 @@ void ass_set_fonts_dir(ASS_Library *priv, const char *fonts_dir)
     priv->fonts_dir = fonts_dir ? strdup(fonts_dir) : 0;
 }
 
+void ass_set_font_index_file(ASS_Library *priv, const char *path)
+{
+    free(priv->font_index_file);
+
+    priv->font_index_file = path ? strdup(path) : 0;
+}
+
 void ass_set_extract_fonts(ASS_Library *priv, int extract)
 {
     priv->extract_fonts = !!extract;
@@ -103,38 +112,157 @@ void ass_set_style_overrides(ASS_Library *priv, char **list)
         *q = strdup(*p);
 }
 
-void ass_add_font(ASS_Library *priv, const char *name, const char *data, int size)
+static ASS_Fontdata *alloc_fontdata(ASS_Library *priv, const char *name)
 {
     size_t idx = priv->num_fontdata;
-    if (!name || !data || !size)
-        return;
     if (!(idx & (idx - 32)) && // power of two >= 32, or zero --> time for realloc
             !ASS_REALLOC_ARRAY(priv->fontdata, FFMAX(2 * idx, 32)))
+        return NULL;
+
+    ASS_Fontdata *fd = &priv->fontdata[idx];
+    fd->name = strdup(name);
+    if (!fd->name)
+        return NULL;
+    fd->data = NULL;
+    fd->size = 0;
+    fd->mapped = false;
+    fd->encoded = false;
+    fd->path = NULL;
+    fd->mtime = 0;
+    return fd;
+}
+
+void ass_add_font(ASS_Library *priv, const char *name, const char *data, int size)
+{
+    if (!name || !data || !size)
+        return;
+    ASS_Fontdata *fd = alloc_fontdata(priv, name);
+    if (!fd)
         return;
 
-    priv->fontdata[idx].name = strdup(name);
-    priv->fontdata[idx].data = malloc(size);
+    fd->data = malloc(size);
+    if (!fd->data) {
+        free(fd->name);
+        return;
+    }
+    memcpy(fd->data, data, size);
+    fd->size = size;
 
-    if (!priv->fontdata[idx].name || !priv->fontdata[idx].data)
-        goto error;
+    priv->num_fontdata++;
+}
 
-    memcpy(priv->fontdata[idx].data, data, size);
+/**
+ * \brief Add a font loaded from a file without copying it
+ * On success, the library takes ownership of data.
+ * \param path the file, used to recognize the font later, or NULL
+ * \param mtime modification time of the file
+ * \param mapped whether data is a file mapping rather than an allocation
+ */
+bool ass_add_font_file(ASS_Library *priv, const char *name,
+                       const char *path, int64_t mtime,
+                       void *data, size_t size, bool mapped)
+{
+    if (!size || size > INT_MAX)
+        return false;
+    ASS_Fontdata *fd = alloc_fontdata(priv, name);
+    if (!fd)
+        return false;
+    if (path && !(fd->path = strdup(path))) {
+        free(fd->name);
+        return false;
+    }
+
+    fd->data = data;
+    fd->size = size;
+    fd->mapped = mapped;
+    fd->mtime = mtime;
+
+    priv->num_fontdata++;
+    return true;
+}
 
-    priv->fontdata[idx].size = size;
+/**
+ * \brief Add a font in the encoding used in [Fonts] sections
+ * On success, the library takes ownership of data.
+ * \param len number of encoded characters
+ */
+bool ass_add_encoded_font(ASS_Library *priv, const char *name,
+                          char *data, size_t len)
+{
+    size_t size = len / 4 * 3 + (len % 4 ? len % 4 - 1 : 0);
+    if (!size || size > INT_MAX)
+        return false;
+    ASS_Fontdata *fd = alloc_fontdata(priv, name);
+    if (!fd)
+        return false;
+
+    char *shrunk = realloc(data, len);
+    fd->data = shrunk ? shrunk : data;
+    fd->size = size;
+    fd->encoded = true;
 
     priv->num_fontdata++;
-    return;
+    return true;
+}
 
-error:
-    free(priv->fontdata[idx].name);
-    free(priv->fontdata[idx].data);
+static void decode_chars(const unsigned char *src, unsigned char *dst,
+                         size_t cnt_in)
+{
+    uint32_t value = 0;
+    for (size_t i = 0; i < cnt_in; i++)
+        value |= (uint32_t) ((src[i] - 33u) & 63) << 6 * (3 - i);
+
+    *dst++ = value >> 16;
+    if (cnt_in >= 3)
+        *dst++ = value >> 8 & 0xff;
+    if (cnt_in >= 4)
+        *dst++ = value & 0xff;
+}
+
+/**
+ * \brief Read a range of the decoded contents of a font
+ * Encoded fonts are decoded just as far as needed.
+ * \return number of bytes read
+ */
+size_t ass_read_font_data(const ASS_Fontdata *fd, unsigned char *buf,
+                          size_t offset, size_t len)
+{
+    size_t size = fd->size;
+    if (offset >= size)
+        return 0;
+    len = FFMIN(len, size - offset);
+
+    if (!fd->encoded) {
+        memcpy(buf, fd->data + offset, len);
+        return len;
+    }
+
+    const unsigned char *src = (const unsigned char *) fd->data;
+    size_t n_chars = ass_font_data_stored_size(fd);
+    size_t pos = offset / 3 * 4, skip = offset % 3;
+    unsigned char *dst = buf, *end = buf + len;
+    while (dst < end) {
+        unsigned char group[3];
+        decode_chars(src + pos, group, FFMIN(n_chars - pos, 4));
+        size_t n = FFMIN(3 - skip, (size_t) (end - dst));
+        memcpy(dst, group + skip, n);
+        dst += n;
+        pos += 4;
+        skip = 0;
+    }
+    return len;
 }
 
 void ass_clear_fonts(ASS_Library *priv)
 {
     for (size_t i = 0; i < priv->num_fontdata; i++) {
-        free(priv->fontdata[i].name);
-        free(priv->fontdata[i].data);
+        ASS_Fontdata *fd = &priv->fontdata[i];
+        free(fd->name);
+        free(fd->path);
+        if (fd->mapped)
+            ass_unmap_file(fd->data, fd->size);
+        else
+            free(fd->data);
     }
     free(priv->fontdata);
     priv->fontdata = NULL;
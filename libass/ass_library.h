@@ -26,11 +26,16 @@
 typedef struct {
     char *name;
     char *data;
-    int size;
+    int size;       // decoded size
+    bool mapped;    // data is a file mapping rather than an allocation
+    bool encoded;   // data is still encoded as in [Fonts] sections
+    char *path;     // file the font was loaded from, or NULL
+    int64_t mtime;  // modification time of that file
 } ASS_Fontdata;
 
 struct ass_library {
     char *fonts_dir;
+    char *font_index_file;
     int extract_fonts;
     char **style_overrides;
 
@@ -41,5 +46,25 @@ struct ass_library {
 };
 
 char *ass_load_file(struct ass_library *library, const char *fname, FileNameSource hint, size_t *bufsize);
+bool ass_add_font_file(struct ass_library *library, const char *name,
+                       const char *path, int64_t mtime,
+                       void *data, size_t size, bool mapped);
+bool ass_add_encoded_font(struct ass_library *library, const char *name,
+                          char *data, size_t len);
+size_t ass_read_font_data(const ASS_Fontdata *fd, unsigned char *buf,
+                          size_t offset, size_t len);
+
+/**
+ * \brief Get the size of the data as it is stored
+ */
+static inline size_t ass_font_data_stored_size(const ASS_Fontdata *fd)
+{
+    size_t size = fd->size;
+    if (!fd->encoded)
+        return size;
+    // every group of 4 characters encodes 3 bytes,
+    // a trailing group of n characters encodes n - 1 bytes
+    return size / 3 * 4 + (size % 3 ? size % 3 + 1 : 0);
+}
 
 #endif                          /* LIBASS_LIBRARY_H */
@@ -271,6 +271,34 @@ void ass_outline_add_rect(ASS_Outline *outline,
 }
 
 
+/*
+ * \brief Make room for additional points and segments
+ * Outline should be allocated and will be enlarged if needed.
+ */
+bool ass_outline_reserve(ASS_Outline *outline, size_t n_points, size_t n_segments)
+{
+    assert(outline->max_points && outline->max_segments);
+
+    size_t new_size = outline->max_points;
+    while (new_size - outline->n_points < n_points)
+        new_size *= 2;
+    if (new_size != outline->max_points) {
+        if (!ASS_REALLOC_ARRAY(outline->points, new_size))
+            return false;
+        outline->max_points = new_size;
+    }
+
+    new_size = outline->max_segments;
+    while (new_size - outline->n_segments < n_segments)
+        new_size *= 2;
+    if (new_size != outline->max_segments) {
+        if (!ASS_REALLOC_ARRAY(outline->segments, new_size))
+            return false;
+        outline->max_segments = new_size;
+    }
+    return true;
+}
+
 /*
  * \brief Add a single point to the outline
  * Outline should be allocated and will be enlarged if needed.
@@ -550,6 +578,13 @@ typedef struct {
     double len;
 } Normal;
 
+// number of last arc subdivision levels done in one batch, see process_arc();
+// 0 emits the points one by one and serves as a reference in unittest/
+#ifndef ARC_BATCH_ORDER
+#define ARC_BATCH_ORDER 5
+#endif
+#define ARC_BATCH_SIZE (1 << ARC_BATCH_ORDER)  // points in batch of arc subdivisions
+
 typedef struct {
     ASS_Outline *result[2];   // result outlines
     size_t contour_first[2];  // start position of last contours
@@ -658,6 +693,53 @@ static void fix_first_point(StrokerState *str, ASS_Vector pt,
     }
 }
 
+/**
+ * \brief Add points of subdivided circular arc to one or two border outlines
+ * \param str stroker state
+ * \param pt center point
+ * \param nx, ny offsets in normal space, every even one starts a quadratic spline
+ * \param n number of points
+ * \param dir destination outline flags
+ * \return false on allocation failure
+ */
+static bool emit_arc_points(StrokerState *str, ASS_Vector pt,
+                            const double *nx, const double *ny, int n, int dir)
+{
+    int32_t dx[ARC_BATCH_SIZE], dy[ARC_BATCH_SIZE];
+    for (int i = 0; i < n; i++) {
+        dx[i] = (int32_t) (str->xbord * nx[i]);
+        dy[i] = (int32_t) (str->ybord * ny[i]);
+    }
+
+    for (int k = 0; k < 2; k++) {
+        if (!(dir & (1 << k)))
+            continue;
+        ASS_Outline *ol = str->result[k];
+        if (!ass_outline_reserve(ol, n, n / 2))
+            return false;
+
+        ASS_Vector *res = ol->points + ol->n_points;
+        if (k)
+            for (int i = 0; i < n; i++) {
+                res[i].x = pt.x - dx[i];
+                res[i].y = pt.y - dy[i];
+            }
+        else
+            for (int i = 0; i < n; i++) {
+                res[i].x = pt.x + dx[i];
+                res[i].y = pt.y + dy[i];
+            }
+        for (int i = 0; i < n; i++)
+            if (abs(res[i].x) > OUTLINE_MAX || abs(res[i].y) > OUTLINE_MAX)
+                return false;
+        ol->n_points += n;
+
+        memset(ol->segments + ol->n_segments, OUTLINE_QUADRATIC_SPLINE, n / 2);
+        ol->n_segments += n / 2;
+    }
+    return true;
+}
+
 /**
  * \brief Helper function for circular arc construction
  * \param str stroker state
@@ -668,19 +750,39 @@ static void fix_first_point(StrokerState *str, ASS_Vector pt,
  * \param level subdivision level
  * \param dir destination outline flags
  * \return false on allocation failure
+ *
+ * Subdivisions of the last ARC_BATCH_ORDER levels are done breadth-first
+ * into flat arrays, so that the points can be emitted in one go.
  */
 static bool process_arc(StrokerState *str, ASS_Vector pt,
                         ASS_DVector normal0, ASS_DVector normal1,
                         const double *mul, int level, int dir)
 {
-    ASS_DVector center;
-    center.x = (normal0.x + normal1.x) * mul[level];
-    center.y = (normal0.y + normal1.y) * mul[level];
-    if (level)
-        return process_arc(str, pt, normal0, center, mul, level - 1, dir) &&
-               process_arc(str, pt, center, normal1, mul, level - 1, dir);
-    return emit_point(str, pt, normal0, OUTLINE_QUADRATIC_SPLINE, dir) &&
-           emit_point(str, pt, center, 0, dir);
+    if (level >= ARC_BATCH_ORDER) {
+        ASS_DVector center;
+        center.x = (normal0.x + normal1.x) * mul[level];
+        center.y = (normal0.y + normal1.y) * mul[level];
+        if (level)
+            return process_arc(str, pt, normal0, center, mul, level - 1, dir) &&
+                   process_arc(str, pt, center, normal1, mul, level - 1, dir);
+        return emit_point(str, pt, normal0, OUTLINE_QUADRATIC_SPLINE, dir) &&
+               emit_point(str, pt, center, 0, dir);
+    }
+
+    double nx[ARC_BATCH_SIZE + 1], ny[ARC_BATCH_SIZE + 1];
+    int n = 2 << level;
+    nx[0] = normal0.x;
+    ny[0] = normal0.y;
+    nx[n] = normal1.x;
+    ny[n] = normal1.y;
+    for (int step = n; step > 1; step >>= 1, level--) {
+        int half = step >> 1;
+        for (int i = half; i < n; i += step) {
+            nx[i] = (nx[i - half] + nx[i + half]) * mul[level];
+            ny[i] = (ny[i - half] + ny[i + half]) * mul[level];
+        }
+    }
+    return emit_arc_points(str, pt, nx, ny, n, dir);
 }
 
 /**
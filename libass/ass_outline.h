@@ -97,6 +97,7 @@ void ass_outline_add_rect(ASS_Outline *outline,
                           int32_t x0, int32_t y0, int32_t x1, int32_t y1);
 
 // enlarges outline automatically
+bool ass_outline_reserve(ASS_Outline *outline, size_t n_points, size_t n_segments);
 bool ass_outline_add_point(ASS_Outline *outline, ASS_Vector pt, char segment);
 bool ass_outline_add_segment(ASS_Outline *outline, char segment);
 void ass_outline_close_contour(ASS_Outline *outline);
@@ -272,6 +272,31 @@ static ASS_Style *lookup_style_strict(ASS_Track *track, char *name, size_t len)
     return NULL;
 }
 
+/**
+ * \brief Check whether override tags only set colors and alpha
+ * Used to find \t tags that don't change the layout.
+ */
+static bool only_colors(char *p, char *end)
+{
+    while (p < end) {
+        while (*p != '\\' && p != end)
+            ++p;
+        if (p == end)
+            break;
+        ++p;
+        if (p != end)
+            skip_spaces(&p);
+        // in the order of ass_parse_tags: \clip takes precedence over \c,
+        // \alpha over \a (alignment)
+        if (mystrcmp(&p, "clip"))
+            return false;
+        if (!mystrcmp(&p, "alpha") && !mystrcmp(&p, "c") &&
+                !(*p >= '1' && *p <= '4' && (p[1] == 'c' || p[1] == 'a')))
+            return false;
+    }
+    return true;
+}
+
 /**
  * \brief Parse style override tags.
  * \param p string to parse
@@ -513,6 +538,7 @@ char *ass_parse_tags(RenderContext *state, char *p, char *end, double pwr,
                 t2 = state->event->Duration;
             }
             delta_t = (uint32_t) t2 - t1;
+            state->animated |= ANIM_POSITION;
             t = render_priv->time - state->event->Start;
             if (t <= t1)
                 k = 0.;
@@ -647,6 +673,7 @@ char *ass_parse_tags(RenderContext *state, char *p, char *end, double pwr,
                 t4 = state->event->Duration;
                 t3 = (uint32_t) t4 - t3;
             }
+            state->animated |= ANIM_COLOR;
             if ((state->parsed_tags & PARSED_FADE) == 0) {
                 state->fade =
                     interpolate_alpha(render_priv->time -
@@ -713,6 +740,8 @@ char *ass_parse_tags(RenderContext *state, char *p, char *end, double pwr,
             if (!has_backslash_arg)
                 continue;
             p = args[cnt].start;
+            state->animated |= only_colors(p, args[cnt].end) ?
+                ANIM_COLOR : ANIM_LAYOUT;
             if (args[cnt].end < end) {
                 assert(!nested);
                 p = ass_parse_tags(state, p, args[cnt].end, k, true);
@@ -964,6 +993,7 @@ void ass_apply_transition_effects(RenderContext *state)
         // maxuimum there, before converting back.
         double scale_x = ((double) layout_res.x) / render_priv->track->PlayResX;
         delay = ((int) FFMAX(delay / scale_x, 1)) * scale_x;
+        state->animated |= ANIM_POSITION;
         state->scroll_shift =
             (render_priv->time - event->Start) / delay;
         state->evt_type |= EVENT_HSCROLL;
@@ -994,6 +1024,7 @@ void ass_apply_transition_effects(RenderContext *state)
         // See explanation for Banner
         double scale_y = ((double) layout_res.y) / render_priv->track->PlayResY;
         delay = ((int) FFMAX(delay / scale_y, 1)) * scale_y;
+        state->animated |= ANIM_POSITION;
         state->scroll_shift =
             (render_priv->time - event->Start) / delay;
         if (v[0] < v[1]) {
@@ -1058,6 +1089,7 @@ void ass_process_karaoke_effects(RenderContext *state)
             effect_type = start->effect_type;
         if (effect_type == EF_NONE)
             continue;
+        state->animated |= ANIM_LAYOUT;
 
         if (start->reset_effect)
             timing = 0;
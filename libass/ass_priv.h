@@ -23,6 +23,7 @@
 #include <stdint.h>
 
 #include "ass_shaper.h"
+#include "ass_threading.h"
 
 typedef enum {
     PST_UNKNOWN = 0,
@@ -49,13 +50,35 @@ typedef enum {
     // max 32 enumerators
 } ScriptInfo;
 
+typedef struct {
+    long long time;
+    int id;
+} EventTime;
+
+// Events sorted by time, used to find the events active at a timestamp
+// without scanning the whole track. Events added after the last update
+// are not indexed yet and are scanned linearly.
+typedef struct {
+    int n_events;               // number of indexed events
+    int max_events;
+    EventTime *by_start;        // sorted by start time, then by id
+    EventTime *by_end;          // sorted by end time, then by id
+    long long *max_end;         // max end time tree over by_start
+    int tree_size;              // number of leaves of max_end
+    unsigned generation;        // track generation the index was built at
+} EventIndex;
+
 struct parser_priv {
     ParserState state;
     char *fontname;
-    char *fontdata;
+    char *fontdata;             // still encoded, decoded on demand
     size_t fontdata_size;
     size_t fontdata_used;
 
+    // incomplete last line buffered by ass_track_feed
+    char *line;
+    size_t line_len, line_size;
+
     // contains bitmap of ReadOrder IDs of all read events
     uint32_t *read_order_bitmap;
     int read_order_elems; // size in uint32_t units of read_order_bitmap
@@ -68,6 +91,27 @@ struct parser_priv {
 
     long long prune_delay;
     long long prune_next_ts;
+
+    EventIndex event_index;
+    // incremented by ass_free_event, as removing events changes the ids
+    // of the following ones
+    unsigned event_removals;
+    // incremented by ass_track_changed, as existing events or styles
+    // may have been modified in place, and whenever the parser changes
+    // headers or styles
+    unsigned generation;
+
+#if CONFIG_THREADS
+    // Held by ass_render_frame: renderers sharing caches may run
+    // concurrently, but never on the same track, as its events carry
+    // the collision state and the event index is updated lazily.
+    ASS_Mutex render_lock;
+#endif
 };
 
+void ass_update_event_index(ASS_Track *track, bool full);
+ASS_Track *ass_copy_track_events(ASS_Track *track, const int *ids, int n_ids);
+int ass_find_active_events(ASS_Track *track, long long now,
+                           int **ids, int *max_ids);
+
 #endif /* LIBASS_PRIV_H */
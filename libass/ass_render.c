@@ -76,6 +76,123 @@ static void text_info_done(TextInfo* text_info)
     free(text_info->combined_bitmaps);
 }
 
+/*
+ * Images and the bitmaps they own are allocated from blocks of an arena
+ * held by each render context. A block counts the allocations made from
+ * it plus one while it is the arena's current block, and is freed when
+ * that drops to zero. Every frame starts a new block, so the images of
+ * a frame are freed along with it.
+ */
+
+#define IMAGE_BLOCK_MIN_SIZE (16 * 1024)
+#define IMAGE_BLOCK_MAX_SIZE (256 * 1024)
+#define IMAGE_BLOCK_ALIGN 64    // also the maximal alignment of allocations
+#define IMAGE_ALIGN 16
+
+struct image_block {
+    size_t ref_count;
+    size_t size, pos;           // in bytes, including this header
+};
+
+static inline size_t image_block_ref_inc(ImageBlock *block)
+{
+#if CONFIG_THREADS
+    return ass_atomic_add(&block->ref_count, 1);
+#else
+    return ++block->ref_count;
+#endif
+}
+
+static inline size_t image_block_ref_dec(ImageBlock *block)
+{
+#if CONFIG_THREADS
+    return ass_atomic_sub(&block->ref_count, 1);
+#else
+    return --block->ref_count;
+#endif
+}
+
+static void image_block_release(ImageBlock *block)
+{
+    if (block && !image_block_ref_dec(block))
+        ass_aligned_free(block);
+}
+
+/**
+ * \brief Stop allocating from the current block
+ */
+static void image_arena_flush(ImageArena *arena)
+{
+    image_block_release(arena->block);
+    arena->block = NULL;
+}
+
+/**
+ * \brief Prepare the arena for the images of a new frame
+ * The current block is rewound if none of its allocations are in use.
+ */
+static void image_arena_begin_frame(ImageArena *arena)
+{
+    ImageBlock *block = arena->block;
+    if (!block)
+        return;
+    // only the arena's owner can add references to its current block
+#if CONFIG_THREADS
+    size_t ref_count = ass_atomic_load(&block->ref_count);
+#else
+    size_t ref_count = block->ref_count;
+#endif
+    if (ref_count == 1)
+        block->pos = IMAGE_BLOCK_ALIGN;
+    else
+        image_arena_flush(arena);
+}
+
+/**
+ * \brief Allocate memory belonging to an image
+ * \param arena arena to allocate from, or NULL to use the heap
+ * \param block receives the block to pass to image_arena_free
+ * Allocations too large for the arena are made on the heap as well.
+ */
+static void *image_arena_alloc(ImageArena *arena, size_t size, size_t align,
+                               ImageBlock **block)
+{
+    assert(align <= IMAGE_BLOCK_ALIGN);
+    *block = NULL;
+    if (!arena || size > IMAGE_BLOCK_MAX_SIZE / 4)
+        return ass_aligned_alloc(align, size, false);
+
+    ImageBlock *cur = arena->block;
+    size_t pos = cur ? ass_align(align, cur->pos) : 0;
+    if (!cur || pos + size > cur->size) {
+        size_t block_size = cur ? FFMIN(2 * cur->size, IMAGE_BLOCK_MAX_SIZE) :
+                                  FFMAX(arena->block_size, IMAGE_BLOCK_MIN_SIZE);
+        block_size = FFMAX(block_size, IMAGE_BLOCK_ALIGN + size);
+        ImageBlock *next = ass_aligned_alloc(IMAGE_BLOCK_ALIGN, block_size, false);
+        if (!next)
+            return NULL;
+        image_arena_flush(arena);
+        next->ref_count = 1;
+        next->size = block_size;
+        arena->block = cur = next;
+        arena->block_size = block_size;
+        pos = IMAGE_BLOCK_ALIGN;
+    }
+
+    cur->pos = pos + size;
+    image_block_ref_inc(cur);
+    *block = cur;
+    return (char *) cur + pos;
+}
+
+static void image_arena_free(ImageBlock *block, void *ptr)
+{
+    if (block)
+        image_block_release(block);
+    else
+        ass_aligned_free(ptr);
+}
+
 static bool render_context_init(RenderContext *state, ASS_Renderer *priv)
 {
     state->renderer = priv;
@@ -83,7 +200,7 @@ static bool render_context_init(RenderContext *state, ASS_Renderer *priv)
     if (!text_info_init(&state->text_info))
         return false;
 
-    if (!(state->shaper = ass_shaper_new(priv->cache.metrics_cache, priv->cache.face_size_metrics_cache)))
+    if (!(state->shaper = ass_shaper_new(priv->cache->metrics_cache, priv->cache->face_size_metrics_cache)))
         return false;
 
     return ass_rasterizer_init(&priv->engine, &state->rasterizer, RASTERIZER_PRECISION);
@@ -91,6 +208,8 @@ static bool render_context_init(RenderContext *state, ASS_Renderer *priv)
 
 static void render_context_done(RenderContext *state)
 {
+    image_arena_flush(&state->arena);
+    ass_scratch_done(&state->scratch);
     ass_rasterizer_done(&state->rasterizer);
 
     if (state->shaper)
@@ -99,34 +218,279 @@ static void render_context_done(RenderContext *state)
     text_info_done(&state->text_info);
 }
 
-ASS_Renderer *ass_renderer_init(ASS_Library *library)
+static void drop_cached_events(ASS_Renderer *priv);
+
+#if CONFIG_THREADS
+
+struct render_worker {
+    RenderContext state;
+    ASS_Thread thread;
+    unsigned frame_seq;         // last frame this worker has seen
+};
+
+static void render_queued_events(RenderContext *state);
+static void stop_prerender(ASS_Renderer *priv);
+
+static void *render_worker_thread(void *arg)
+{
+    RenderWorker *worker = arg;
+    ASS_Renderer *priv = worker->state.renderer;
+
+    ass_mutex_lock(&priv->worker_lock);
+    while (true) {
+        while (!priv->workers_exit && worker->frame_seq == priv->frame_seq)
+            ass_cond_wait(&priv->worker_cond, &priv->worker_lock);
+        if (priv->workers_exit)
+            break;
+        worker->frame_seq = priv->frame_seq;
+        ass_mutex_unlock(&priv->worker_lock);
+
+        render_queued_events(&worker->state);
+
+        ass_mutex_lock(&priv->worker_lock);
+        if (!--priv->workers_busy)
+            ass_cond_signal(&priv->done_cond);
+    }
+    ass_mutex_unlock(&priv->worker_lock);
+
+    return NULL;
+}
+
+static void stop_workers(ASS_Renderer *priv)
+{
+    if (!priv->n_workers)
+        return;
+
+    ass_mutex_lock(&priv->worker_lock);
+    priv->workers_exit = true;
+    ass_cond_broadcast(&priv->worker_cond);
+    ass_mutex_unlock(&priv->worker_lock);
+
+    for (int i = 0; i < priv->n_workers; i++) {
+        ass_thread_join(&priv->workers[i].thread);
+        render_context_done(&priv->workers[i].state);
+    }
+    free(priv->workers);
+    priv->workers = NULL;
+    priv->n_workers = 0;
+    priv->workers_exit = false;
+
+    ass_cond_destroy(&priv->done_cond);
+    ass_cond_destroy(&priv->worker_cond);
+    ass_mutex_destroy(&priv->worker_lock);
+}
+
+static bool start_workers(ASS_Renderer *priv, int count)
+{
+    if (!ass_mutex_init(&priv->worker_lock))
+        return false;
+    if (!ass_cond_init(&priv->worker_cond))
+        goto fail_worker_lock;
+    if (!ass_cond_init(&priv->done_cond))
+        goto fail_worker_cond;
+
+    priv->workers = calloc(count, sizeof(RenderWorker));
+    if (!priv->workers)
+        goto fail_done_cond;
+
+    int n = 0;
+    for (; n < count; n++) {
+        RenderWorker *worker = priv->workers + n;
+        worker->frame_seq = priv->frame_seq;
+        if (!render_context_init(&worker->state, priv) ||
+                !ass_thread_create(&worker->thread, render_worker_thread, worker)) {
+            render_context_done(&worker->state);
+            break;
+        }
+    }
+    priv->n_workers = n;
+    if (n)
+        return true;
+
+    free(priv->workers);
+    priv->workers = NULL;
+fail_done_cond:
+    ass_cond_destroy(&priv->done_cond);
+fail_worker_cond:
+    ass_cond_destroy(&priv->worker_cond);
+fail_worker_lock:
+    ass_mutex_destroy(&priv->worker_lock);
+    return false;
+}
+
+#endif
+
+int ass_set_threads(ASS_Renderer *priv, int threads)
+{
+#if CONFIG_THREADS
+    stop_workers(priv);
+    if (threads <= 1)
+        return 1;
+
+    // the calling thread is always used for rendering as well
+    if (!start_workers(priv, threads - 1) || priv->n_workers < threads - 1)
+        ass_msg(priv->library, MSGL_WARN,
+                "Failed to create %d rendering threads, using %d",
+                threads, priv->n_workers + 1);
+    return priv->n_workers + 1;
+#else
+    if (threads > 1)
+        ass_msg(priv->library, MSGL_WARN,
+                "libass was built without thread support, using 1 rendering thread");
+    return 1;
+#endif
+}
+
+static inline void lock_fonts(ASS_Renderer *priv)
+{
+#if CONFIG_THREADS
+    ass_mutex_lock(&priv->shared->font_lock);
+#endif
+}
+
+static inline void unlock_fonts(ASS_Renderer *priv)
+{
+#if CONFIG_THREADS
+    ass_mutex_unlock(&priv->shared->font_lock);
+#endif
+}
+
+static inline int64_t stage_start(RenderContext *state)
+{
+    return state->renderer->stats_enabled ? ass_time_ns() : 0;
+}
+
+static inline void stage_end(RenderContext *state, RenderStage stage, int64_t start)
+{
+    if (state->renderer->stats_enabled)
+        state->stage_time[stage] += ass_time_ns() - start;
+}
+
+static void render_shared_release(RenderShared *shared)
+{
+    if (!shared)
+        return;
+
+#if CONFIG_THREADS
+    ass_mutex_lock(&shared->lock);
+    int ref_count = --shared->ref_count;
+    ass_mutex_unlock(&shared->lock);
+    if (ref_count)
+        return;
+#else
+    if (--shared->ref_count)
+        return;
+#endif
+
+    ass_cache_done(shared->cache.composite_cache);
+    ass_cache_done(shared->cache.bitmap_cache);
+    ass_cache_done(shared->cache.outline_cache);
+    ass_cache_done(shared->cache.face_size_metrics_cache);
+    ass_cache_done(shared->cache.metrics_cache);
+    ass_cache_done(shared->cache.font_cache);
+    ass_bitmap_pool_release(shared->cache.bitmap_pool);
+
+    if (shared->fontselect)
+        ass_fontselect_free(shared->fontselect);
+    if (shared->ftlibrary)
+        FT_Done_FreeType(shared->ftlibrary);
+
+#if CONFIG_THREADS
+    ass_mutex_destroy(&shared->font_lock);
+    ass_cond_destroy(&shared->idle_cond);
+    ass_mutex_destroy(&shared->lock);
+#endif
+
+    free(shared);
+}
+
+static RenderShared *render_shared_new(ASS_Library *library)
 {
-    int error;
-    FT_Library ft;
-    ASS_Renderer *priv = 0;
     int vmajor, vminor, vpatch;
 
-    ass_msg(library, MSGL_INFO, "libass API version: 0x%X", LIBASS_VERSION);
-    ass_msg(library, MSGL_INFO, "libass source: %s", CONFIG_SOURCEVERSION);
+    RenderShared *shared = calloc(1, sizeof(RenderShared));
+    if (!shared)
+        return NULL;
+    shared->ref_count = 1;
+
+#if CONFIG_THREADS
+    if (!ass_mutex_init(&shared->lock)) {
+        free(shared);
+        return NULL;
+    }
+    if (!ass_cond_init(&shared->idle_cond)) {
+        ass_mutex_destroy(&shared->lock);
+        free(shared);
+        return NULL;
+    }
+    if (!ass_mutex_init(&shared->font_lock)) {
+        ass_cond_destroy(&shared->idle_cond);
+        ass_mutex_destroy(&shared->lock);
+        free(shared);
+        return NULL;
+    }
+#endif
 
-    error = FT_Init_FreeType(&ft);
-    if (error) {
+    if (FT_Init_FreeType(&shared->ftlibrary)) {
         ass_msg(library, MSGL_FATAL, "%s failed", "FT_Init_FreeType");
+        shared->ftlibrary = NULL;
         goto fail;
     }
 
-    FT_Library_Version(ft, &vmajor, &vminor, &vpatch);
+    FT_Library_Version(shared->ftlibrary, &vmajor, &vminor, &vpatch);
     ass_msg(library, MSGL_V, "Raster: FreeType %d.%d.%d",
            vmajor, vminor, vpatch);
 
-    priv = calloc(1, sizeof(ASS_Renderer));
+    CacheStore *cache = &shared->cache;
+    cache->font_cache = ass_font_cache_create();
+    cache->bitmap_cache = ass_bitmap_cache_create();
+    cache->composite_cache = ass_composite_cache_create();
+    cache->outline_cache = ass_outline_cache_create();
+    cache->face_size_metrics_cache = ass_face_size_metrics_cache_create();
+    cache->metrics_cache = ass_glyph_metrics_cache_create();
+    cache->bitmap_pool = ass_bitmap_pool_create(
+        (BITMAP_CACHE_MAX_SIZE + COMPOSITE_CACHE_MAX_SIZE) / BITMAP_POOL_RATIO);
+    if (!cache->font_cache || !cache->bitmap_cache ||
+        !cache->composite_cache || !cache->outline_cache ||
+        !cache->face_size_metrics_cache || !cache->metrics_cache ||
+        !cache->bitmap_pool)
+        goto fail;
+
+    cache->glyph_max = GLYPH_CACHE_MAX;
+    cache->bitmap_max_size = BITMAP_CACHE_MAX_SIZE;
+    cache->composite_max_size = COMPOSITE_CACHE_MAX_SIZE;
+
+    return shared;
+
+fail:
+    render_shared_release(shared);
+    return NULL;
+}
+
+int ass_new_render_id(RenderShared *shared)
+{
+#if CONFIG_THREADS
+    ass_mutex_lock(&shared->lock);
+    int id = ++shared->last_render_id;
+    ass_mutex_unlock(&shared->lock);
+    return id;
+#else
+    return ++shared->last_render_id;
+#endif
+}
+
+static ASS_Renderer *renderer_init(ASS_Library *library, RenderShared *shared)
+{
+    ASS_Renderer *priv = calloc(1, sizeof(ASS_Renderer));
     if (!priv) {
-        FT_Done_FreeType(ft);
+        render_shared_release(shared);
         goto fail;
     }
 
     priv->library = library;
-    priv->ftlibrary = ft;
+    priv->shared = shared;
+    priv->cache = &shared->cache;
+    priv->render_id = ass_new_render_id(shared);
     // images_root and related stuff is zero-filled in calloc
 
     unsigned flags = ASS_CPU_FLAG_ALL;
@@ -135,21 +499,6 @@ ASS_Renderer *ass_renderer_init(ASS_Library *library)
 #endif
     priv->engine = ass_bitmap_engine_init(flags);
 
-    priv->cache.font_cache = ass_font_cache_create();
-    priv->cache.bitmap_cache = ass_bitmap_cache_create();
-    priv->cache.composite_cache = ass_composite_cache_create();
-    priv->cache.outline_cache = ass_outline_cache_create();
-    priv->cache.face_size_metrics_cache = ass_face_size_metrics_cache_create();
-    priv->cache.metrics_cache = ass_glyph_metrics_cache_create();
-    if (!priv->cache.font_cache || !priv->cache.bitmap_cache ||
-        !priv->cache.composite_cache || !priv->cache.outline_cache ||
-        !priv->cache.face_size_metrics_cache || !priv->cache.metrics_cache)
-        goto fail;
-
-    priv->cache.glyph_max = GLYPH_CACHE_MAX;
-    priv->cache.bitmap_max_size = BITMAP_CACHE_MAX_SIZE;
-    priv->cache.composite_max_size = COMPOSITE_CACHE_MAX_SIZE;
-
     if (!render_context_init(&priv->state, priv))
         goto fail;
 
@@ -172,28 +521,55 @@ fail:
     return NULL;
 }
 
+ASS_Renderer *ass_renderer_init(ASS_Library *library)
+{
+    ass_msg(library, MSGL_INFO, "libass API version: 0x%X", LIBASS_VERSION);
+    ass_msg(library, MSGL_INFO, "libass source: %s", CONFIG_SOURCEVERSION);
+
+    RenderShared *shared = render_shared_new(library);
+    if (!shared) {
+        ass_msg(library, MSGL_ERR, "Initialization failed");
+        return NULL;
+    }
+    return renderer_init(library, shared);
+}
+
+ASS_Renderer *ass_renderer_init_shared(ASS_Renderer *source)
+{
+    RenderShared *shared = source->shared;
+#if CONFIG_THREADS
+    ass_mutex_lock(&shared->lock);
+    shared->ref_count++;
+    ass_mutex_unlock(&shared->lock);
+#else
+    shared->ref_count++;
+#endif
+
+    return renderer_init(source->library, shared);
+}
+
 void ass_renderer_done(ASS_Renderer *render_priv)
 {
     if (!render_priv)
         return;
 
+#if CONFIG_THREADS
+    stop_prerender(render_priv);
+    stop_workers(render_priv);
+#endif
+
     ass_frame_unref(render_priv->images_root);
     ass_frame_unref(render_priv->prev_images_root);
 
-    ass_cache_done(render_priv->cache.composite_cache);
-    ass_cache_done(render_priv->cache.bitmap_cache);
-    ass_cache_done(render_priv->cache.outline_cache);
-    ass_cache_done(render_priv->cache.face_size_metrics_cache);
-    ass_cache_done(render_priv->cache.metrics_cache);
-    ass_cache_done(render_priv->cache.font_cache);
-
-    if (render_priv->fontselect)
-        ass_fontselect_free(render_priv->fontselect);
-    if (render_priv->ftlibrary)
-        FT_Done_FreeType(render_priv->ftlibrary);
     free(render_priv->eimg);
+    free(render_priv->event_ids);
+    drop_cached_events(render_priv);
+    free(render_priv->cached_events);
+    free(render_priv->cached_events_tmp);
+    ass_atlas_done(render_priv->atlas);
 
     render_context_done(&render_priv->state);
+    render_shared_release(render_priv->shared);
 
     free(render_priv->settings.default_font);
     free(render_priv->settings.default_family);
@@ -205,19 +581,20 @@ void ass_renderer_done(ASS_Renderer *render_priv)
 
 /**
  * \brief Create a new ASS_Image
- * Parameters are the same as ASS_Image fields.
+ * \param arena arena to allocate from, NULL for images outliving the frame
+ * Other parameters are the same as ASS_Image fields.
+ * The bitmap is not owned by the image, see alloc_image_buffer.
  */
-static ASS_Image *my_draw_bitmap(unsigned char *bitmap, int bitmap_w,
-                                 int bitmap_h, int stride, int dst_x,
-                                 int dst_y, uint32_t color,
+static ASS_Image *my_draw_bitmap(ImageArena *arena, unsigned char *bitmap,
+                                 int bitmap_w, int bitmap_h, int stride,
+                                 int dst_x, int dst_y, uint32_t color,
                                  CompositeHashValue *source)
 {
-    ASS_ImagePriv *img = malloc(sizeof(ASS_ImagePriv));
-    if (!img) {
-        if (!source)
-            ass_aligned_free(bitmap);
+    ImageBlock *block;
+    ASS_ImagePriv *img = image_arena_alloc(arena, sizeof(ASS_ImagePriv),
+                                           IMAGE_ALIGN, &block);
+    if (!img)
         return NULL;
-    }
 
     img->result.w = bitmap_w;
     img->result.h = bitmap_h;
@@ -229,12 +606,34 @@ static ASS_Image *my_draw_bitmap(unsigned char *bitmap, int bitmap_w,
 
     img->source = source;
     ass_cache_inc_ref(source);
-    img->buffer = source ? NULL : bitmap;
+    img->buffer = NULL;
+    img->block = block;
+    img->buffer_block = NULL;
     img->ref_count = 0;
 
     return &img->result;
 }
 
+/**
+ * \brief Allocate a bitmap which is freed along with the image
+ */
+static unsigned char *alloc_image_buffer(ImageArena *arena, ASS_Image *img,
+                                         size_t size, size_t align)
+{
+    ASS_ImagePriv *priv = (ASS_ImagePriv *) img;
+    assert(!priv->buffer);
+    priv->buffer = image_arena_alloc(arena, size, align, &priv->buffer_block);
+    return priv->buffer;
+}
+
+static void free_image(ASS_Image *img)
+{
+    ASS_ImagePriv *priv = (ASS_ImagePriv *) img;
+    ass_cache_dec_ref(priv->source);
+    image_arena_free(priv->buffer_block, priv->buffer);
+    image_arena_free(priv->block, priv);
+}
+
 /**
  * \brief Mapping between script and screen coordinates
  */
@@ -386,7 +785,8 @@ static ASS_Image **render_glyph_i(RenderContext *state,
         // split up into left and right for karaoke, if needed
         if (lbrk > r[j].x0) {
             if (lbrk > r[j].x1) lbrk = r[j].x1;
-            img = my_draw_bitmap(bm->buffer + r[j].y0 * bm->stride + r[j].x0,
+            img = my_draw_bitmap(&state->arena,
+                                 bm->buffer + r[j].y0 * bm->stride + r[j].x0,
                                  lbrk - r[j].x0, r[j].y1 - r[j].y0, bm->stride,
                                  dst_x + r[j].x0, dst_y + r[j].y0, color, source);
             if (!img) break;
@@ -396,7 +796,8 @@ static ASS_Image **render_glyph_i(RenderContext *state,
         }
         if (lbrk < r[j].x1) {
             if (lbrk < r[j].x0) lbrk = r[j].x0;
-            img = my_draw_bitmap(bm->buffer + r[j].y0 * bm->stride + lbrk,
+            img = my_draw_bitmap(&state->arena,
+                                 bm->buffer + r[j].y0 * bm->stride + lbrk,
                                  r[j].x1 - lbrk, r[j].y1 - r[j].y0, bm->stride,
                                  dst_x + lbrk, dst_y + r[j].y0, color2, source);
             if (!img) break;
@@ -473,7 +874,8 @@ render_glyph(RenderContext *state, Bitmap *bm, int dst_x, int dst_y,
     if (brk > b_x0) {           // draw left part
         if (brk > b_x1)
             brk = b_x1;
-        img = my_draw_bitmap(bm->buffer + bm->stride * b_y0 + b_x0,
+        img = my_draw_bitmap(&state->arena,
+                             bm->buffer + bm->stride * b_y0 + b_x0,
                              brk - b_x0, b_y1 - b_y0, bm->stride,
                              dst_x + b_x0, dst_y + b_y0, color, source);
         if (!img) return tail;
@@ -484,7 +886,8 @@ render_glyph(RenderContext *state, Bitmap *bm, int dst_x, int dst_y,
     if (brk < b_x1) {           // draw right part
         if (brk < b_x0)
             brk = b_x0;
-        img = my_draw_bitmap(bm->buffer + bm->stride * b_y0 + brk,
+        img = my_draw_bitmap(&state->arena,
+                             bm->buffer + bm->stride * b_y0 + brk,
                              b_x1 - brk, b_y1 - b_y0, bm->stride,
                              dst_x + brk, dst_y + b_y0, color2, source);
         if (!img) return tail;
@@ -720,12 +1123,12 @@ static void blend_vector_clip(RenderContext *state, ASS_Image *head)
 
     ASS_Vector pos;
     BitmapHashKey key;
-    key.outline = ass_cache_get(render_priv->cache.outline_cache, &ol_key, render_priv);
+    key.outline = ass_cache_get(render_priv->cache->outline_cache, &ol_key, state);
     if (!key.outline || !key.outline->valid ||
             !quantize_transform(m, &pos, NULL, true, &key))
         return;
 
-    Bitmap *clip_bm = ass_cache_get(render_priv->cache.bitmap_cache, &key, state);
+    Bitmap *clip_bm = ass_cache_get(render_priv->cache->bitmap_cache, &key, state);
     if (!clip_bm)
         return;
 
@@ -770,8 +1173,8 @@ static void blend_vector_clip(RenderContext *state, ASS_Image *head)
                 continue;
             }
 
-            // Allocate new buffer and add to free list
-            nbuffer = ass_aligned_alloc(align, as * ah + align, false);
+            // Allocate new buffer owned by the image
+            nbuffer = alloc_image_buffer(&state->arena, cur, as * ah + align, align);
             if (!nbuffer)
                 break;
 
@@ -788,9 +1191,9 @@ static void blend_vector_clip(RenderContext *state, ASS_Image *head)
                 continue;
             }
 
-            // Allocate new buffer and add to free list
+            // Allocate new buffer owned by the image
             unsigned ns = ass_align(align, w);
-            nbuffer = ass_aligned_alloc(align, ns * h + align, false);
+            nbuffer = alloc_image_buffer(&state->arena, cur, ns * h + align, align);
             if (!nbuffer)
                 break;
 
@@ -807,7 +1210,7 @@ static void blend_vector_clip(RenderContext *state, ASS_Image *head)
         }
 
         ASS_ImagePriv *priv = (ASS_ImagePriv *) cur;
-        priv->buffer = cur->bitmap = nbuffer;
+        cur->bitmap = nbuffer;
         ass_cache_dec_ref(priv->source);
         priv->source = NULL;
     }
@@ -1142,6 +1545,7 @@ init_render_context(RenderContext *state, ASS_Event *event)
     state->effect_timing = 0;
     state->effect_skip_timing = 0;
     state->reset_effect = false;
+    state->animated = 0;
 
     ass_apply_transition_effects(state);
     state->explicit = state->evt_type != EVENT_NORMAL ||
@@ -1181,7 +1585,7 @@ get_outline_glyph(RenderContext *state, GlyphInfo *info)
     if (info->drawing_text.str) {
         key.type = OUTLINE_DRAWING;
         key.u.drawing.text = info->drawing_text;
-        val = ass_cache_get(priv->cache.outline_cache, &key, priv);
+        val = ass_cache_get(priv->cache->outline_cache, &key, state);
         if (!val || !val->valid)
             return;
 
@@ -1203,8 +1607,9 @@ get_outline_glyph(RenderContext *state, GlyphInfo *info)
         k->bold = info->bold;
         k->italic = info->italic;
         k->flags = info->flags;
+        k->hinting = priv->settings.hinting;
 
-        val = ass_cache_get(priv->cache.outline_cache, &key, priv);
+        val = ass_cache_get(priv->cache->outline_cache, &key, state);
         if (!val || !val->valid)
             return;
 
@@ -1231,9 +1636,9 @@ get_outline_glyph(RenderContext *state, GlyphInfo *info)
     info->desc = ass_lrint(desc * scale.y);
 }
 
-size_t ass_outline_construct(void *key, void *value, void *priv)
+static size_t outline_construct(void *key, void *value, RenderContext *state)
 {
-    ASS_Renderer *render_priv = priv;
+    ASS_Renderer *render_priv = state->renderer;
     OutlineHashKey *outline_key = key;
     OutlineHashValue *v = value;
     memset(v, 0, sizeof(*v));
@@ -1244,7 +1649,7 @@ size_t ass_outline_construct(void *key, void *value, void *priv)
             GlyphHashKey *k = &outline_key->u.glyph;
             ass_face_set_size(k->font->faces[k->face_index], k->size);
             if (!ass_font_get_glyph(k->font, k->face_index, k->glyph_index,
-                                    render_priv->settings.hinting))
+                                    k->hinting))
                 return 1;
             if (!ass_get_glyph_outline(&v->outline[0], &v->advance,
                                        k->font->faces[k->face_index],
@@ -1320,6 +1725,15 @@ size_t ass_outline_construct(void *key, void *value, void *priv)
     return 1;
 }
 
+size_t ass_outline_construct(void *key, void *value, void *priv)
+{
+    RenderContext *state = priv;
+    int64_t start = stage_start(state);
+    size_t size = outline_construct(key, value, state);
+    stage_end(state, STAGE_OUTLINE, start);
+    return size;
+}
+
 /**
  * \brief Calculate outline transformation matrix
  */
@@ -1409,7 +1823,7 @@ get_bitmap_glyph(RenderContext *state, GlyphInfo *info,
     if (!quantize_transform(m, pos, offset, first, &key))
         return;
 
-    info->bm = ass_cache_get(render_priv->cache.bitmap_cache, &key, state);
+    info->bm = ass_cache_get(render_priv->cache->bitmap_cache, &key, state);
     if (!info->bm || !info->bm->buffer)
         info->bm = NULL;
 
@@ -1528,12 +1942,12 @@ get_bitmap_glyph(RenderContext *state, GlyphInfo *info,
         }
     }
 
-    key.outline = ass_cache_get(render_priv->cache.outline_cache, &ol_key, render_priv);
+    key.outline = ass_cache_get(render_priv->cache->outline_cache, &ol_key, state);
     if (!key.outline || !key.outline->valid ||
             !quantize_transform(m, pos_o, offset, false, &key))
         return;
 
-    info->bm_o = ass_cache_get(render_priv->cache.bitmap_cache, &key, state);
+    info->bm_o = ass_cache_get(render_priv->cache->bitmap_cache, &key, state);
     if (!info->bm_o || !info->bm_o->buffer) {
         info->bm_o = NULL;
         *pos_o = *pos;
@@ -1551,6 +1965,7 @@ size_t ass_bitmap_construct(void *key, void *value, void *priv)
     RenderContext *state = priv;
     BitmapHashKey *k = key;
     Bitmap *bm = value;
+    int64_t start = stage_start(state);
 
     double m[3][3];
     restore_transform(m, k);
@@ -1568,6 +1983,7 @@ size_t ass_bitmap_construct(void *key, void *value, void *priv)
         memset(bm, 0, sizeof(*bm));
     ass_outline_free(&outline[0]);
     ass_outline_free(&outline[1]);
+    stage_end(state, STAGE_RASTERIZE, start);
 
     return sizeof(BitmapHashKey) + sizeof(Bitmap) + bitmap_size(bm) +
            sizeof(OutlineHashValue) + outline_size(&k->outline->outline[0]) + outline_size(&k->outline->outline[1]);
@@ -2614,7 +3030,7 @@ static void render_and_combine_glyphs(RenderContext *state,
         key.filter = info->filter;
         key.bitmap_count = info->bitmap_count;
         key.bitmaps = info->bitmaps;
-        CompositeHashValue *val = ass_cache_get(render_priv->cache.composite_cache, &key, render_priv);
+        CompositeHashValue *val = ass_cache_get(render_priv->cache->composite_cache, &key, state);
         if (!val)
             continue;
 
@@ -2668,10 +3084,13 @@ int ass_be_padding(int be)
 
 size_t ass_composite_construct(void *key, void *value, void *priv)
 {
-    ASS_Renderer *render_priv = priv;
+    RenderContext *state = priv;
+    ASS_Renderer *render_priv = state->renderer;
+    BitmapPool *pool = render_priv->cache->bitmap_pool;
     CompositeHashKey *k = key;
     CompositeHashValue *v = value;
     memset(v, 0, sizeof(*v));
+    int64_t start = stage_start(state);
 
     ASS_Rect rect, rect_o;
     rectangle_reset(&rect);
@@ -2695,10 +3114,10 @@ size_t ass_composite_construct(void *key, void *value, void *priv)
 
     int bord = ass_be_padding(k->filter.be);
     if (!bord && n_bm == 1) {
-        ass_copy_bitmap(&render_priv->engine, &v->bm, last->bm);
+        ass_copy_bitmap(pool, &render_priv->engine, &v->bm, last->bm);
         v->bm.left += last->pos.x;
         v->bm.top  += last->pos.y;
-    } else if (n_bm && ass_alloc_bitmap(&render_priv->engine, &v->bm,
+    } else if (n_bm && ass_alloc_bitmap(pool, &render_priv->engine, &v->bm,
                                         rect.x_max - rect.x_min + 2 * bord,
                                         rect.y_max - rect.y_min + 2 * bord,
                                         true)) {
@@ -2720,10 +3139,10 @@ size_t ass_composite_construct(void *key, void *value, void *priv)
         }
     }
     if (!bord && n_bm_o == 1) {
-        ass_copy_bitmap(&render_priv->engine, &v->bm_o, last_o->bm_o);
+        ass_copy_bitmap(pool, &render_priv->engine, &v->bm_o, last_o->bm_o);
         v->bm_o.left += last_o->pos_o.x;
         v->bm_o.top  += last_o->pos_o.y;
-    } else if (n_bm_o && ass_alloc_bitmap(&render_priv->engine, &v->bm_o,
+    } else if (n_bm_o && ass_alloc_bitmap(pool, &render_priv->engine, &v->bm_o,
                                           rect_o.x_max - rect_o.x_min + 2 * bord,
                                           rect_o.y_max - rect_o.y_min + 2 * bord,
                                           true)) {
@@ -2748,23 +3167,29 @@ size_t ass_composite_construct(void *key, void *value, void *priv)
     int flags = k->filter.flags;
     double r2x = restore_blur(k->filter.blur_x);
     double r2y = restore_blur(k->filter.blur_y);
+    stage_end(state, STAGE_COMPOSITE, start);
+    start = stage_start(state);
     if (!(flags & FILTER_NONZERO_BORDER) || (flags & FILTER_BORDER_STYLE_3))
-        ass_synth_blur(&render_priv->engine, &v->bm, k->filter.be, r2x, r2y);
-    ass_synth_blur(&render_priv->engine, &v->bm_o, k->filter.be, r2x, r2y);
+        ass_synth_blur(pool, &render_priv->engine, &state->scratch,
+                       &v->bm, k->filter.be, r2x, r2y);
+    ass_synth_blur(pool, &render_priv->engine, &state->scratch,
+                   &v->bm_o, k->filter.be, r2x, r2y);
+    stage_end(state, STAGE_BLUR, start);
+    start = stage_start(state);
 
     if (!(flags & FILTER_FILL_IN_BORDER) && !(flags & FILTER_FILL_IN_SHADOW))
         ass_fix_outline(&v->bm, &v->bm_o);
 
     if (flags & FILTER_NONZERO_SHADOW) {
         if (flags & FILTER_NONZERO_BORDER) {
-            ass_copy_bitmap(&render_priv->engine, &v->bm_s, &v->bm_o);
+            ass_copy_bitmap(pool, &render_priv->engine, &v->bm_s, &v->bm_o);
             if ((flags & FILTER_FILL_IN_BORDER) && !(flags & FILTER_FILL_IN_SHADOW))
                 ass_fix_outline(&v->bm, &v->bm_s);
         } else if (flags & FILTER_BORDER_STYLE_3) {
             v->bm_s = v->bm_o;
             memset(&v->bm_o, 0, sizeof(v->bm_o));
         } else {
-            ass_copy_bitmap(&render_priv->engine, &v->bm_s, &v->bm);
+            ass_copy_bitmap(pool, &render_priv->engine, &v->bm_s, &v->bm);
         }
 
         // Works right even for negative offsets
@@ -2776,6 +3201,7 @@ size_t ass_composite_construct(void *key, void *value, void *priv)
 
     if ((flags & FILTER_FILL_IN_SHADOW) && !(flags & FILTER_FILL_IN_BORDER))
         ass_fix_outline(&v->bm, &v->bm_o);
+    stage_end(state, STAGE_COMPOSITE, start);
 
     return sizeof(CompositeHashKey) + sizeof(CompositeHashValue) +
         k->bitmap_count * sizeof(BitmapRef) +
@@ -2801,24 +3227,186 @@ static void add_background(RenderContext *state, EventImages *event_images)
     int h = bottom - top;
     if (w < 1 || h < 1)
         return;
-    void *nbuffer = ass_aligned_alloc(1, w * h, false);
-    if (!nbuffer)
-        return;
-    memset(nbuffer, 0xFF, w * h);
     uint32_t clr = state->c[3];
     ass_apply_fade(&clr, state->fade);
-    ASS_Image *img = my_draw_bitmap(nbuffer, w, h, w, left, top,
+    ASS_Image *img = my_draw_bitmap(&state->arena, NULL, w, h, w, left, top,
                                     clr, NULL);
-    if (img) {
-        img->next = event_images->imgs;
-        event_images->imgs = img;
+    if (!img)
+        return;
+    img->bitmap = alloc_image_buffer(&state->arena, img, w * h, 1);
+    if (!img->bitmap) {
+        free_image(img);
+        return;
+    }
+    memset(img->bitmap, 0xFF, w * h);
+    img->next = event_images->imgs;
+    event_images->imgs = img;
+}
+
+struct event_layout {
+    GlyphInfo *glyphs;          // clusters are allocated separately
+    int length;
+    bool *new_runs;             // starts_new_run as of split_style_runs
+    LineInfo *lines;
+    int n_lines;
+    double height;
+    int border_top, border_bottom, border_x;
+    ASS_DRect bbox;
+};
+
+static void free_event_layout(EventLayout *layout)
+{
+    if (!layout)
+        return;
+    for (int i = 0; i < layout->length; i++) {
+        GlyphInfo *info = layout->glyphs + i;
+        ass_cache_dec_ref(info->outline);
+        for (GlyphInfo *next, *cur = info->next; cur; cur = next) {
+            next = cur->next;
+            ass_cache_dec_ref(cur->outline);
+            free(cur);
+        }
+    }
+    free(layout->glyphs);
+    free(layout->new_runs);
+    free(layout->lines);
+    free(layout);
+}
+
+/**
+ * \brief Copy a glyph together with the rest of its cluster
+ * \return false if the cluster could only be copied partially
+ */
+static bool copy_cluster(GlyphInfo *dst, const GlyphInfo *src)
+{
+    *dst = *src;
+    for (; src->next; src = src->next, dst = dst->next) {
+        dst->next = malloc(sizeof(GlyphInfo));
+        if (!dst->next)
+            return false;
+        *dst->next = *src->next;
+    }
+    return true;
+}
+
+/**
+ * \brief Free the glyphs following the first ones of the clusters
+ */
+static void free_cluster_tails(GlyphInfo *glyphs, int n)
+{
+    for (int i = 0; i < n; i++) {
+        for (GlyphInfo *next, *cur = glyphs[i].next; cur; cur = next) {
+            next = cur->next;
+            free(cur);
+        }
+        glyphs[i].next = NULL;
+    }
+}
+
+/**
+ * \brief Keep the result of shaping, wrapping and positioning the glyphs
+ * \param new_runs starts_new_run of all glyphs before wrapping, taken over
+ */
+static EventLayout *save_layout(TextInfo *text_info, bool *new_runs,
+                                const ASS_DRect *bbox)
+{
+    EventLayout *layout = calloc(1, sizeof(EventLayout));
+    if (!layout) {
+        free(new_runs);
+        return NULL;
+    }
+    layout->new_runs = new_runs;
+    layout->glyphs = ass_realloc_array(NULL, text_info->length, sizeof(GlyphInfo));
+    layout->lines = ass_realloc_array(NULL, text_info->n_lines, sizeof(LineInfo));
+    if (!layout->new_runs || !layout->glyphs || !layout->lines) {
+        free_event_layout(layout);
+        return NULL;
+    }
+
+    for (int i = 0; i < text_info->length; i++) {
+        bool complete = copy_cluster(layout->glyphs + i, text_info->glyphs + i);
+        for (GlyphInfo *info = layout->glyphs + i; info; info = info->next)
+            ass_cache_inc_ref(info->outline);
+        layout->length++;
+        if (!complete) {
+            free_event_layout(layout);
+            return NULL;
+        }
+    }
+    memcpy(layout->lines, text_info->lines, text_info->n_lines * sizeof(LineInfo));
+    layout->n_lines = text_info->n_lines;
+    layout->height = text_info->height;
+    layout->border_top = text_info->border_top;
+    layout->border_bottom = text_info->border_bottom;
+    layout->border_x = text_info->border_x;
+    layout->bbox = *bbox;
+    return layout;
+}
+
+/**
+ * \brief Use the layout of an earlier frame for freshly parsed glyphs
+ * Only possible if the glyphs and style runs are unchanged, which is
+ * checked here. Colors and fade are taken from the parsed glyphs.
+ * \return false if the glyphs need a full layout, leaving them unchanged
+ */
+static bool restore_layout(TextInfo *text_info, const EventLayout *layout,
+                           ASS_DRect *bbox)
+{
+    if (layout->length != text_info->length)
+        return false;
+    for (int i = 0; i < layout->length; i++) {
+        const GlyphInfo *info = text_info->glyphs + i;
+        const GlyphInfo *saved = layout->glyphs + i;
+        if (info->symbol != saved->symbol || info->font != saved->font ||
+                info->starts_new_run != layout->new_runs[i])
+            return false;
     }
+    if (layout->n_lines > text_info->max_lines) {
+        if (!ASS_REALLOC_ARRAY(text_info->lines, layout->n_lines))
+            return false;
+        text_info->max_lines = layout->n_lines;
+    }
+
+    // Copy the rest of the clusters first, so that the parsed glyphs
+    // are still intact for a full layout if that fails
+    for (int i = 0; i < layout->length; i++) {
+        GlyphInfo copy;
+        bool complete = copy_cluster(&copy, layout->glyphs + i);
+        text_info->glyphs[i].next = copy.next;
+        if (!complete) {
+            free_cluster_tails(text_info->glyphs, i + 1);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < layout->length; i++) {
+        GlyphInfo *info = text_info->glyphs + i;
+        uint32_t c[4];
+        memcpy(c, info->c, sizeof(c));
+        int fade = info->fade;
+        GlyphInfo *next = info->next;
+        *info = layout->glyphs[i];
+        info->next = next;
+        for (; info; info = info->next) {
+            memcpy(info->c, c, sizeof(c));
+            info->fade = fade;
+        }
+    }
+    memcpy(text_info->lines, layout->lines, layout->n_lines * sizeof(LineInfo));
+    text_info->n_lines = layout->n_lines;
+    text_info->height = layout->height;
+    text_info->border_top = layout->border_top;
+    text_info->border_bottom = layout->border_bottom;
+    text_info->border_x = layout->border_x;
+    *bbox = layout->bbox;
+    return true;
 }
 
 /**
  * \brief Main ass rendering function, glues everything together
  * \param event event to render
- * \param event_images struct containing resulting images, will also be initialized
+ * \param event_images struct containing resulting images, will also be initialized;
+ * its layout from an earlier frame is used if the event's animation allows
  * Process event, appending resulting ASS_Image's to images_root.
  */
 static bool
@@ -2835,36 +3423,31 @@ ass_render_event(RenderContext *state, ASS_Event *event,
         return false;
     }
 
+    // Everything up to retrieve_glyphs can access font objects,
+    // so only one thread may be executing that part at a time
+    lock_fonts(render_priv);
+
     free_render_context(state);
     init_render_context(state, event);
 
-    if (!parse_events(state, event))
+    int64_t start = stage_start(state);
+    bool parsed = parse_events(state, event);
+    stage_end(state, STAGE_PARSE, start);
+    if (!parsed) {
+        unlock_fonts(render_priv);
         return false;
+    }
 
     TextInfo *text_info = &state->text_info;
     if (text_info->length == 0) {
         // no valid symbols in the event; this can be smth like {comment}
         free_render_context(state);
+        unlock_fonts(render_priv);
         return false;
     }
 
     split_style_runs(state);
 
-    // Find shape runs and shape text
-    ass_shaper_set_base_direction(state->shaper,
-            ass_resolve_base_direction(state->font_encoding));
-    ass_shaper_find_runs(state->shaper, render_priv, text_info->glyphs,
-            text_info->length);
-    if (!ass_shaper_shape(state->shaper, text_info)) {
-        ass_msg(render_priv->library, MSGL_ERR, "Failed to shape text");
-        free_render_context(state);
-        return false;
-    }
-
-    retrieve_glyphs(state);
-
-    preliminary_layout(state);
-
     int valign = state->alignment & 12;
 
     int MarginL =
@@ -2874,34 +3457,78 @@ ass_render_event(RenderContext *state, ASS_Event *event,
     int MarginV =
         (event->MarginV) ? event->MarginV : state->style->MarginV;
 
-    // calculate max length of a line
-    double max_text_width =
-        x2scr_right(state, render_priv->track->PlayResX - MarginR) -
-        x2scr_left(state, MarginL);
+    // With only the position and colors animated, the layout
+    // is the same as in the last frame
+    ASS_DRect bbox;
+    EventLayout *layout = event_images->layout;
+    bool keep_layout = state->animated && !(state->animated & ANIM_LAYOUT);
+    if (keep_layout && layout && restore_layout(text_info, layout, &bbox)) {
+        unlock_fonts(render_priv);
+    } else {
+        bool *new_runs = NULL;
+        if (keep_layout) {
+            new_runs = malloc(text_info->length * sizeof(bool));
+            for (int i = 0; new_runs && i < text_info->length; i++)
+                new_runs[i] = text_info->glyphs[i].starts_new_run;
+        }
 
-    // wrap lines
-    wrap_lines_smart(state, max_text_width);
+        // Find shape runs and shape text
+        start = stage_start(state);
+        ass_shaper_set_base_direction(state->shaper,
+                ass_resolve_base_direction(state->font_encoding));
+        ass_shaper_find_runs(state->shaper, render_priv, text_info->glyphs,
+                text_info->length);
+        bool shaped = ass_shaper_shape(state->shaper, text_info);
+        stage_end(state, STAGE_SHAPE, start);
+        if (!shaped) {
+            ass_msg(render_priv->library, MSGL_ERR, "Failed to shape text");
+            free(new_runs);
+            free_render_context(state);
+            unlock_fonts(render_priv);
+            return false;
+        }
 
-    // depends on glyph x coordinates being monotonous within runs, so it should be done before reorder
-    ass_process_karaoke_effects(state);
+        retrieve_glyphs(state);
 
-    reorder_text(state);
+        unlock_fonts(render_priv);
 
-    align_lines(state, max_text_width);
+        preliminary_layout(state);
 
-    // determine text bounding box
-    ASS_DRect bbox;
-    compute_string_bbox(text_info, &bbox);
+        // calculate max length of a line
+        double max_text_width =
+            x2scr_right(state, render_priv->track->PlayResX - MarginR) -
+            x2scr_left(state, MarginL);
 
-    apply_baseline_shear(state);
+        // wrap lines
+        wrap_lines_smart(state, max_text_width);
 
-    // determine device coordinates for text
-    double device_x = 0;
-    double device_y = 0;
+        // depends on glyph x coordinates being monotonous within runs, so it should be done before reorder
+        ass_process_karaoke_effects(state);
 
-    // handle positioned events first: an event can be both positioned and
-    // scrolling, and the scrolling effect overrides the position on one axis
-    if (state->evt_type & EVENT_POSITIONED) {
+        reorder_text(state);
+
+        align_lines(state, max_text_width);
+
+        // determine text bounding box
+        compute_string_bbox(text_info, &bbox);
+
+        apply_baseline_shear(state);
+
+        free_event_layout(layout);
+        layout = NULL;
+        if (keep_layout && text_info->length)
+            layout = save_layout(text_info, new_runs, &bbox);
+        else
+            free(new_runs);
+    }
+
+    // determine device coordinates for text
+    double device_x = 0;
+    double device_y = 0;
+
+    // handle positioned events first: an event can be both positioned and
+    // scrolling, and the scrolling effect overrides the position on one axis
+    if (state->evt_type & EVENT_POSITIONED) {
         double base_x = 0;
         double base_y = 0;
         get_base_point(&bbox, state->alignment, &base_x, &base_y);
@@ -3030,6 +3657,8 @@ ass_render_event(RenderContext *state, ASS_Event *event,
     event_images->detect_collisions = state->detect_collisions;
     event_images->shift_direction = (valign == VALIGN_SUB) ? -1 : 1;
     event_images->event = event;
+    event_images->animated = state->animated != 0;
+    event_images->layout = layout;
     event_images->imgs = render_text(state);
 
     if (state->border_style == 4)
@@ -3049,6 +3678,50 @@ static void check_cache_limits(ASS_Renderer *priv, CacheStore *cache)
     ass_cache_cut(cache->composite_cache, cache->composite_max_size);
     ass_cache_cut(cache->bitmap_cache, cache->bitmap_max_size);
     ass_cache_cut(cache->outline_cache, cache->glyph_max);
+    ass_bitmap_pool_trim(cache->bitmap_pool,
+        (cache->bitmap_max_size + cache->composite_max_size) / BITMAP_POOL_RATIO);
+}
+
+#if CONFIG_THREADS
+static bool cache_limits_exceeded(CacheStore *cache)
+{
+    return ass_cache_size(cache->composite_cache) > cache->composite_max_size ||
+           ass_cache_size(cache->bitmap_cache) > cache->bitmap_max_size ||
+           ass_cache_size(cache->outline_cache) > cache->glyph_max;
+}
+#endif
+
+/**
+ * \brief Enter a frame, cutting the caches if possible
+ * Renderers sharing the caches may be in the middle of a frame, using
+ * unreferenced cache values. Then cutting is postponed, unless the
+ * limits are already exceeded, in which case wait for them to finish.
+ */
+static void begin_frame_caches(ASS_Renderer *priv)
+{
+    RenderShared *shared = priv->shared;
+#if CONFIG_THREADS
+    ass_mutex_lock(&shared->lock);
+    while (shared->active_frames && cache_limits_exceeded(&shared->cache))
+        ass_cond_wait(&shared->idle_cond, &shared->lock);
+    if (!shared->active_frames)
+        check_cache_limits(priv, &shared->cache);
+    shared->active_frames++;
+    ass_mutex_unlock(&shared->lock);
+#else
+    check_cache_limits(priv, &shared->cache);
+#endif
+}
+
+static void end_frame_caches(ASS_Renderer *priv)
+{
+#if CONFIG_THREADS
+    RenderShared *shared = priv->shared;
+    ass_mutex_lock(&shared->lock);
+    if (!--shared->active_frames)
+        ass_cond_broadcast(&shared->idle_cond);
+    ass_mutex_unlock(&shared->lock);
+#endif
 }
 
 static void setup_shaper(ASS_Shaper *shaper, ASS_Renderer *render_priv)
@@ -3077,7 +3750,7 @@ ass_start_frame(ASS_Renderer *render_priv, ASS_Track *track,
         && !render_priv->settings.frame_height)
         return false;               // library not initialized
 
-    if (!render_priv->fontselect)
+    if (!render_priv->shared->fontselect)
         return false;
 
     if (render_priv->library != track->library)
@@ -3091,13 +3764,24 @@ ass_start_frame(ASS_Renderer *render_priv, ASS_Track *track,
 
     ass_lazy_track_init(render_priv->library, render_priv->track);
 
-    if (render_priv->library->num_fontdata != render_priv->num_emfonts) {
-        assert(render_priv->library->num_fontdata > render_priv->num_emfonts);
-        render_priv->num_emfonts = ass_update_embedded_fonts(
-            render_priv->fontselect, render_priv->num_emfonts);
+    // the font selection may be in use by other renderers sharing it
+    RenderShared *shared = render_priv->shared;
+    lock_fonts(render_priv);
+    if (render_priv->library->num_fontdata != shared->num_emfonts) {
+        assert(render_priv->library->num_fontdata > shared->num_emfonts);
+        shared->num_emfonts = ass_update_embedded_fonts(
+            shared->fontselect, shared->num_emfonts);
     }
+    unlock_fonts(render_priv);
 
     setup_shaper(render_priv->state.shaper, render_priv);
+    image_arena_begin_frame(&render_priv->state.arena);
+#if CONFIG_THREADS
+    for (int i = 0; i < render_priv->n_workers; i++) {
+        setup_shaper(render_priv->workers[i].state.shaper, render_priv);
+        image_arena_begin_frame(&render_priv->workers[i].state.arena);
+    }
+#endif
 
     // PAR correction
     double par = render_priv->settings.par;
@@ -3118,7 +3802,7 @@ ass_start_frame(ASS_Renderer *render_priv, ASS_Track *track,
     render_priv->prev_images_root = render_priv->images_root;
     render_priv->images_root = NULL;
 
-    check_cache_limits(render_priv, &render_priv->cache);
+    begin_frame_caches(render_priv);
 
     return true;
 }
@@ -3328,8 +4012,71 @@ static int ass_image_compare(ASS_Image *i1, ASS_Image *i2)
     return 0;
 }
 
+static inline int64_t rect_area(const Rect *r)
+{
+    return (int64_t) (r->x1 - r->x0) * (r->y1 - r->y0);
+}
+
+static inline void rect_combine(Rect *dst, const Rect *src)
+{
+    dst->x0 = FFMIN(dst->x0, src->x0);
+    dst->y0 = FFMIN(dst->y0, src->y0);
+    dst->x1 = FFMAX(dst->x1, src->x1);
+    dst->y1 = FFMAX(dst->y1, src->y1);
+}
+
+/**
+ * \brief Merge the two rectangles whose bounding box adds the least area
+ */
+static void merge_closest_rects(Rect *rects, int *n)
+{
+    int best_i = 0, best_j = 1;
+    int64_t best_cost = INT64_MAX;
+    for (int i = 0; i < *n; i++)
+        for (int j = i + 1; j < *n; j++) {
+            Rect r = rects[i];
+            rect_combine(&r, &rects[j]);
+            int64_t cost = rect_area(&r) - rect_area(&rects[i]) - rect_area(&rects[j]);
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_i = i;
+                best_j = j;
+            }
+        }
+    rect_combine(&rects[best_i], &rects[best_j]);
+    rects[best_j] = rects[--*n];
+}
+
+/**
+ * \brief Add an image's area to the damaged region of the frame
+ * Overlapping rectangles are combined, and the closest ones are merged
+ * when there are too many, so that the number of rectangles stays bounded.
+ */
+static void add_damage(ASS_Renderer *priv, const ASS_Image *img)
+{
+    if (img->w <= 0 || img->h <= 0)
+        return;
+
+    Rect r = {
+        img->dst_x, img->dst_y,
+        img->dst_x + img->w, img->dst_y + img->h
+    };
+    for (int i = 0; i < priv->n_damage;) {
+        if (overlap(&r, &priv->damage[i])) {
+            rect_combine(&r, &priv->damage[i]);
+            priv->damage[i] = priv->damage[--priv->n_damage];
+            i = 0;  // the grown rectangle may overlap earlier ones
+        } else
+            i++;
+    }
+    priv->damage[priv->n_damage++] = r;
+    if (priv->n_damage == DAMAGE_MAX_RECTS)
+        merge_closest_rects(priv->damage, &priv->n_damage);
+}
+
 /**
  * \brief compare current and previous image list
+ * Also collects the areas of all differing images in priv->damage.
  * \param priv library handle
  * \return 0 if identical, 1 if different positions, 2 if different content
  */
@@ -3341,28 +4088,639 @@ static int ass_detect_change(ASS_Renderer *priv)
     img = priv->prev_images_root;
     img2 = priv->images_root;
     diff = 0;
-    while (img && diff < 2) {
-        ASS_Image *next, *next2;
-        next = img->next;
-        if (img2) {
-            int d = ass_image_compare(img, img2);
-            if (d > diff)
-                diff = d;
-            next2 = img2->next;
-        } else {
-            // previous list is shorter
-            diff = 2;
+    priv->n_damage = 0;
+    while (img || img2) {
+        // an image without counterpart in the other list is a content change
+        int d = img && img2 ? ass_image_compare(img, img2) : 2;
+        if (d) {
+            if (img)
+                add_damage(priv, img);
+            if (img2)
+                add_damage(priv, img2);
+            diff = FFMAX(diff, d);
+        }
+        img = img ? img->next : NULL;
+        img2 = img2 ? img2->next : NULL;
+    }
+
+    return diff;
+}
+
+int ass_get_damage_rects(ASS_Renderer *priv, ASS_DamageRect *rects, int max_rects)
+{
+    if (max_rects <= 0)
+        return 0;
+
+    if (priv->n_damage < 0) {
+        rects[0] = (ASS_DamageRect) { 0, 0, priv->width, priv->height };
+        return 1;
+    }
+
+    Rect damage[DAMAGE_MAX_RECTS];
+    int n = priv->n_damage;
+    memcpy(damage, priv->damage, n * sizeof(Rect));
+    while (n > max_rects)
+        merge_closest_rects(damage, &n);
+    for (int i = 0; i < n; i++)
+        rects[i] = (ASS_DamageRect) {
+            damage[i].x0, damage[i].y0, damage[i].x1, damage[i].y1
+        };
+    return n;
+}
+
+static void render_queued_event(RenderContext *state, EventImages *event_images)
+{
+    if (event_images->reused)
+        return;
+    if (!ass_render_event(state, event_images->event, event_images))
+        event_images->event = NULL;
+}
+
+#if CONFIG_THREADS
+static void render_queued_events(RenderContext *state)
+{
+    ASS_Renderer *priv = state->renderer;
+    while (true) {
+        ass_mutex_lock(&priv->worker_lock);
+        int i = priv->next_job < priv->n_jobs ? priv->next_job++ : -1;
+        ass_mutex_unlock(&priv->worker_lock);
+        if (i < 0)
             break;
+        render_queued_event(state, priv->eimg + i);
+    }
+}
+#endif
+
+/**
+ * \brief Render events queued in eimg
+ * Uses worker threads if available. Events that don't produce any images
+ * are removed, the relative order of the rest is preserved.
+ * \return number of rendered events
+ */
+static int render_events(ASS_Renderer *priv, int cnt)
+{
+#if CONFIG_THREADS
+    if (priv->n_workers && cnt > 1) {
+        ass_mutex_lock(&priv->worker_lock);
+        priv->next_job = 0;
+        priv->n_jobs = cnt;
+        priv->workers_busy = priv->n_workers;
+        priv->frame_seq++;
+        ass_cond_broadcast(&priv->worker_cond);
+        ass_mutex_unlock(&priv->worker_lock);
+
+        render_queued_events(&priv->state);
+
+        ass_mutex_lock(&priv->worker_lock);
+        while (priv->workers_busy)
+            ass_cond_wait(&priv->done_cond, &priv->worker_lock);
+        ass_mutex_unlock(&priv->worker_lock);
+    } else
+#endif
+    {
+        for (int i = 0; i < cnt; i++)
+            render_queued_event(&priv->state, priv->eimg + i);
+    }
+
+    int n = 0;
+    for (int i = 0; i < cnt; i++) {
+        if (priv->eimg[i].event)
+            priv->eimg[n++] = priv->eimg[i];
+        else
+            free_event_layout(priv->eimg[i].layout);
+    }
+    return n;
+}
+
+/**
+ * \brief Queue the events active at a timestamp in eimg
+ * \return number of queued events
+ */
+static int queue_events(ASS_Renderer *priv, ASS_Track *track, long long now)
+{
+    int cnt = ass_find_active_events(track, now, &priv->event_ids,
+                                     &priv->max_event_ids);
+    if (cnt <= 0)
+        return 0;
+    if (cnt > priv->eimg_size) {
+        int size = FFMAX(cnt, priv->eimg_size + 100);
+        if (!ASS_REALLOC_ARRAY(priv->eimg, size))
+            return 0;
+        priv->eimg_size = size;
+    }
+    for (int i = 0; i < cnt; i++)
+        priv->eimg[i] = (EventImages) {
+            .event = track->events + priv->event_ids[i],
+        };
+    return cnt;
+}
+
+static void drop_cached_events(ASS_Renderer *priv)
+{
+    for (int i = 0; i < priv->n_cached_events; i++) {
+        ass_frame_unref(priv->cached_events[i].result.imgs);
+        free_event_layout(priv->cached_events[i].layout);
+    }
+    priv->n_cached_events = 0;
+}
+
+static int cmp_cached_event(const void *p1, const void *p2)
+{
+    const CachedEvent *e1 = p1, *e2 = p2;
+    return e1->event_id - e2->event_id;
+}
+
+static CachedEvent *find_cached_event(ASS_Renderer *priv, int event_id)
+{
+    if (!priv->n_cached_events)
+        return NULL;
+    CachedEvent key = { .event_id = event_id };
+    return bsearch(&key, priv->cached_events, priv->n_cached_events,
+                   sizeof(CachedEvent), cmp_cached_event);
+}
+
+/**
+ * \brief Copy an image list, sharing the bitmaps
+ * Only images backed by the composite cache can be copied.
+ * Copies kept beyond the current frame are allocated without an arena.
+ */
+static bool clone_images(ImageArena *arena, ASS_Image *img, ASS_Image **out)
+{
+    ASS_Image *head = NULL, **tail = &head;
+    for (; img; img = img->next) {
+        CompositeHashValue *source = ((ASS_ImagePriv *) img)->source;
+        ASS_Image *copy = source ?
+            my_draw_bitmap(arena, img->bitmap, img->w, img->h, img->stride,
+                           img->dst_x, img->dst_y, img->color, source) : NULL;
+        if (!copy) {
+            *tail = NULL;
+            ass_frame_ref(head);
+            ass_frame_unref(head);
+            return false;
         }
-        img = next;
-        img2 = next2;
+        *tail = copy;
+        tail = &copy->next;
+    }
+    *tail = NULL;
+    *out = head;
+    return true;
+}
+
+/**
+ * \brief Fill in queued events whose result is kept from the last frame
+ * Such events are marked as reused, so render_events skips them.
+ * Events are only kept if they don't depend on the timestamp, so apart
+ * from them, the result depends on the track, its generation and features,
+ * the settings and the fonts. The same goes for the layouts kept
+ * for animated events, which are handed over to be rendered with.
+ */
+static void reuse_cached_events(ASS_Renderer *priv, ASS_Track *track, int cnt)
+{
+    lock_fonts(priv);
+    int emfonts = priv->shared->num_emfonts;
+    unlock_fonts(priv);
+    uint32_t features = track->parser_priv->feature_flags;
+    unsigned removals = track->parser_priv->event_removals;
+    unsigned generation = track->parser_priv->generation;
+    if (track != priv->cached_track || priv->render_id != priv->cached_render_id ||
+            emfonts != priv->cached_emfonts || features != priv->cached_features ||
+            removals != priv->cached_removals ||
+            generation != priv->cached_generation) {
+        drop_cached_events(priv);
+        priv->cached_track = track;
+        priv->cached_render_id = priv->render_id;
+        priv->cached_emfonts = emfonts;
+        priv->cached_features = features;
+        priv->cached_removals = removals;
+        priv->cached_generation = generation;
     }
 
-    // is the previous list longer?
-    if (img2)
-        diff = 2;
+    for (int i = 0; i < cnt; i++) {
+        EventImages *event_images = priv->eimg + i;
+        ASS_Event *event = event_images->event;
+        CachedEvent *cached = find_cached_event(priv, event - track->events);
+        if (cached && cached->layout) {
+            event_images->layout = cached->layout;
+            cached->layout = NULL;
+            continue;
+        }
+        ASS_Image *imgs;
+        if (!cached || !clone_images(&priv->state.arena,
+                                          cached->result.imgs, &imgs))
+            continue;
+        *event_images = cached->result;
+        event_images->event = event;
+        event_images->imgs = imgs;
+        event_images->reused = true;
+    }
+}
 
-    return diff;
+/**
+ * \brief Keep the results of this frame's static events for the next one,
+ * and the layouts of animated ones
+ * Must be called before collision handling moves the images.
+ */
+static void cache_static_events(ASS_Renderer *priv, ASS_Track *track, int cnt)
+{
+    if (cnt > priv->max_cached_events) {
+        int max = FFMAX(cnt, 2 * priv->max_cached_events);
+        if (!ASS_REALLOC_ARRAY(priv->cached_events, max) ||
+                !ASS_REALLOC_ARRAY(priv->cached_events_tmp, max)) {
+            for (int i = 0; i < cnt; i++) {
+                free_event_layout(priv->eimg[i].layout);
+                priv->eimg[i].layout = NULL;
+            }
+            return;
+        }
+        priv->max_cached_events = max;
+    }
+
+    CachedEvent *kept = priv->cached_events_tmp;
+    int n = 0;
+    for (int i = 0; i < cnt; i++) {
+        EventImages *event_images = priv->eimg + i;
+        int event_id = event_images->event - track->events;
+        if (event_images->reused) {
+            // move the entry over
+            CachedEvent *cached = find_cached_event(priv, event_id);
+            kept[n++] = *cached;
+            cached->result.imgs = NULL;
+            continue;
+        }
+        if (event_images->layout) {
+            kept[n++] = (CachedEvent) {
+                .event_id = event_id,
+                .layout = event_images->layout,
+            };
+            event_images->layout = NULL;
+            continue;
+        }
+        ASS_Image *imgs;
+        if (event_images->animated || !clone_images(NULL, event_images->imgs, &imgs))
+            continue;
+        ass_frame_ref(imgs);
+        kept[n] = (CachedEvent) { event_id, *event_images };
+        kept[n++].result.imgs = imgs;
+    }
+    qsort(kept, n, sizeof(CachedEvent), cmp_cached_event);
+
+    drop_cached_events(priv);
+    priv->cached_events_tmp = priv->cached_events;
+    priv->cached_events = kept;
+    priv->n_cached_events = n;
+}
+
+#if CONFIG_THREADS
+
+// Everything the rendering of a frame depends on besides the track,
+// fonts and caches
+typedef struct {
+    ASS_Settings settings;
+    int width, height;
+    int frame_content_height, frame_content_width;
+    double fit_height, fit_width;
+    ASS_Style user_override_style;
+} FrameConfig;
+
+struct prerenderer {
+    ASS_Renderer *renderer;     // shares fonts and caches with its owner
+    ASS_Thread thread;
+
+    ASS_Mutex lock;             // guards all fields below
+    ASS_Cond cond;              // signaled on new requests and on exit
+    ASS_Cond idle_cond;         // signaled when a frame is finished
+
+    FrameConfig config;         // owner's settings as of the latest request
+    bool config_changed;
+
+    ASS_Track *track;           // owned copy of the events to pre-render
+    long long *times;
+    int n_times, max_times;
+    int next_time;
+    ASS_Track *busy;            // copy a frame is being pre-rendered from
+    bool exit;
+};
+
+// dst is left unchanged on failure
+static bool frame_config_copy(FrameConfig *dst, const FrameConfig *src)
+{
+    char *font_name = NULL;
+    if (src->user_override_style.FontName &&
+            !(font_name = strdup(src->user_override_style.FontName)))
+        return false;
+    free(dst->user_override_style.FontName);
+    *dst = *src;
+    // only needed for ass_set_fonts
+    dst->settings.default_font = NULL;
+    dst->settings.default_family = NULL;
+    dst->user_override_style.FontName = font_name;
+    return true;
+}
+
+static FrameConfig get_frame_config(ASS_Renderer *priv)
+{
+    return (FrameConfig) {
+        .settings = priv->settings,
+        .width = priv->width,
+        .height = priv->height,
+        .frame_content_height = priv->frame_content_height,
+        .frame_content_width = priv->frame_content_width,
+        .fit_height = priv->fit_height,
+        .fit_width = priv->fit_width,
+        .user_override_style = priv->user_override_style,
+    };
+}
+
+static bool set_frame_config(ASS_Renderer *priv, const FrameConfig *config)
+{
+    FrameConfig cur = get_frame_config(priv);
+    if (!frame_config_copy(&cur, config))
+        return false;
+    priv->settings = cur.settings;
+    priv->width = cur.width;
+    priv->height = cur.height;
+    priv->frame_content_height = cur.frame_content_height;
+    priv->frame_content_width = cur.frame_content_width;
+    priv->fit_height = cur.fit_height;
+    priv->fit_width = cur.fit_width;
+    priv->user_override_style = cur.user_override_style;
+    return true;
+}
+
+/**
+ * \brief Render a frame only for its effect on the caches
+ * Positioning and collision handling don't create cache entries
+ * and are skipped.
+ */
+static void prerender_frame(ASS_Renderer *priv, ASS_Track *track, long long now)
+{
+    if (!ass_start_frame(priv, track, now))
+        return;
+
+    int cnt = render_events(priv, queue_events(priv, track, now));
+
+    ASS_Image **tail = &priv->images_root;
+    for (int i = 0; i < cnt; i++) {
+        free_event_layout(priv->eimg[i].layout);
+        *tail = priv->eimg[i].imgs;
+        while (*tail)
+            tail = &(*tail)->next;
+    }
+    ass_frame_ref(priv->images_root);
+    ass_frame_unref(priv->images_root);
+    priv->images_root = NULL;
+
+    end_frame_caches(priv);
+}
+
+static void *prerender_thread(void *arg)
+{
+    Prerenderer *pre = arg;
+
+    ass_mutex_lock(&pre->lock);
+    while (true) {
+        while (!pre->exit && pre->next_time >= pre->n_times)
+            ass_cond_wait(&pre->cond, &pre->lock);
+        if (pre->exit)
+            break;
+        long long now = pre->times[pre->next_time++];
+        if (pre->config_changed && set_frame_config(pre->renderer, &pre->config))
+            pre->config_changed = false;
+        ASS_Track *track = pre->busy = pre->track;
+        ass_mutex_unlock(&pre->lock);
+
+        prerender_frame(pre->renderer, track, now);
+
+        ass_mutex_lock(&pre->lock);
+        // replaced by a new request in the meantime
+        if (track != pre->track)
+            ass_free_track(track);
+        pre->busy = NULL;
+        ass_cond_broadcast(&pre->idle_cond);
+    }
+    ass_mutex_unlock(&pre->lock);
+
+    return NULL;
+}
+
+static Prerenderer *prerender_new(ASS_Renderer *priv)
+{
+    Prerenderer *pre = calloc(1, sizeof(Prerenderer));
+    if (!pre)
+        return NULL;
+
+    pre->renderer = ass_renderer_init_shared(priv);
+    if (!pre->renderer)
+        goto fail;
+    if (!ass_mutex_init(&pre->lock))
+        goto fail_renderer;
+    if (!ass_cond_init(&pre->cond))
+        goto fail_lock;
+    if (!ass_cond_init(&pre->idle_cond))
+        goto fail_cond;
+    if (!ass_thread_create(&pre->thread, prerender_thread, pre))
+        goto fail_idle_cond;
+    return pre;
+
+fail_idle_cond:
+    ass_cond_destroy(&pre->idle_cond);
+fail_cond:
+    ass_cond_destroy(&pre->cond);
+fail_lock:
+    ass_mutex_destroy(&pre->lock);
+fail_renderer:
+    ass_renderer_done(pre->renderer);
+fail:
+    free(pre);
+    return NULL;
+}
+
+// must be called with pre->lock held
+static void prerender_wait_idle(Prerenderer *pre)
+{
+    pre->next_time = pre->n_times = 0;
+    while (pre->busy)
+        ass_cond_wait(&pre->idle_cond, &pre->lock);
+}
+
+static void stop_prerender(ASS_Renderer *priv)
+{
+    Prerenderer *pre = priv->prerender;
+    if (!pre)
+        return;
+
+    ass_mutex_lock(&pre->lock);
+    pre->exit = true;
+    ass_cond_signal(&pre->cond);
+    ass_mutex_unlock(&pre->lock);
+    ass_thread_join(&pre->thread);
+
+    ass_cond_destroy(&pre->idle_cond);
+    ass_cond_destroy(&pre->cond);
+    ass_mutex_destroy(&pre->lock);
+    ass_renderer_done(pre->renderer);
+    ass_free_track(pre->track);
+    free(pre->config.user_override_style.FontName);
+    free(pre->times);
+    free(pre);
+    priv->prerender = NULL;
+}
+
+/**
+ * \brief Copy the events needed to pre-render frames at the given times
+ * The pre-rendering thread works on the copy, so that the track can be
+ * modified and rendered in the meantime.
+ */
+static ASS_Track *copy_prerender_events(ASS_Renderer *priv, ASS_Track *track,
+                                        const long long *times, int n)
+{
+    // flags of the events to copy, compacted to their ids in place
+    int *ids = calloc(FFMAX(track->n_events, 1), sizeof(int));
+    if (!ids)
+        return NULL;
+    for (int i = 0; i < n; i++) {
+        int cnt = ass_find_active_events(track, times[i], &priv->event_ids,
+                                         &priv->max_event_ids);
+        if (cnt < 0) {
+            free(ids);
+            return NULL;
+        }
+        for (int j = 0; j < cnt; j++)
+            ids[priv->event_ids[j]] = 1;
+    }
+    int n_ids = 0;
+    for (int i = 0; i < track->n_events; i++)
+        if (ids[i])
+            ids[n_ids++] = i;
+
+    ASS_Track *copy = ass_copy_track_events(track, ids, n_ids);
+    free(ids);
+    return copy;
+}
+
+#endif
+
+int ass_prerender_frames(ASS_Renderer *priv, ASS_Track *track,
+                         const long long *times, int n)
+{
+#if CONFIG_THREADS
+    if (n <= 0 || priv->library != track->library)
+        return 0;
+
+    if (!priv->prerender && !(priv->prerender = prerender_new(priv))) {
+        ass_msg(priv->library, MSGL_WARN, "Failed to start pre-rendering thread");
+        return 0;
+    }
+    Prerenderer *pre = priv->prerender;
+
+    // renderers of a group may be rendering the track
+    ass_mutex_lock(&track->parser_priv->render_lock);
+    ass_lazy_track_init(priv->library, track);
+    ass_update_event_index(track, true);
+    ASS_Track *copy = copy_prerender_events(priv, track, times, n);
+    ass_mutex_unlock(&track->parser_priv->render_lock);
+    if (!copy)
+        return 0;
+
+    ass_mutex_lock(&pre->lock);
+    FrameConfig config = get_frame_config(priv);
+    if (n > pre->max_times) {
+        long long *times_new = realloc(pre->times, n * sizeof(long long));
+        if (!times_new)
+            goto fail;
+        pre->times = times_new;
+        pre->max_times = n;
+    }
+    if (!frame_config_copy(&pre->config, &config))
+        goto fail;
+    // a copy still in use is freed by the thread
+    if (pre->track != pre->busy)
+        ass_free_track(pre->track);
+    pre->track = copy;
+    memcpy(pre->times, times, n * sizeof(long long));
+    pre->n_times = n;
+    pre->next_time = 0;
+    pre->config_changed = true;
+    ass_cond_signal(&pre->cond);
+    ass_mutex_unlock(&pre->lock);
+    return n;
+
+fail:
+    ass_mutex_unlock(&pre->lock);
+    ass_free_track(copy);
+    return 0;
+#else
+    return 0;
+#endif
+}
+
+void ass_prerender_cancel(ASS_Renderer *priv)
+{
+#if CONFIG_THREADS
+    Prerenderer *pre = priv->prerender;
+    if (!pre)
+        return;
+
+    ass_mutex_lock(&pre->lock);
+    prerender_wait_idle(pre);
+    ass_free_track(pre->track);
+    pre->track = NULL;
+    ass_mutex_unlock(&pre->lock);
+#endif
+}
+
+static void stats_begin_frame(ASS_Renderer *priv)
+{
+    memset(priv->state.stage_time, 0, sizeof(priv->state.stage_time));
+#if CONFIG_THREADS
+    for (int i = 0; i < priv->n_workers; i++)
+        memset(priv->workers[i].state.stage_time, 0,
+               sizeof(priv->workers[i].state.stage_time));
+#endif
+}
+
+static void add_stage_times(ASS_RenderStats *stats, const int64_t *stage_time)
+{
+    stats->parse_time += stage_time[STAGE_PARSE] / 1e6;
+    stats->shape_time += stage_time[STAGE_SHAPE] / 1e6;
+    stats->outline_time += stage_time[STAGE_OUTLINE] / 1e6;
+    stats->rasterize_time += stage_time[STAGE_RASTERIZE] / 1e6;
+    stats->blur_time += stage_time[STAGE_BLUR] / 1e6;
+    stats->composite_time += stage_time[STAGE_COMPOSITE] / 1e6;
+}
+
+static size_t get_scratch_size(ASS_Renderer *priv)
+{
+    size_t size = priv->state.scratch.size;
+#if CONFIG_THREADS
+    for (int i = 0; i < priv->n_workers; i++)
+        size += priv->workers[i].state.scratch.size;
+#endif
+    return size;
+}
+
+/**
+ * \brief Free the scratch buffers of all rendering threads
+ * They are otherwise kept from frame to frame to avoid reallocating them.
+ * Must not be called while a frame is being rendered.
+ */
+void ass_release_scratch(ASS_Renderer *priv)
+{
+    ass_scratch_done(&priv->state.scratch);
+#if CONFIG_THREADS
+    for (int i = 0; i < priv->n_workers; i++)
+        ass_scratch_done(&priv->workers[i].state.scratch);
+#endif
+}
+
+static void stats_end_frame(ASS_Renderer *priv, int64_t frame_start)
+{
+    add_stage_times(&priv->stats, priv->state.stage_time);
+#if CONFIG_THREADS
+    for (int i = 0; i < priv->n_workers; i++)
+        add_stage_times(&priv->stats, priv->workers[i].state.stage_time);
+#endif
+    priv->stats.frame_time = (ass_time_ns() - frame_start) / 1e6;
 }
 
 /**
@@ -3374,38 +4732,42 @@ static int ass_detect_change(ASS_Renderer *priv)
  *        0 if identical, 1 if different positions, 2 if different content.
  *        Can be NULL, in that case no detection is performed.
  */
-ASS_Image *ass_render_frame(ASS_Renderer *priv, ASS_Track *track,
-                            long long now, int *detect_change)
+static ASS_Image *render_frame(ASS_Renderer *priv, ASS_Track *track,
+                               long long now, int *detect_change)
 {
+    int64_t frame_start = 0;
+    memset(&priv->stats, 0, sizeof(priv->stats));
+    priv->n_damage = -1;
+    if (priv->stats_enabled) {
+        frame_start = ass_time_ns();
+        stats_begin_frame(priv);
+    }
+
     // init frame
     if (!ass_start_frame(priv, track, now)) {
         if (detect_change)
             *detect_change = 2;
+        if (priv->atlas)
+            ass_atlas_update(priv->atlas, NULL);
         return NULL;
     }
 
-    // render events separately
-    int cnt = 0;
-    for (int i = 0; i < track->n_events; i++) {
-        ASS_Event *event = track->events + i;
-        if ((event->Start <= now)
-            && (now < (event->Start + event->Duration))) {
-            if (cnt >= priv->eimg_size) {
-                priv->eimg_size += 100;
-                priv->eimg =
-                    realloc(priv->eimg,
-                            priv->eimg_size * sizeof(EventImages));
-            }
-            if (ass_render_event(&priv->state, event, priv->eimg + cnt))
-                cnt++;
-        }
-    }
+    // render events separately, except for those unchanged since
+    // the last frame
+    ass_update_event_index(track, false);
+    int cnt = queue_events(priv, track, now);
+    reuse_cached_events(priv, track, cnt);
+    cnt = render_events(priv, cnt);
+    cache_static_events(priv, track, cnt);
+    priv->stats.n_events = cnt;
+    priv->stats.scratch_size = get_scratch_size(priv);
 
     // sort by layer
     if (cnt > 0)
         qsort(priv->eimg, cnt, sizeof(EventImages), cmp_event_layer);
 
     // call fix_collisions for each group of events with the same layer
+    int64_t collision_start = priv->stats_enabled ? ass_time_ns() : 0;
     EventImages *last = priv->eimg;
     for (int i = 1; i < cnt; i++)
         if (last->event->Layer != priv->eimg[i].event->Layer) {
@@ -3414,6 +4776,8 @@ ASS_Image *ass_render_frame(ASS_Renderer *priv, ASS_Track *track,
         }
     if (cnt > 0)
         fix_collisions(priv, last, priv->eimg + cnt - last);
+    if (priv->stats_enabled)
+        priv->stats.collision_time = (ass_time_ns() - collision_start) / 1e6;
 
     // concat lists
     ASS_Image **tail = &priv->images_root;
@@ -3427,6 +4791,9 @@ ASS_Image *ass_render_frame(ASS_Renderer *priv, ASS_Track *track,
     }
     ass_frame_ref(priv->images_root);
 
+    if (priv->atlas && !ass_atlas_update(priv->atlas, priv->images_root))
+        ass_msg(priv->library, MSGL_WARN, "Failed to update glyph atlas");
+
     if (detect_change)
         *detect_change = ass_detect_change(priv);
 
@@ -3434,12 +4801,31 @@ ASS_Image *ass_render_frame(ASS_Renderer *priv, ASS_Track *track,
     ass_frame_unref(priv->prev_images_root);
     priv->prev_images_root = NULL;
 
+    end_frame_caches(priv);
+
+    if (priv->stats_enabled)
+        stats_end_frame(priv, frame_start);
+
     if (track->parser_priv->prune_delay >= 0)
         ass_prune_events(track, now - track->parser_priv->prune_delay);
 
     return priv->images_root;
 }
 
+// Renderers of a group take turns on the same track, see ASS_ParserPriv
+ASS_Image *ass_render_frame(ASS_Renderer *priv, ASS_Track *track,
+                            long long now, int *detect_change)
+{
+#if CONFIG_THREADS
+    ass_mutex_lock(&track->parser_priv->render_lock);
+#endif
+    ASS_Image *res = render_frame(priv, track, now, detect_change);
+#if CONFIG_THREADS
+    ass_mutex_unlock(&track->parser_priv->render_lock);
+#endif
+    return res;
+}
+
 /**
  * \brief Add reference to a frame image list.
  * \param image_list image list returned by ass_render_frame()
@@ -3460,10 +4846,8 @@ void ass_frame_unref(ASS_Image *img)
     if (!img || --((ASS_ImagePriv *) img)->ref_count)
         return;
     do {
-        ASS_ImagePriv *priv = (ASS_ImagePriv *) img;
-        img = img->next;
-        ass_cache_dec_ref(priv->source);
-        ass_aligned_free(priv->buffer);
-        free(priv);
+        ASS_Image *next = img->next;
+        free_image(img);
+        img = next;
     } while (img);
 }
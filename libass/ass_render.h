@@ -39,20 +39,35 @@
 #include "ass_drawing.h"
 #include "ass_bitmap.h"
 #include "ass_rasterizer.h"
+#include "ass_threading.h"
+#include "ass_atlas.h"
 
 #define GLYPH_CACHE_MAX 10000
 #define MEGABYTE (1024 * 1024)
 #define BITMAP_CACHE_MAX_SIZE (128 * MEGABYTE)
 #define COMPOSITE_CACHE_RATIO 2
 #define COMPOSITE_CACHE_MAX_SIZE (BITMAP_CACHE_MAX_SIZE / COMPOSITE_CACHE_RATIO)
+// freed bitmap buffers are kept up to this fraction of the cache limits
+#define BITMAP_POOL_RATIO 8
+#define DAMAGE_MAX_RECTS 64
 
 #define PARSED_FADE (1<<0)
 #define PARSED_A    (1<<1)
 
+typedef struct image_block ImageBlock;
+
+// Allocates the images of a frame, see ass_render.c
+typedef struct {
+    ImageBlock *block;          // current block, NULL if none
+    size_t block_size;          // size of the latest block
+} ImageArena;
+
 typedef struct {
     ASS_Image result;
     CompositeHashValue *source;
-    unsigned char *buffer;
+    unsigned char *buffer;      // bitmap owned by the image, if any
+    ImageBlock *block;          // block of the image, NULL if on the heap
+    ImageBlock *buffer_block;   // same for the buffer
     size_t ref_count;
 } ASS_ImagePriv;
 
@@ -79,6 +94,16 @@ typedef struct {
     char *default_family;
 } ASS_Settings;
 
+// What an event's animation changes from frame to frame.
+// Layout can be reused if only the position and colors change.
+typedef enum {
+    ANIM_POSITION = 1 << 0,     // \move, Banner and Scroll effects
+    ANIM_COLOR    = 1 << 1,     // \fad, \t with color and alpha tags only
+    ANIM_LAYOUT   = 1 << 2,     // anything else
+} AnimationFlags;
+
+typedef struct event_layout EventLayout;
+
 // a rendered event
 typedef struct {
     ASS_Image *imgs;
@@ -86,8 +111,18 @@ typedef struct {
     int detect_collisions;
     int shift_direction;
     ASS_Event *event;
+    bool animated;              // depends on the frame's timestamp
+    bool reused;                // taken from the previous frame
+    EventLayout *layout;        // owned; layout to reuse in the next frame
 } EventImages;
 
+// result of a static event, kept for the following frames
+typedef struct {
+    int event_id;
+    EventImages result;         // owns a reference to result.imgs
+    EventLayout *layout;        // instead of result for animated events
+} CachedEvent;
+
 typedef enum {
     EF_NONE = 0,
     EF_KARAOKE,
@@ -205,6 +240,17 @@ typedef struct {
 
 #include "ass_shaper.h"
 
+// stages of rendering timed for ass_get_render_stats
+typedef enum {
+    STAGE_PARSE,
+    STAGE_SHAPE,
+    STAGE_OUTLINE,
+    STAGE_RASTERIZE,
+    STAGE_BLUR,
+    STAGE_COMPOSITE,
+    STAGE_COUNT
+} RenderStage;
+
 // Renderer state.
 // Values like current font face, color, screen position, clipping and so on are stored here.
 struct render_context {
@@ -212,6 +258,9 @@ struct render_context {
     TextInfo text_info;
     ASS_Shaper *shaper;
     RasterizerData rasterizer;
+    int64_t stage_time[STAGE_COUNT];    // ns, if stats are enabled
+    ImageArena arena;
+    ScratchBuffer scratch;      // for blur filters
 
     ASS_Event *event;
     ASS_Style *style;
@@ -243,6 +292,7 @@ struct render_context {
     char have_origin;           // origin is explicitly defined; if 0, get_base_point() is used
     char clip_mode;             // 1 = iclip
     char detect_collisions;
+    int animated;               // AnimationFlags, what the frame's timestamp affected
     char be;                    // blur edges
     int fade;                   // alpha from \fad
     double blur;                // gaussian blur
@@ -295,8 +345,18 @@ struct render_context {
     double blur_scale_y;
 };
 
+typedef struct {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+} Rect;
+
 typedef struct render_context RenderContext;
 
+typedef struct render_worker RenderWorker;
+typedef struct prerenderer Prerenderer;
+
 typedef struct {
     Cache *font_cache;
     Cache *outline_cache;
@@ -304,16 +364,44 @@ typedef struct {
     Cache *composite_cache;
     Cache *face_size_metrics_cache;
     Cache *metrics_cache;
+    BitmapPool *bitmap_pool;    // for the bitmaps of all caches
     size_t glyph_max;
     size_t bitmap_max_size;
     size_t composite_max_size;
 } CacheStore;
 
-struct ass_renderer {
-    ASS_Library *library;
+// Fonts and caches, shared by all renderers created with
+// ass_renderer_init_shared from the same original renderer.
+// All cache keys must therefore be independent of per-renderer settings.
+typedef struct {
+    int ref_count;              // number of renderers using it
     FT_Library ftlibrary;
     ASS_FontSelector *fontselect;
     size_t num_emfonts;
+    CacheStore cache;
+    // renderers of a group may render the same track one after another,
+    // so they need distinct ids for the collision state kept in its events
+    int last_render_id;
+
+#if CONFIG_THREADS
+    // guards ref_count, last_render_id, active_frames
+    // and the limits in cache
+    ASS_Mutex lock;
+    ASS_Cond idle_cond;         // signaled when active_frames drops to zero
+    // Number of renderers currently inside ass_render_frame.
+    // Values returned by ass_cache_get are only valid until
+    // the next ass_cache_cut, so caches are only cut while it's zero.
+    int active_frames;
+    // Serializes the stages of event rendering which access FreeType
+    // and HarfBuzz objects owned by ASS_Font and font selection.
+    ASS_Mutex font_lock;
+#endif
+} RenderShared;
+
+struct ass_renderer {
+    ASS_Library *library;
+    RenderShared *shared;
+    CacheStore *cache;          // = &shared->cache
     ASS_Settings settings;
     int render_id;
 
@@ -322,6 +410,19 @@ struct ass_renderer {
 
     EventImages *eimg;          // temporary buffer for sorting rendered events
     int eimg_size;              // allocated buffer size
+    int *event_ids;             // temporary buffer for ass_find_active_events
+    int max_event_ids;
+
+    // results of static events of the last frame, sorted by event_id;
+    // valid for the track, settings and fonts they were rendered with
+    CachedEvent *cached_events, *cached_events_tmp;
+    int n_cached_events, max_cached_events;
+    ASS_Track *cached_track;
+    int cached_render_id;
+    int cached_emfonts;
+    uint32_t cached_features;
+    unsigned cached_removals;
+    unsigned cached_generation;
 
     // frame-global data
     int width, height;          // screen dimensions (the whole frame from ass_set_frame_size)
@@ -334,11 +435,36 @@ struct ass_renderer {
     double par_scale_x;        // x scale applied to all glyphs to preserve text aspect ratio
 
     RenderContext state;
-    CacheStore cache;
+
+#if CONFIG_THREADS
+    // additional threads for ass_render_frame, see ass_set_threads
+    int n_workers;
+    RenderWorker *workers;
+    ASS_Mutex worker_lock;      // guards all worker-related fields below
+    ASS_Cond worker_cond;       // signaled when a new frame is started or on exit
+    ASS_Cond done_cond;         // signaled when the last busy worker finishes
+    unsigned frame_seq;
+    int workers_busy;
+    int next_job, n_jobs;
+    bool workers_exit;
+
+    // background thread for ass_prerender_frames, started on first use
+    Prerenderer *prerender;
+#endif
 
     BitmapEngine engine;
 
     ASS_Style user_override_style;
+
+    // regions changed by the last frame, see ass_get_damage_rects;
+    // n_damage is -1 if unknown
+    Rect damage[DAMAGE_MAX_RECTS];
+    int n_damage;
+
+    ASS_Atlas *atlas;           // see ass_set_atlas
+
+    bool stats_enabled;         // see ass_set_render_stats_enabled
+    ASS_RenderStats stats;      // of the last frame, without cache stats
 };
 
 typedef struct render_priv {
@@ -346,16 +472,11 @@ typedef struct render_priv {
     int render_id;
 } RenderPriv;
 
-typedef struct {
-    int x0;
-    int y0;
-    int x1;
-    int y1;
-} Rect;
-
+int ass_new_render_id(RenderShared *shared);
 void ass_reset_render_context(RenderContext *state, ASS_Style *style);
 void ass_frame_ref(ASS_Image *img);
 void ass_frame_unref(ASS_Image *img);
+void ass_release_scratch(ASS_Renderer *priv);
 ASS_Vector ass_layout_res(ASS_Renderer *render_priv);
 
 // XXX: this is actually in ass.c, includes should be fixed later on
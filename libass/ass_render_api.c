@@ -22,18 +22,37 @@
 
 #include <limits.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "ass_render.h"
 #include "ass_utils.h"
 
+static bool caches_shared(ASS_Renderer *priv)
+{
+    RenderShared *shared = priv->shared;
+#if CONFIG_THREADS
+    ass_mutex_lock(&shared->lock);
+    bool res = shared->ref_count > 1;
+    ass_mutex_unlock(&shared->lock);
+    return res;
+#else
+    return shared->ref_count > 1;
+#endif
+}
+
 static void ass_reconfigure(ASS_Renderer *priv)
 {
     ASS_Settings *settings = &priv->settings;
 
-    priv->render_id++;
-    ass_cache_empty(priv->cache.composite_cache);
-    ass_cache_empty(priv->cache.bitmap_cache);
-    ass_cache_empty(priv->cache.outline_cache);
+    priv->render_id = ass_new_render_id(priv->shared);
+    // Cached values don't depend on the settings, this only drops
+    // the ones that are unlikely to be used again. Shared caches
+    // may still be in use by other renderers, so leave them alone.
+    if (!caches_shared(priv)) {
+        ass_cache_empty(priv->cache->composite_cache);
+        ass_cache_empty(priv->cache->bitmap_cache);
+        ass_cache_empty(priv->cache->outline_cache);
+    }
 
     priv->width = settings->frame_width;
     priv->height = settings->frame_height;
@@ -79,10 +98,13 @@ void ass_set_storage_size(ASS_Renderer *priv, int w, int h)
 void ass_set_shaper(ASS_Renderer *priv, ASS_ShapingLevel level)
 {
     // select the complex shaper for illegal values
-    if (level == ASS_SHAPING_SIMPLE || level == ASS_SHAPING_COMPLEX)
+    if (level != ASS_SHAPING_SIMPLE && level != ASS_SHAPING_COMPLEX)
+        level = ASS_SHAPING_COMPLEX;
+    if (priv->settings.shaper != level) {
         priv->settings.shaper = level;
-    else
-        priv->settings.shaper = ASS_SHAPING_COMPLEX;
+        // kept event results depend on all settings
+        priv->render_id = ass_new_render_id(priv->shared);
+    }
 }
 
 void ass_set_margins(ASS_Renderer *priv, int t, int b, int l, int r)
@@ -99,7 +121,10 @@ void ass_set_margins(ASS_Renderer *priv, int t, int b, int l, int r)
 
 void ass_set_use_margins(ASS_Renderer *priv, int use)
 {
-    priv->settings.use_margins = use;
+    if (priv->settings.use_margins != use) {
+        priv->settings.use_margins = use;
+        priv->render_id = ass_new_render_id(priv->shared);
+    }
 }
 
 void ass_set_aspect_ratio(ASS_Renderer *priv, double dar, double sar)
@@ -134,7 +159,10 @@ void ass_set_hinting(ASS_Renderer *priv, ASS_Hinting ht)
 
 void ass_set_line_spacing(ASS_Renderer *priv, double line_spacing)
 {
-    priv->settings.line_spacing = line_spacing;
+    if (priv->settings.line_spacing != line_spacing) {
+        priv->settings.line_spacing = line_spacing;
+        priv->render_id = ass_new_render_id(priv->shared);
+    }
 }
 
 void ass_set_line_position(ASS_Renderer *priv, double line_position)
@@ -149,6 +177,9 @@ void ass_set_fonts(ASS_Renderer *priv, const char *default_font,
                    const char *default_family, int dfp,
                    const char *config, int update)
 {
+    // the font selection is about to be replaced
+    ass_prerender_cancel(priv);
+
     free(priv->settings.default_font);
     free(priv->settings.default_family);
     priv->settings.default_font = default_font ? strdup(default_font) : 0;
@@ -157,13 +188,19 @@ void ass_set_fonts(ASS_Renderer *priv, const char *default_font,
 
     ass_reconfigure(priv);
 
-    ass_cache_empty(priv->cache.font_cache);
-    ass_cache_empty(priv->cache.metrics_cache);
+    // Fonts are shared by all renderers created with ass_renderer_init_shared.
+    // All cached glyphs and bitmaps belong to the old fonts.
+    RenderShared *shared = priv->shared;
+    ass_cache_empty(priv->cache->composite_cache);
+    ass_cache_empty(priv->cache->bitmap_cache);
+    ass_cache_empty(priv->cache->outline_cache);
+    ass_cache_empty(priv->cache->font_cache);
+    ass_cache_empty(priv->cache->metrics_cache);
 
-    if (priv->fontselect)
-        ass_fontselect_free(priv->fontselect);
-    priv->fontselect = ass_fontselect_init(priv->library, priv->ftlibrary,
-            &priv->num_emfonts, default_family, default_font, config, dfp);
+    if (shared->fontselect)
+        ass_fontselect_free(shared->fontselect);
+    shared->fontselect = ass_fontselect_init(priv->library, shared->ftlibrary,
+            &shared->num_emfonts, default_family, default_font, config, dfp);
 }
 
 void ass_set_selective_style_override_enabled(ASS_Renderer *priv, int bits)
@@ -192,8 +229,6 @@ int ass_fonts_update(ASS_Renderer *render_priv)
 void ass_set_cache_limits(ASS_Renderer *render_priv, int glyph_max,
                           int bitmap_max)
 {
-    render_priv->cache.glyph_max = glyph_max ? glyph_max : GLYPH_CACHE_MAX;
-
     size_t bitmap_cache, composite_cache;
     if (bitmap_max) {
         bitmap_cache = MEGABYTE * (size_t) bitmap_max;
@@ -203,13 +238,89 @@ void ass_set_cache_limits(ASS_Renderer *render_priv, int glyph_max,
         bitmap_cache = BITMAP_CACHE_MAX_SIZE;
         composite_cache = COMPOSITE_CACHE_MAX_SIZE;
     }
-    render_priv->cache.bitmap_max_size = bitmap_cache;
-    render_priv->cache.composite_max_size = composite_cache;
+
+    // other renderers of the group may be checking the limits
+    RenderShared *shared = render_priv->shared;
+#if CONFIG_THREADS
+    ass_mutex_lock(&shared->lock);
+#endif
+    shared->cache.glyph_max = glyph_max ? glyph_max : GLYPH_CACHE_MAX;
+    shared->cache.bitmap_max_size = bitmap_cache;
+    shared->cache.composite_max_size = composite_cache;
+#if CONFIG_THREADS
+    ass_mutex_unlock(&shared->lock);
+#endif
+
+    // this renderer's threads are idle between frames
+    ass_release_scratch(render_priv);
+}
+
+void ass_set_cache_policy(ASS_Renderer *priv, ASS_CachePolicy policy)
+{
+    CacheStore *cache = priv->cache;
+    ass_cache_set_policy(cache->font_cache, policy);
+    ass_cache_set_policy(cache->outline_cache, policy);
+    ass_cache_set_policy(cache->bitmap_cache, policy);
+    ass_cache_set_policy(cache->composite_cache, policy);
+    ass_cache_set_policy(cache->face_size_metrics_cache, policy);
+    ass_cache_set_policy(cache->metrics_cache, policy);
 }
 
 ASS_FontProvider *
 ass_create_font_provider(ASS_Renderer *priv, ASS_FontProviderFuncs *funcs,
                          void *data)
 {
-    return ass_font_provider_new(priv->fontselect, funcs, data);
+    return ass_font_provider_new(priv->shared->fontselect, funcs, data);
+}
+
+void ass_set_render_stats_enabled(ASS_Renderer *priv, int enable)
+{
+    priv->stats_enabled = !!enable;
+}
+
+void ass_get_render_stats(ASS_Renderer *priv, ASS_RenderStats *stats)
+{
+    ASS_RenderStats res = priv->stats;
+
+    CacheStore *cache = priv->cache;
+    ass_cache_get_stats(cache->font_cache, &res.font_cache);
+    ass_cache_get_stats(cache->outline_cache, &res.outline_cache);
+    ass_cache_get_stats(cache->bitmap_cache, &res.bitmap_cache);
+    ass_cache_get_stats(cache->composite_cache, &res.composite_cache);
+    ass_cache_get_stats(cache->face_size_metrics_cache, &res.face_size_metrics_cache);
+    ass_cache_get_stats(cache->metrics_cache, &res.metrics_cache);
+
+    // the caller may have been built with an older, smaller struct
+    size_t size = stats->size;
+    if (size <= sizeof(res.size))
+        return;
+    res.size = size;
+    memcpy(stats, &res, FFMIN(size, sizeof(res)));
+}
+
+void ass_get_bitmap_pool_stats(ASS_Renderer *priv, ASS_BitmapPoolStats *stats)
+{
+    ass_bitmap_pool_get_stats(priv->cache->bitmap_pool, stats);
+}
+
+int ass_set_atlas(ASS_Renderer *priv, int page_size, int max_pages)
+{
+    ass_atlas_done(priv->atlas);
+    priv->atlas = NULL;
+    if (page_size <= 0)
+        return 0;
+
+    priv->atlas = ass_atlas_create(page_size, max_pages);
+    return !!priv->atlas;
+}
+
+int ass_get_atlas(ASS_Renderer *priv, const ASS_AtlasPage **pages,
+                  const ASS_AtlasImage **images)
+{
+    if (!priv->atlas) {
+        *pages = NULL;
+        *images = NULL;
+        return 0;
+    }
+    return ass_atlas_get(priv->atlas, pages, images);
 }
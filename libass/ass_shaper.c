@@ -387,6 +387,9 @@ get_h_kerning(hb_font_t *font, void *font_data, hb_codepoint_t first,
     FT_Face face = metrics_priv->hash_key.font->faces[metrics_priv->hash_key.face_index];
     FT_Vector kern;
 
+    // faces are shared, so their current size may have been
+    // changed by any other user since this font was set up
+    ass_face_set_size(face, metrics_priv->hash_key.size);
     if (FT_Get_Kerning(face, first, second, FT_KERNING_DEFAULT, &kern))
         return 0;
 
@@ -866,7 +869,7 @@ void ass_shaper_find_runs(ASS_Shaper *shaper, ASS_Renderer *render_priv,
         GlyphInfo *info = glyphs + i;
         if (!info->drawing_text.str && !info->skip) {
             // get font face and glyph index
-            ass_font_get_index(render_priv->fontselect, info->font,
+            ass_font_get_index(render_priv->shared->fontselect, info->font,
                     info->symbol, &info->face_index, &info->glyph_index);
         }
         if (i > 0) {
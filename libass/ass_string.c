@@ -73,3 +73,14 @@ int ass_strncasecmp(const char *s1, const char *s2, size_t n)
     return a - b;
 }
 
+/**
+ * \brief FNV-1a hash of a string, consistent with ass_strcasecmp
+ */
+uint32_t ass_strcasehash(const char *s)
+{
+    uint32_t hash = 0x811c9dc5;
+    for (; *s; s++)
+        hash = (hash ^ lowertab[(unsigned char) *s]) * 0x01000193;
+    return hash;
+}
+
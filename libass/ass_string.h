@@ -16,6 +16,7 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <stdint.h>
 #include <stdlib.h>
 
 #ifndef ASS_STRING_H
@@ -23,6 +24,7 @@
 
 int ass_strcasecmp(const char *s1, const char *s2);
 int ass_strncasecmp(const char *s1, const char *s2, size_t n);
+uint32_t ass_strcasehash(const char *s);
 
 static inline int ass_isspace(int c)
 {
@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2025 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef LIBASS_THREADING_H
+#define LIBASS_THREADING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Minimal portable wrappers around the native thread primitives.
+// Only available if CONFIG_THREADS is set; callers must guard their use.
+
+#if CONFIG_THREADS
+
+// Atomic operations on size_t counters, with sequentially consistent ordering
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+#include <intrin.h>
+
+#ifdef _WIN64
+#define ASS_INTERLOCKED(op) op##64
+typedef __int64 ass_atomic_int;
+#else
+#define ASS_INTERLOCKED(op) op
+typedef long ass_atomic_int;
+#endif
+
+static inline size_t ass_atomic_load(size_t *ptr)
+{
+    return ASS_INTERLOCKED(_InterlockedCompareExchange)((volatile ass_atomic_int *) ptr, 0, 0);
+}
+
+static inline size_t ass_atomic_add(size_t *ptr, size_t val)
+{
+    return ASS_INTERLOCKED(_InterlockedExchangeAdd)((volatile ass_atomic_int *) ptr, val) + val;
+}
+
+static inline size_t ass_atomic_sub(size_t *ptr, size_t val)
+{
+    return ASS_INTERLOCKED(_InterlockedExchangeAdd)((volatile ass_atomic_int *) ptr, -(ass_atomic_int) val) - val;
+}
+
+static inline bool ass_atomic_cas(size_t *ptr, size_t *expected, size_t desired)
+{
+    size_t prev = ASS_INTERLOCKED(_InterlockedCompareExchange)((volatile ass_atomic_int *) ptr,
+                                                            desired, *expected);
+    if (prev == *expected)
+        return true;
+    *expected = prev;
+    return false;
+}
+
+#else
+
+static inline size_t ass_atomic_load(size_t *ptr)
+{
+    return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+// returns the new value
+static inline size_t ass_atomic_add(size_t *ptr, size_t val)
+{
+    return __atomic_add_fetch(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+// returns the new value
+static inline size_t ass_atomic_sub(size_t *ptr, size_t val)
+{
+    return __atomic_sub_fetch(ptr, val, __ATOMIC_SEQ_CST);
+}
+
+// on failure, *expected is updated with the current value
+static inline bool ass_atomic_cas(size_t *ptr, size_t *expected, size_t desired)
+{
+    return __atomic_compare_exchange_n(ptr, expected, desired, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+#endif
+
+#if !defined(_WIN32) || defined(__CYGWIN__)
+
+#include <pthread.h>
+
+typedef pthread_once_t ASS_Once;
+typedef pthread_mutex_t ASS_Mutex;
+typedef pthread_cond_t ASS_Cond;
+typedef struct {
+    pthread_t handle;
+} ASS_Thread;
+
+#define ASS_ONCE_INIT PTHREAD_ONCE_INIT
+
+// func is called exactly once for each once, later callers wait for it
+static inline void ass_once(ASS_Once *once, void (*func)(void))
+{
+    pthread_once(once, func);
+}
+
+static inline bool ass_mutex_init(ASS_Mutex *mutex)
+{
+    return !pthread_mutex_init(mutex, NULL);
+}
+
+static inline void ass_mutex_destroy(ASS_Mutex *mutex)
+{
+    pthread_mutex_destroy(mutex);
+}
+
+static inline void ass_mutex_lock(ASS_Mutex *mutex)
+{
+    pthread_mutex_lock(mutex);
+}
+
+static inline void ass_mutex_unlock(ASS_Mutex *mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+static inline bool ass_cond_init(ASS_Cond *cond)
+{
+    return !pthread_cond_init(cond, NULL);
+}
+
+static inline void ass_cond_destroy(ASS_Cond *cond)
+{
+    pthread_cond_destroy(cond);
+}
+
+static inline void ass_cond_wait(ASS_Cond *cond, ASS_Mutex *mutex)
+{
+    pthread_cond_wait(cond, mutex);
+}
+
+static inline void ass_cond_signal(ASS_Cond *cond)
+{
+    pthread_cond_signal(cond);
+}
+
+static inline void ass_cond_broadcast(ASS_Cond *cond)
+{
+    pthread_cond_broadcast(cond);
+}
+
+static inline bool ass_thread_create(ASS_Thread *thread,
+                                     void *(*func)(void *), void *arg)
+{
+    return !pthread_create(&thread->handle, NULL, func, arg);
+}
+
+static inline void ass_thread_join(ASS_Thread *thread)
+{
+    pthread_join(thread->handle, NULL);
+}
+
+#else
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+typedef INIT_ONCE ASS_Once;
+typedef SRWLOCK ASS_Mutex;
+typedef CONDITION_VARIABLE ASS_Cond;
+typedef struct {
+    HANDLE handle;
+    void *(*func)(void *);
+    void *arg;
+} ASS_Thread;
+
+#define ASS_ONCE_INIT INIT_ONCE_STATIC_INIT
+
+static inline BOOL CALLBACK ass_once_entry(PINIT_ONCE once, PVOID param,
+                                           PVOID *context)
+{
+    void (**func)(void) = param;
+    (*func)();
+    return TRUE;
+}
+
+// func is called exactly once for each once, later callers wait for it
+static inline void ass_once(ASS_Once *once, void (*func)(void))
+{
+    InitOnceExecuteOnce(once, ass_once_entry, &func, NULL);
+}
+
+static inline bool ass_mutex_init(ASS_Mutex *mutex)
+{
+    InitializeSRWLock(mutex);
+    return true;
+}
+
+static inline void ass_mutex_destroy(ASS_Mutex *mutex)
+{
+}
+
+static inline void ass_mutex_lock(ASS_Mutex *mutex)
+{
+    AcquireSRWLockExclusive(mutex);
+}
+
+static inline void ass_mutex_unlock(ASS_Mutex *mutex)
+{
+    ReleaseSRWLockExclusive(mutex);
+}
+
+static inline bool ass_cond_init(ASS_Cond *cond)
+{
+    InitializeConditionVariable(cond);
+    return true;
+}
+
+static inline void ass_cond_destroy(ASS_Cond *cond)
+{
+}
+
+static inline void ass_cond_wait(ASS_Cond *cond, ASS_Mutex *mutex)
+{
+    SleepConditionVariableSRW(cond, mutex, INFINITE, 0);
+}
+
+static inline void ass_cond_signal(ASS_Cond *cond)
+{
+    WakeConditionVariable(cond);
+}
+
+static inline void ass_cond_broadcast(ASS_Cond *cond)
+{
+    WakeAllConditionVariable(cond);
+}
+
+static inline DWORD WINAPI ass_thread_entry(LPVOID param)
+{
+    ASS_Thread *thread = param;
+    thread->func(thread->arg);
+    return 0;
+}
+
+// thread must stay at the same address until ass_thread_join()
+static inline bool ass_thread_create(ASS_Thread *thread,
+                                     void *(*func)(void *), void *arg)
+{
+    thread->func = func;
+    thread->arg = arg;
+    thread->handle = CreateThread(NULL, 0, ass_thread_entry, thread, 0, NULL);
+    return thread->handle;
+}
+
+static inline void ass_thread_join(ASS_Thread *thread)
+{
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+}
+
+#endif
+
+#endif /* CONFIG_THREADS */
+
+#endif /* LIBASS_THREADING_H */
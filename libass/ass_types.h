@@ -53,9 +53,11 @@
  *    - Before manual changes are performed, it is allowed to call any such API,
  *      unless the documentation of the function says otherwise.
  *    - After manual changes have been performed, no track-modifying API may be
- *      invoked, except for ass_track_set_feature and ass_flush_events.
+ *      invoked, except for ass_track_set_feature, ass_flush_events
+ *      and ass_track_changed.
  *  - After the first call to ass_render_frame, existing array members
- *    (e.g. members of events) and non-array track fields (e.g. PlayResX
+ *    (e.g. members of events) may only be modified if ass_track_changed
+ *    is called afterwards, and non-array track fields (e.g. PlayResX
  *    or event_format) must not be modified. Adding new members to arrays
  *    and updating the corresponding counter remains allowed.
  *  - Adding and removing members to array fields, like events or styles,
@@ -230,10 +232,13 @@ typedef struct ass_event {
  * xy-VSFilter's resolution-depended guess or other (historic) mangling modes.
  * Completely ignoring the color mangling is likely to give bad results.
  *
- * Note that libass doesn't change colors based on this header. It
- * absolutely can't do that, because the video colorspace is required
- * in order to handle this as intended. API users must use the exposed
- * information to perform color mangling as described above.
+ * Note that the images returned by ass_render_frame always carry the
+ * unmodified RGB colors of the script, because the video colorspace is
+ * required in order to handle this header as intended. API users blending
+ * onto YUV frames can pass this header and the colorspace of the frame
+ * to ass_blend_frame_yuv, which converts the colors following the
+ * recommended default behaviour above. Otherwise, API users must use
+ * the exposed information to perform color mangling as described above.
  *
  * Further note all of the above only concerns the RGB values.
  * Color primaries and transfer characteristics of ASS subtitles
@@ -24,6 +24,11 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <inttypes.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 #include "ass_library.h"
 #include "ass.h"
@@ -122,6 +127,25 @@ void ass_msg(ASS_Library *priv, int lvl, const char *fmt, ...)
     va_end(va);
 }
 
+/**
+ * \brief Get a monotonic timestamp for measuring durations
+ * \return time in nanoseconds from an arbitrary starting point
+ */
+int64_t ass_time_ns(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (int64_t) (count.QuadPart / freq.QuadPart) * 1000000000 +
+        (int64_t) (count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
 unsigned ass_utf8_get_char(char **str)
 {
     uint8_t *strp = (uint8_t *) * str;
@@ -64,7 +64,7 @@ void SUFFIX(ass_stripe_pack)(uint8_t *restrict dst, ptrdiff_t dst_stride,
     for (size_t x = 0; x < width; x += STRIPE_WIDTH) {
         uint8_t *ptr = dst;
         for (size_t y = 0; y < height; y++) {
-            const int16_t *dither = dither_line + 16 * (y & 1);
+            const int16_t *dither = dither_line + 32 * (y & 1);
             for (int k = 0; k < STRIPE_WIDTH; k++)
                 ptr[k] = (uint16_t) (src[k] - (src[k] >> 8) + dither[k]) >> 6;
                 //ptr[k] = (255 * src[k] + 0x1FFF) / 0x4000;
@@ -88,3 +88,75 @@ void ass_mul_bitmaps_c(uint8_t *restrict dst, ptrdiff_t dst_stride,
         src2 += src2_stride;
     }
 }
+
+static inline unsigned div255(unsigned x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+/**
+ * \brief Blend a bitmap onto premultiplied 4-byte pixels
+ * The SIMD versions use the same rounding and produce identical results.
+ */
+void ass_blend_rgba_c(uint8_t *restrict dst, ptrdiff_t dst_stride,
+                      const uint8_t *restrict src, ptrdiff_t src_stride,
+                      size_t width, size_t height, uint32_t color)
+{
+    ASSUME(width > 0 && height > 0);
+
+    const unsigned c[4] = {
+        color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, 255
+    };
+    unsigned alpha = color >> 24;
+
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            unsigned k = div255(src[x] * alpha);
+            uint8_t *pix = dst + 4 * x;
+            for (int i = 0; i < 4; i++)
+                pix[i] = div255(k * c[i] + (255 - k) * pix[i]);
+        }
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
+
+void ass_blend_plane8_c(uint8_t *restrict dst, ptrdiff_t dst_stride,
+                        const uint8_t *restrict src, ptrdiff_t src_stride,
+                        size_t width, size_t height, uint32_t color)
+{
+    ASSUME(width > 0 && height > 0);
+
+    const unsigned c[2] = { color & 0xFF, (color >> 8) & 0xFF };
+    unsigned alpha = color >> 24;
+
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            unsigned k = div255(src[x] * alpha);
+            dst[x] = div255(k * c[x & 1] + (255 - k) * dst[x]);
+        }
+        dst += dst_stride;
+        src += src_stride;
+    }
+}
+
+void ass_blend_plane16_c(uint16_t *restrict dst, ptrdiff_t dst_stride,
+                         const uint8_t *restrict src, ptrdiff_t src_stride,
+                         size_t width, size_t height,
+                         uint32_t color, unsigned alpha)
+{
+    ASSUME(width > 0 && height > 0);
+
+    const unsigned c[2] = { (color & 0xFFFF) >> 6, color >> 22 };
+
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            unsigned k = div255(src[x] * alpha);
+            unsigned d = dst[x] >> 6;
+            dst[x] = div255(k * c[x & 1] + (255 - k) * d) << 6;
+        }
+        dst = (uint16_t *) ((uint8_t *) dst + dst_stride);
+        src += src_stride;
+    }
+}
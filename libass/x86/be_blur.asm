@@ -20,6 +20,13 @@
 
 %include "x86/utils.asm"
 
+%if ARCH_X86_64 && CONFIG_AVX512
+SECTION_RODATA 64
+
+qwords_unpack: dq 0, 4, 1, 5, 2, 6, 3, 7
+qwords_pack: dq 0, 2, 4, 6, 1, 3, 5, 7
+%endif
+
 SECTION .text
 
 ;------------------------------------------------------------------------------
@@ -29,7 +36,8 @@ SECTION .text
 ;------------------------------------------------------------------------------
 
 %macro BE_BLUR 0
-cglobal be_blur, 5,7,8
+    %assign %%nxmm 8 + 2 * (mmsize == 64)
+cglobal be_blur, 5,7,%%nxmm
     lea r0, [r0 + r2]
     lea r4, [r4 + 4 * r2]
     mov r6, r0
@@ -38,15 +46,24 @@ cglobal be_blur, 5,7,8
     imul r3, r1
     add r3, r0
     pxor m6, m6
+%if mmsize == 64
+    mova m8, [qwords_unpack]
+    mova m9, [qwords_pack]
+%endif
 
     mova m3, [r0 + r5]
 %if mmsize == 32
     vpermq m3, m3, q3120
+%elif mmsize == 64
+    vpermq m3, m8, m3
 %endif
     punpcklbw m4, m3, m6
 %if mmsize == 32
     vperm2i128 m0, m6, m4, 0x21
     vpalignr m5,m4,m0, 14
+%elif mmsize == 64
+    valignq m0, m4, m6, 6
+    vpalignr m5,m4,m0, 14
 %else
     pslldq m5, m4, 2
 %endif
@@ -58,10 +75,14 @@ cglobal be_blur, 5,7,8
     mova m3, [r0 + r5]
 %if mmsize == 32
     vpermq m3, m3, q3120
+%elif mmsize == 64
+    vpermq m3, m8, m3
 %endif
     punpcklbw m4, m3, m6
 %if mmsize == 32
     vperm2i128 m0, m0, m4, 0x21
+%elif mmsize == 64
+    valignq m0, m4, m0, 6
 %endif
     PALIGNR m5,m4,m0, m0, 14
     paddw m5, m4
@@ -69,6 +90,9 @@ cglobal be_blur, 5,7,8
 %if mmsize == 32
     vperm2i128 m7, m5, m1, 0x03
     vpalignr m3, m7, m1, 2
+%elif mmsize == 64
+    valignq m7, m5, m1, 2
+    vpalignr m3, m7, m1, 2
 %else
     PALIGNR m3,m5,m1, m7, 2
 %endif
@@ -80,12 +104,17 @@ cglobal be_blur, 5,7,8
 .first_loop_entry:
 %if mmsize == 32
     vperm2i128 m4, m4, m0, 0x21
+%elif mmsize == 64
+    valignq m4, m0, m4, 6
 %endif
     PALIGNR m1,m0,m4, m4, 14
     paddw m1, m0
 %if mmsize == 32
     vperm2i128 m7, m1, m5, 0x03
     vpalignr m3, m7, m5, 2
+%elif mmsize == 64
+    valignq m7, m1, m5, 2
+    vpalignr m3, m7, m5, 2
 %else
     PALIGNR m3,m1,m5, m7, 2
 %endif
@@ -101,6 +130,10 @@ cglobal be_blur, 5,7,8
 %if mmsize == 32
     vperm2i128 m7, m0, m1, 0x13
     vpalignr m3, m7, m1, 2
+%elif mmsize == 64
+    valignq m0, m6, m0, 6
+    valignq m7, m0, m1, 2
+    vpalignr m3, m7, m1, 2
 %else
     PALIGNR m3,m0,m1, m7, 2
 %endif
@@ -118,11 +151,16 @@ cglobal be_blur, 5,7,8
     mova m3, [r0 + r5]
 %if mmsize == 32
     vpermq m3, m3, q3120
+%elif mmsize == 64
+    vpermq m3, m8, m3
 %endif
     punpcklbw m4, m3, m6
 %if mmsize == 32
     vperm2i128 m0, m6, m4, 0x21
     vpalignr m5,m4,m0, 14
+%elif mmsize == 64
+    valignq m0, m4, m6, 6
+    vpalignr m5,m4,m0, 14
 %else
     pslldq m5, m4, 2
 %endif
@@ -134,10 +172,14 @@ cglobal be_blur, 5,7,8
     mova m3, [r0 + r5]
 %if mmsize == 32
     vpermq m3, m3, q3120
+%elif mmsize == 64
+    vpermq m3, m8, m3
 %endif
     punpcklbw m4, m3, m6
 %if mmsize == 32
     vperm2i128 m0, m0, m4, 0x21
+%elif mmsize == 64
+    valignq m0, m4, m0, 6
 %endif
     PALIGNR m5,m4,m0, m0, 14
     paddw m5, m4
@@ -145,6 +187,9 @@ cglobal be_blur, 5,7,8
 %if mmsize == 32
     vperm2i128 m7, m5, m1, 0x03
     vpalignr m3, m7, m1, 2
+%elif mmsize == 64
+    valignq m7, m5, m1, 2
+    vpalignr m3, m7, m1, 2
 %else
     PALIGNR m3,m5,m1, m7, 2
 %endif
@@ -158,18 +203,25 @@ cglobal be_blur, 5,7,8
     packuswb m2, m3
 %if mmsize == 32
     vpermq m2, m2, q3120
+%elif mmsize == 64
+    vpermq m2, m9, m2
 %endif
     mova [r6 + r5 - mmsize], m2
 
 .loop_entry:
 %if mmsize == 32
     vperm2i128 m4, m4, m0, 0x21
+%elif mmsize == 64
+    valignq m4, m0, m4, 6
 %endif
     PALIGNR m1,m0,m4, m4, 14
     paddw m1, m0
 %if mmsize == 32
     vperm2i128 m7, m1, m5, 0x03
     vpalignr m3, m7, m5, 2
+%elif mmsize == 64
+    valignq m7, m1, m5, 2
+    vpalignr m3, m7, m5, 2
 %else
     PALIGNR m3,m1,m5, m7, 2
 %endif
@@ -188,6 +240,10 @@ cglobal be_blur, 5,7,8
 %if mmsize == 32
     vperm2i128 m7, m0, m1, 0x13
     vpalignr m3, m7, m1, 2
+%elif mmsize == 64
+    valignq m0, m6, m0, 6
+    valignq m7, m0, m1, 2
+    vpalignr m3, m7, m1, 2
 %else
     PALIGNR m3,m0,m1, m7, 2
 %endif
@@ -201,6 +257,8 @@ cglobal be_blur, 5,7,8
     packuswb m2, m3
 %if mmsize == 32
     vpermq m2, m2, q3120
+%elif mmsize == 64
+    vpermq m2, m9, m2
 %endif
     mova [r6 + r5 - mmsize], m2
 
@@ -221,6 +279,8 @@ cglobal be_blur, 5,7,8
     packuswb m2, m3
 %if mmsize == 32
     vpermq m2, m2, q3120
+%elif mmsize == 64
+    vpermq m2, m9, m2
 %endif
     mova [r6 + r5], m2
     add r5, mmsize
@@ -234,3 +294,7 @@ INIT_XMM ssse3
 BE_BLUR
 INIT_YMM avx2
 BE_BLUR
+%if ARCH_X86_64 && CONFIG_AVX512
+INIT_ZMM avx512
+BE_BLUR
+%endif
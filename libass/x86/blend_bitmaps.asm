@@ -20,19 +20,19 @@
 
 %include "x86/utils.asm"
 
-SECTION_RODATA 32
+SECTION_RODATA 64
 
 %if ARCH_X86_64 || !PIC
-times 32 db 0xFF
-edge_mask: times 32 db 0x00
-words_255: times 16 dw 0xFF
+times 64 db 0xFF
+edge_mask: times 64 db 0x00
+words_255: times 32 dw 0xFF
 %endif
 
 SECTION .text
 
 ;------------------------------------------------------------------------------
 ; LOAD_EDGE_MASK 1:m_dst, 2:n, 3:tmp
-; Set n last bytes of xmm/ymm register to zero and other bytes to 255
+; Set n last bytes of xmm/ymm/zmm register to zero and other bytes to 255
 ;------------------------------------------------------------------------------
 
 %macro LOAD_EDGE_MASK 3
@@ -111,6 +111,10 @@ INIT_XMM sse2
 ADD_BITMAPS
 INIT_YMM avx2
 ADD_BITMAPS
+%if ARCH_X86_64 && CONFIG_AVX512
+INIT_ZMM avx512
+ADD_BITMAPS
+%endif
 
 ;------------------------------------------------------------------------------
 ; IMUL_BITMAPS
@@ -140,7 +144,11 @@ cglobal imul_bitmaps, 5,7,8
     BCASTD 5, t0d
 %endif
     pxor m6, m6
+%if mmsize == 64
+    vpternlogd m7, m7, m7, 0xFF
+%else
     pcmpeqb m7, m7
+%endif
 %if !ARCH_X86_64
     mov r5, r5m
 %endif
@@ -194,6 +202,10 @@ INIT_XMM sse2
 IMUL_BITMAPS
 INIT_YMM avx2
 IMUL_BITMAPS
+%if ARCH_X86_64 && CONFIG_AVX512
+INIT_ZMM avx512
+IMUL_BITMAPS
+%endif
 
 ;------------------------------------------------------------------------------
 ; MUL_BITMAPS
@@ -273,3 +285,406 @@ INIT_XMM sse2
 MUL_BITMAPS
 INIT_YMM avx2
 MUL_BITMAPS
+%if ARCH_X86_64 && CONFIG_AVX512
+INIT_ZMM avx512
+MUL_BITMAPS
+%endif
+
+;------------------------------------------------------------------------------
+; DIV255 1:m_reg, 2:m_tmp
+; Divide words by 255 with rounding, requires m7 = 128 in all words
+;------------------------------------------------------------------------------
+
+%macro DIV255 2
+    paddw m%1, m7
+    psrlw m%2, m%1, 8
+    paddw m%1, m%2
+    psrlw m%1, 8
+%endmacro
+
+;------------------------------------------------------------------------------
+; BLEND_WORDS 1:m_src, 2:m_dst, 3:m_tmp
+; Blend one channel word of m_dst per mask word of m_src,
+; requires m5 = alpha, m6 = color and m7 = 128 in words.
+; Result is placed in m_src, m_dst is preserved.
+;------------------------------------------------------------------------------
+
+%macro BLEND_WORDS 3
+    pmullw m%1, m5
+    DIV255 %1, %3
+    pmullw m%3, m%1, m6
+    pmullw m%1, m%2
+    psubw m%3, m%1
+    psllw m%1, m%2, 8
+    psubw m%1, m%2
+    paddw m%1, m%3
+    DIV255 %1, %3
+%endmacro
+
+;------------------------------------------------------------------------------
+; BLEND_RGBA
+; void blend_rgba(uint8_t *dst, ptrdiff_t dst_stride,
+;                 const uint8_t *src, ptrdiff_t src_stride,
+;                 size_t width, size_t height, uint32_t color);
+;------------------------------------------------------------------------------
+
+%macro BLEND_RGBA 0
+%if ARCH_X86_64
+cglobal blend_rgba, 7,9,8
+    DECLARE_REG_TMP 7,8
+    %define colord r6d
+%else
+cglobal blend_rgba, 5,7,8
+    DECLARE_REG_TMP 6,5
+    %define colord r6m
+%endif
+    mov t0d, colord
+    shr t0d, 24
+    imul t0d, 0x10001
+    BCASTD 5, t0d
+    mov t0d, colord
+    or t0d, 0xFF000000
+    movd xm6, t0d
+    punpcklbw xm6, xm6
+    psrlw xm6, 8
+%if mmsize == 32
+    vpbroadcastq m6, xm6
+%else
+    punpcklqdq m6, m6
+%endif
+    mov t0d, 128 * 0x10001
+    BCASTD 7, t0d
+
+    lea r0, [r0 + 4 * r4]
+    add r2, r4
+    neg r4
+
+.row_loop:
+    mov t0, r4
+    add t0, mmsize / 4
+    jg .tail_entry
+
+.width_loop:
+    movu m0, [r0 + 4 * t0 - mmsize]
+%if mmsize == 32
+    pmovzxbd m1, [r2 + t0 - mmsize / 4]
+    pslld m2, m1, 8
+    por m1, m2
+    pslld m2, m1, 16
+    por m1, m2
+%else
+    movd m1, [r2 + t0 - mmsize / 4]
+    punpcklbw m1, m1
+    punpcklwd m1, m1
+%endif
+    punpcklbw m2, m1, m1
+    punpckhbw m1, m1
+    psrlw m2, 8
+    psrlw m1, 8
+    punpcklbw m3, m0, m0
+    punpckhbw m0, m0
+    psrlw m3, 8
+    psrlw m0, 8
+    BLEND_WORDS 2, 3, 4
+    BLEND_WORDS 1, 0, 4
+    packuswb m2, m1
+    movu [r0 + 4 * t0 - mmsize], m2
+    add t0, mmsize / 4
+    jle .width_loop
+
+.tail_entry:
+    sub t0, mmsize / 4
+    jz .next_row
+
+.tail_loop:
+    movd xm0, [r0 + 4 * t0]
+    movzx t1d, byte [r2 + t0]
+    imul t1d, 0x01010101
+    movd xm1, t1d
+    punpcklbw m1, m1
+    punpcklbw m0, m0
+    psrlw m1, 8
+    psrlw m0, 8
+    BLEND_WORDS 1, 0, 3
+    packuswb m1, m1
+    movd [r0 + 4 * t0], xm1
+    inc t0
+    jnz .tail_loop
+
+.next_row:
+    add r0, r1
+    add r2, r3
+%if ARCH_X86_64
+    dec r5
+%else
+    dec dword r5m
+%endif
+    jnz .row_loop
+    RET
+%endmacro
+
+INIT_XMM sse2
+BLEND_RGBA
+INIT_YMM avx2
+BLEND_RGBA
+
+;------------------------------------------------------------------------------
+; BLEND_LOW_BYTES
+; Blend the low bytes of m0 with mask bytes in the low bytes of m1,
+; result is placed in the low bytes of m1
+;------------------------------------------------------------------------------
+
+%macro BLEND_LOW_BYTES 0
+    punpcklbw m1, m1
+    punpcklbw m0, m0
+    psrlw m1, 8
+    psrlw m0, 8
+    BLEND_WORDS 1, 0, 3
+    packuswb m1, m1
+%endmacro
+
+;------------------------------------------------------------------------------
+; BLEND_PLANE8
+; void blend_plane8(uint8_t *dst, ptrdiff_t dst_stride,
+;                   const uint8_t *src, ptrdiff_t src_stride,
+;                   size_t width, size_t height, uint32_t color);
+;------------------------------------------------------------------------------
+
+%macro BLEND_PLANE8 0
+%if ARCH_X86_64
+cglobal blend_plane8, 7,9,8
+    DECLARE_REG_TMP 7,8
+    %define colord r6d
+%else
+cglobal blend_plane8, 5,7,8
+    DECLARE_REG_TMP 6,3
+    %define colord r6m
+%endif
+    mov t0d, colord
+    shr t0d, 24
+    imul t0d, 0x10001
+    BCASTD 5, t0d
+    mov t0d, colord
+    and t0d, 0xFFFF
+    movd xm6, t0d
+    punpcklbw xm6, xm6
+    psrlw xm6, 8
+%if mmsize == 32
+    vpbroadcastd m6, xm6
+%else
+    pshufd m6, m6, q0000
+%endif
+    mov t0d, 128 * 0x10001
+    BCASTD 7, t0d
+
+    add r0, r4
+    add r2, r4
+    neg r4
+
+.row_loop:
+    mov t0, r4
+    add t0, mmsize
+    jg .tail_entry
+
+.width_loop:
+    movu m0, [r0 + t0 - mmsize]
+    movu m1, [r2 + t0 - mmsize]
+    punpcklbw m2, m1, m1
+    punpckhbw m1, m1
+    psrlw m2, 8
+    psrlw m1, 8
+    punpcklbw m3, m0, m0
+    punpckhbw m0, m0
+    psrlw m3, 8
+    psrlw m0, 8
+    BLEND_WORDS 2, 3, 4
+    BLEND_WORDS 1, 0, 4
+    packuswb m2, m1
+    movu [r0 + t0 - mmsize], m2
+    add t0, mmsize
+    jle .width_loop
+
+.tail_entry:
+    sub t0, mmsize
+    jz .next_row
+    jmp .pair_entry
+
+; keep even and odd samples in place for the color pattern
+.pair_loop:
+    movzx t1d, word [r0 + t0 - 2]
+    movd xm0, t1d
+    movzx t1d, word [r2 + t0 - 2]
+    movd xm1, t1d
+    BLEND_LOW_BYTES
+    movd t1d, xm1
+    mov [r0 + t0 - 2], t1w
+.pair_entry:
+    add t0, 2
+    jle .pair_loop
+    sub t0, 2
+    jz .next_row
+    movzx t1d, byte [r0 + t0]
+    movd xm0, t1d
+    movzx t1d, byte [r2 + t0]
+    movd xm1, t1d
+    BLEND_LOW_BYTES
+    movd t1d, xm1
+    mov [r0 + t0], t1b
+
+.next_row:
+    add r0, r1
+%if ARCH_X86_64
+    add r2, r3
+    dec r5
+%else
+    add r2, r3m
+    dec dword r5m
+%endif
+    jnz .row_loop
+    RET
+%endmacro
+
+INIT_XMM sse2
+BLEND_PLANE8
+INIT_YMM avx2
+BLEND_PLANE8
+
+;------------------------------------------------------------------------------
+; DIV255D 1:m_reg, 2:m_tmp
+; Same as DIV255 for dwords, requires m4 = 128 in all dwords
+;------------------------------------------------------------------------------
+
+%macro DIV255D 2
+    paddd m%1, m4
+    psrld m%2, m%1, 8
+    paddd m%1, m%2
+    psrld m%1, 8
+%endmacro
+
+;------------------------------------------------------------------------------
+; BLEND_SAMPLES16
+; Blend 16-bit samples of m0 with mask words of m1,
+; requires m4 = 128 in dwords and m5 = alpha, m6 = color, m7 = 128 in words.
+; Result is placed in m0.
+;------------------------------------------------------------------------------
+
+%macro BLEND_SAMPLES16 0
+    psrlw m0, 6
+    pmullw m1, m5
+    DIV255 1, 2
+    pcmpeqw m2, m2
+    psrlw m2, 8
+    pxor m2, m1
+    punpckhwd m3, m2, m1
+    punpcklwd m2, m1
+    punpckhwd m1, m0, m6
+    punpcklwd m0, m6
+    pmaddwd m0, m2
+    pmaddwd m1, m3
+    DIV255D 0, 2
+    DIV255D 1, 2
+    packssdw m0, m1
+    psllw m0, 6
+%endmacro
+
+;------------------------------------------------------------------------------
+; BLEND_PLANE16
+; void blend_plane16(uint16_t *dst, ptrdiff_t dst_stride,
+;                    const uint8_t *src, ptrdiff_t src_stride,
+;                    size_t width, size_t height,
+;                    uint32_t color, unsigned alpha);
+;------------------------------------------------------------------------------
+
+%macro BLEND_PLANE16 0
+%if ARCH_X86_64
+cglobal blend_plane16, 8,10,8
+    DECLARE_REG_TMP 8,9
+    %define colord r6d
+    %define alphad r7d
+%else
+cglobal blend_plane16, 5,7,8
+    DECLARE_REG_TMP 6,3
+    %define colord r6m
+    %define alphad r7m
+%endif
+    mov t0d, alphad
+    imul t0d, 0x10001
+    BCASTD 5, t0d
+    mov t0d, colord
+    BCASTD 6, t0d
+    psrlw m6, 6
+    mov t0d, 128 * 0x10001
+    BCASTD 7, t0d
+    pcmpeqd m4, m4
+    psrld m4, 31
+    pslld m4, 7
+
+    lea r0, [r0 + 2 * r4]
+    add r2, r4
+    neg r4
+
+.row_loop:
+    mov t0, r4
+    add t0, mmsize / 2
+    jg .tail_entry
+
+.width_loop:
+    movu m0, [r0 + 2 * t0 - mmsize]
+%if mmsize == 32
+    pmovzxbw m1, [r2 + t0 - mmsize / 2]
+%else
+    movq m1, [r2 + t0 - mmsize / 2]
+    punpcklbw m1, m1
+    psrlw m1, 8
+%endif
+    BLEND_SAMPLES16
+    movu [r0 + 2 * t0 - mmsize], m0
+    add t0, mmsize / 2
+    jle .width_loop
+
+.tail_entry:
+    sub t0, mmsize / 2
+    jz .next_row
+    jmp .pair_entry
+
+; keep even and odd samples in place for the color pattern
+.pair_loop:
+    movd xm0, [r0 + 2 * t0 - 4]
+    movzx t1d, word [r2 + t0 - 2]
+    movd xm1, t1d
+    punpcklbw m1, m1
+    psrlw m1, 8
+    BLEND_SAMPLES16
+    movd [r0 + 2 * t0 - 4], xm0
+.pair_entry:
+    add t0, 2
+    jle .pair_loop
+    sub t0, 2
+    jz .next_row
+    movzx t1d, word [r0 + 2 * t0]
+    movd xm0, t1d
+    movzx t1d, byte [r2 + t0]
+    movd xm1, t1d
+    punpcklbw m1, m1
+    psrlw m1, 8
+    BLEND_SAMPLES16
+    movd t1d, xm0
+    mov [r0 + 2 * t0], t1w
+
+.next_row:
+    add r0, r1
+%if ARCH_X86_64
+    add r2, r3
+    dec r5
+%else
+    add r2, r3m
+    dec dword r5m
+%endif
+    jnz .row_loop
+    RET
+%endmacro
+
+INIT_XMM sse2
+BLEND_PLANE16
+INIT_YMM avx2
+BLEND_PLANE16
@@ -20,19 +20,23 @@
 
 %include "x86/utils.asm"
 
-SECTION_RODATA 32
+SECTION_RODATA 64
 
 %if ARCH_X86_64 || !PIC
-words_zero: times 16 dw 0
-words_one: times 16 dw 1
-words_dither_init: times 8 dw  8, 40
-words_dither_flip: times 16 dw 48
+words_zero: times 32 dw 0
+words_one: times 32 dw 1
+words_dither_init: times 16 dw  8, 40
+words_dither_flip: times 32 dw 48
 %if ARCH_X86_64
-words_sign: times 16 dw 0x8000
+words_sign: times 32 dw 0x8000
 %endif
-dwords_two: times 8 dd 2
-dwords_round: times 8 dd 0x8000
-dwords_lomask: times 8 dd 0xFFFF
+dwords_two: times 16 dd 2
+dwords_round: times 16 dd 0x8000
+dwords_lomask: times 16 dd 0xFFFF
+%endif
+%if ARCH_X86_64 && CONFIG_AVX512
+qwords_unpack: dq 0, 4, 1, 5, 2, 6, 3, 7
+qwords_pack: dq 0, 2, 4, 6, 1, 3, 5, 7
 %endif
 
 SECTION .text
@@ -44,7 +48,8 @@ SECTION .text
 ;------------------------------------------------------------------------------
 
 %macro STRIPE_UNPACK 1
-cglobal stripe_unpack%1, 5,6,3
+    %assign %%nxmm 3 + (mmsize == 64)
+cglobal stripe_unpack%1, 5,6,%%nxmm
     lea r3, [2 * r3 + mmsize - 1]
     and r3, -mmsize
     mov r5, r3
@@ -59,6 +64,9 @@ cglobal stripe_unpack%1, 5,6,3
 %else
     mov r5d, 0x10001
     BCASTD 2, r5d
+%endif
+%if mmsize == 64
+    mova m3, [qwords_unpack]
 %endif
     xor r5, r5
     jmp .row_loop
@@ -67,6 +75,8 @@ cglobal stripe_unpack%1, 5,6,3
     mova m1, [r1]
 %if mmsize == 32
     vpermq m1, m1, q3120
+%elif mmsize == 64
+    vpermq m1, m3, m1
 %endif
     punpcklbw m0, m1, m1
     punpckhbw m1, m1
@@ -92,6 +102,8 @@ cglobal stripe_unpack%1, 5,6,3
     mova m0, [r1]
 %if mmsize == 32
     vpermq m0, m0, q3120
+%elif mmsize == 64
+    vpermq m0, m3, m0
 %endif
     punpcklbw m0, m0
     psrlw m0, 1
@@ -112,6 +124,10 @@ INIT_XMM sse2
 STRIPE_UNPACK 16
 INIT_YMM avx2
 STRIPE_UNPACK 32
+%if ARCH_X86_64 && CONFIG_AVX512
+INIT_ZMM avx512
+STRIPE_UNPACK 64
+%endif
 
 ;------------------------------------------------------------------------------
 ; STRIPE_PACK 1:suffix
@@ -120,7 +136,8 @@ STRIPE_UNPACK 32
 ;------------------------------------------------------------------------------
 
 %macro STRIPE_PACK 1
-cglobal stripe_pack%1, 5,7,5
+    %assign %%nxmm 5 + (mmsize == 64)
+cglobal stripe_pack%1, 5,7,%%nxmm
     lea r3, [2 * r3 + mmsize - 1]
     mov r6, r1
     and r3, -mmsize
@@ -135,6 +152,9 @@ cglobal stripe_pack%1, 5,7,5
 %else
     mov r6d, 48 * 0x10001
     BCASTD 4, r6d
+%endif
+%if mmsize == 64
+    mova m5, [qwords_pack]
 %endif
     jmp .row_loop
 
@@ -154,6 +174,8 @@ cglobal stripe_pack%1, 5,7,5
     packuswb m0, m1
 %if mmsize == 32
     vpermq m0, m0, q3120
+%elif mmsize == 64
+    vpermq m0, m5, m0
 %endif
     mova [r0], m0
     pxor m3, m4
@@ -188,6 +210,8 @@ cglobal stripe_pack%1, 5,7,5
     packuswb m0, m1
 %if mmsize == 32
     vpermq m0, m0, q3120
+%elif mmsize == 64
+    vpermq m0, m5, m0
 %endif
     mova [r0], m0
     pxor m3, m4
@@ -202,13 +226,18 @@ INIT_XMM sse2
 STRIPE_PACK 16
 INIT_YMM avx2
 STRIPE_PACK 32
+%if ARCH_X86_64 && CONFIG_AVX512
+INIT_ZMM avx512
+STRIPE_PACK 64
+%endif
 
 ;------------------------------------------------------------------------------
 ; LOAD_LINE 1:m_dst, 2:base, 3:max, 4:zero_offs,
 ;           5:offs(lea arg), 6:tmp, [7:left/right]
 ; LOAD_LINE_COMPACT 1:m_dst, 2:base, 3:max,
 ;                   4:offs(register), 5:tmp, [6:left/right]
-; Load xmm/ymm register with correct source bitmap data
+; Load xmm/ymm/zmm register with correct source bitmap data,
+; left/right halves are only loaded separately for ymm
 ;------------------------------------------------------------------------------
 
 %macro LOAD_LINE 6-7
@@ -254,7 +283,8 @@ STRIPE_PACK 32
 
 %macro SHRINK_HORZ 1
 %if ARCH_X86_64
-cglobal shrink_horz%1, 4,9,9
+    %assign %%nxmm 9 + (mmsize == 64)
+cglobal shrink_horz%1, 4,9,%%nxmm
     DECLARE_REG_TMP 8
 %else
 %if !PIC
@@ -284,6 +314,9 @@ cglobal shrink_horz%1, 4,7,8, -mmsize
 %endif
 %if ARCH_X86_64
     mova m8, [dwords_two]
+%if mmsize == 64
+    mova m9, [qwords_pack]
+%endif
     lea r7, [words_zero]
     sub r7, r1
 %else
@@ -309,6 +342,9 @@ cglobal shrink_horz%1, 4,7,8, -mmsize
 %if mmsize == 32
     vperm2i128 m3, m0, m1, 0x20
     vperm2i128 m4, m1, m2, 0x21
+%elif mmsize == 64
+    valignq m3, m1, m0, 6
+    valignq m4, m2, m1, 6
 %else
     mova m3, m0
     mova m4, m1
@@ -320,18 +356,29 @@ cglobal shrink_horz%1, 4,7,8, -mmsize
     pand m3, m7
     pand m4, m7
 
+%if mmsize == 64
+    psrld m6, m0, 16
+    paddw m0, m6
+%else
     psrld xm6, xm0, 16
     paddw xm0, xm6
+%endif
     psrld m6, m1, 16
     paddw m1, m6
     psrld m6, m2, 16
     paddw m2, m6
+%if mmsize == 64
+    pand m0, m7
+%else
     pand xm0, xm7
+%endif
     pand m1, m7
     pand m2, m7
 
 %if mmsize == 32
     vperm2i128 m0, m0, m1, 0x20
+%elif mmsize == 64
+    valignq m0, m1, m0, 6
 %endif
     PALIGNR m5,m1,m0, m6, 8
     paddd m5, m1
@@ -345,6 +392,8 @@ cglobal shrink_horz%1, 4,7,8, -mmsize
 
 %if mmsize == 32
     vperm2i128 m1, m1, m2, 0x21
+%elif mmsize == 64
+    valignq m1, m2, m1, 6
 %endif
     PALIGNR m5,m2,m1, m6, 8
     paddd m5, m2
@@ -374,6 +423,8 @@ cglobal shrink_horz%1, 4,7,8, -mmsize
     packssdw m0, m1
 %if mmsize == 32
     vpermq m0, m0, q3120
+%elif mmsize == 64
+    vpermq m0, m9, m0
 %endif
 
     mova [r0], m0
@@ -398,6 +449,10 @@ INIT_XMM ssse3
 SHRINK_HORZ 16
 INIT_YMM avx2
 SHRINK_HORZ 32
+%if ARCH_X86_64 && CONFIG_AVX512
+INIT_ZMM avx512
+SHRINK_HORZ 64
+%endif
 
 ;------------------------------------------------------------------------------
 ; SHRINK_VERT 1:suffix
@@ -491,6 +546,10 @@ INIT_XMM sse2
 SHRINK_VERT 16
 INIT_YMM avx2
 SHRINK_VERT 32
+%if ARCH_X86_64 && CONFIG_AVX512
+INIT_ZMM avx512
+SHRINK_VERT 64
+%endif
 
 ;------------------------------------------------------------------------------
 ; EXPAND_HORZ 1:suffix
@@ -500,7 +559,8 @@ SHRINK_VERT 32
 
 %macro EXPAND_HORZ 1
 %if ARCH_X86_64
-cglobal expand_horz%1, 4,9,5
+    %assign %%nxmm 5 + (mmsize == 64)
+cglobal expand_horz%1, 4,9,%%nxmm
     DECLARE_REG_TMP 8
 %else
 %if !PIC
@@ -529,6 +589,9 @@ cglobal expand_horz%1, 4,7,5, -mmsize
     BCASTD 4, r5d
 %endif
 %if ARCH_X86_64
+%if mmsize == 64
+    mova m5, [qwords_unpack]
+%endif
     lea r7, [words_zero]
     sub r7, r1
 %endif
@@ -552,6 +615,8 @@ cglobal expand_horz%1, 4,7,5, -mmsize
 
 %if mmsize == 32
     vperm2i128 m2, m2, m1, 0x20
+%elif mmsize == 64
+    valignq m2, m1, m2, 6
 %endif
     PALIGNR m0,m1,m2, m3, 12
     PALIGNR m2,m1,m2, m3, 14
@@ -573,6 +638,9 @@ cglobal expand_horz%1, 4,7,5, -mmsize
 %if mmsize == 32
     vpermq m0, m0, q3120
     vpermq m1, m1, q3120
+%elif mmsize == 64
+    vpermq m0, m5, m0
+    vpermq m1, m5, m1
 %endif
     punpcklwd m2, m0, m1
     punpckhwd m0, m1
@@ -605,6 +673,28 @@ cglobal expand_horz%1, 4,7,5, -mmsize
     sub r4, r3
 %endif
 
+%if mmsize == 64
+    valignq m2, m1, m2, 6
+    PALIGNR m0,m1,m2, m3, 12
+    PALIGNR m2,m1,m2, m3, 14
+    paddw m3, m0, m1
+    psrlw m3, 1
+    paddw m3, m2
+    psrlw m3, 1
+    paddw m0, m3
+    paddw m1, m3
+    psrlw m0, 1
+    psrlw m1, 1
+    paddw m0, m2
+    paddw m1, m2
+    paddw m0, m4
+    paddw m1, m4
+    psrlw m0, 1
+    psrlw m1, 1
+
+    vpermq m0, m5, m0
+    vpermq m1, m5, m1
+%else
     PALIGNR xm0,xm1,xm2, xm3, 12
     PALIGNR xm2,xm1,xm2, xm3, 14
     paddw xm3, xm0, xm1
@@ -625,6 +715,7 @@ cglobal expand_horz%1, 4,7,5, -mmsize
 %if mmsize == 32
     vpermq m0, m0, q3120
     vpermq m1, m1, q3120
+%endif
 %endif
     punpcklwd m0, m1
     mova [r0], m0
@@ -641,6 +732,10 @@ INIT_XMM ssse3
 EXPAND_HORZ 16
 INIT_YMM avx2
 EXPAND_HORZ 32
+%if ARCH_X86_64 && CONFIG_AVX512
+INIT_ZMM avx512
+EXPAND_HORZ 64
+%endif
 
 ;------------------------------------------------------------------------------
 ; EXPAND_VERT 1:suffix
@@ -713,10 +808,14 @@ INIT_XMM sse2
 EXPAND_VERT 16
 INIT_YMM avx2
 EXPAND_VERT 32
+%if ARCH_X86_64 && CONFIG_AVX512
+INIT_ZMM avx512
+EXPAND_VERT 64
+%endif
 
 ;------------------------------------------------------------------------------
 ; LOAD_MULTIPLIER 1:n, 2:m_mul, 3:src, 4:tmp
-; Load blur parameters into xmm/ymm registers
+; Load blur parameters into xmm/ymm/zmm registers
 ;------------------------------------------------------------------------------
 
 %macro LOAD_MULTIPLIER 4
@@ -733,6 +832,8 @@ EXPAND_VERT 32
 %endif
 %if mmsize == 32
     vpermq m %+ %%t, m %+ %%t, q1010
+%elif mmsize == 64
+    vshufi32x4 m %+ %%t, m %+ %%t, m %+ %%t, q0000
 %endif
 %if ARCH_X86_64
     %assign %%i 0
@@ -832,7 +933,7 @@ cglobal blur%1_horz%2, 5,7,8, -mmsize
     add r5, r0
     xor r4, r4
     MUL r3, mmsize
-%if mmsize != 32 && %1 > 4
+%if mmsize == 16 && %1 > 4
     sub r4, r3
 %endif
     sub r4, r3
@@ -850,7 +951,7 @@ cglobal blur%1_horz%2, 5,7,8, -mmsize
     LOAD_LINE 1, r1,r2,r7, r4 + 0 * r3, r6, right
 %endif
     LOAD_LINE 2, r1,r2,r7, r4 + 1 * r3, r6
-%if mmsize != 32 && %1 > 4
+%if mmsize == 16 && %1 > 4
     LOAD_LINE 0, r1,r2,r7, r4 + 2 * r3, r6
     SWAP 0, 2
 %endif
@@ -862,7 +963,7 @@ cglobal blur%1_horz%2, 5,7,8, -mmsize
 %endif
     add r4, r3
     LOAD_LINE_COMPACT 2, r1,r2,r4, r6
-%if mmsize != 32 && %1 > 4
+%if mmsize == 16 && %1 > 4
     add r4, r3
     LOAD_LINE_COMPACT 0, r1,r2,r4, r6
     SWAP 0, 2
@@ -874,6 +975,9 @@ cglobal blur%1_horz%2, 5,7,8, -mmsize
 %if %1 > 4
 %if mmsize == 32
     vperm2i128 m0, m1, m2, 0x21
+%elif mmsize == 64
+    valignq m0, m2, m1, 6
+    valignq m1, m2, m1, 4
 %endif
 %if cpuflag(ssse3)
     PALIGNR m1,m0,m1, m3, 16 - 2 * %1
@@ -884,6 +988,8 @@ cglobal blur%1_horz%2, 5,7,8, -mmsize
 %else
 %if mmsize == 32
     vperm2i128 m1, m1, m2, 0x20
+%elif mmsize == 64
+    valignq m1, m2, m1, 6
 %endif
 %if cpuflag(ssse3)
     palignr m0, m2, m1, 8
@@ -985,6 +1091,14 @@ BLUR_HORZ 5,32
 BLUR_HORZ 6,32
 BLUR_HORZ 7,32
 BLUR_HORZ 8,32
+%if ARCH_X86_64 && CONFIG_AVX512
+INIT_ZMM avx512
+BLUR_HORZ 4,64
+BLUR_HORZ 5,64
+BLUR_HORZ 6,64
+BLUR_HORZ 7,64
+BLUR_HORZ 8,64
+%endif
 
 ;------------------------------------------------------------------------------
 ; BLUR_VERT 1:radius 2:suffix
@@ -1082,3 +1196,11 @@ BLUR_VERT 5,32
 BLUR_VERT 6,32
 BLUR_VERT 7,32
 BLUR_VERT 8,32
+%if ARCH_X86_64 && CONFIG_AVX512
+INIT_ZMM avx512
+BLUR_VERT 4,64
+BLUR_VERT 5,64
+BLUR_VERT 6,64
+BLUR_VERT 7,64
+BLUR_VERT 8,64
+%endif
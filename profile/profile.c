@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 #include "../libass/ass.h"
 
 typedef struct image_s {
@@ -62,14 +63,20 @@ static void init(int frame_w, int frame_h)
     ass_set_fonts(ass_renderer, NULL, "Sans", 1, NULL, 1);
 }
 
+static void print_cache_stats(const char *name, const ASS_CacheStats *stats)
+{
+    printf("%-10s hits: %llu, misses: %llu, evictions: %llu\n",
+           name, stats->hits, stats->misses, stats->evictions);
+}
+
 int main(int argc, char *argv[])
 {
     const int frame_w = 1280;
     const int frame_h = 720;
 
     if (argc < 5) {
-        printf("usage: %s <subtitle file> <start time> <fps> <end time>\n",
-               argv[0] ? argv[0] : "profile");
+        printf("usage: %s <subtitle file> <start time> <fps> <end time> "
+               "[lru|clock]\n", argv[0] ? argv[0] : "profile");
         exit(1);
     }
     char *subfile = argv[1];
@@ -83,6 +90,14 @@ int main(int argc, char *argv[])
     }
 
     init(frame_w, frame_h);
+    if (argc > 5) {
+        if (!strcmp(argv[5], "clock"))
+            ass_set_cache_policy(ass_renderer, ASS_CACHE_CLOCK);
+        else if (strcmp(argv[5], "lru")) {
+            printf("unknown cache policy: %s\n", argv[5]);
+            exit(1);
+        }
+    }
     ASS_Track *track = ass_read_file(ass_library, subfile, NULL);
     if (!track) {
         printf("track init failed!\n");
@@ -94,6 +109,17 @@ int main(int argc, char *argv[])
         tm += 1 / fps;
     }
 
+    ASS_RenderStats stats = { .size = sizeof(stats) };
+    ass_get_render_stats(ass_renderer, &stats);
+    print_cache_stats("outline", &stats.outline_cache);
+    print_cache_stats("bitmap", &stats.bitmap_cache);
+    print_cache_stats("composite", &stats.composite_cache);
+
+    ASS_BitmapPoolStats pool_stats;
+    ass_get_bitmap_pool_stats(ass_renderer, &pool_stats);
+    printf("%-10s allocs: %llu, reuses: %llu\n",
+           "pool", pool_stats.allocs, pool_stats.reuses);
+
     ass_free_track(track);
     ass_renderer_done(ass_renderer);
     ass_library_done(ass_library);
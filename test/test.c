@@ -136,42 +136,13 @@ static image_t *gen_image(int width, int height)
     return img;
 }
 
-static void blend_single(image_t * frame, ASS_Image *img)
-{
-    unsigned char r = img->color >> 24;
-    unsigned char g = (img->color >> 16) & 0xFF;
-    unsigned char b = (img->color >> 8) & 0xFF;
-    unsigned char a = 255 - (img->color & 0xFF);
-
-    unsigned char *src = img->bitmap;
-    unsigned char *dst = frame->buffer + img->dst_y * frame->stride + img->dst_x * 4;
-
-    for (int y = 0; y < img->h; ++y) {
-        for (int x = 0; x < img->w; ++x) {
-            unsigned k = ((unsigned) src[x]) * a;
-            // For high-quality output consider using dithering instead;
-            // this static offset results in biased rounding but is faster
-            unsigned rounding_offset = 255 * 255 / 2;
-            // If the original frame is not in premultiplied alpha, convert it beforehand or adjust
-            // the blending code. For fully-opaque output frames there's no difference either way.
-            dst[x * 4 + 0] = (k *   r + (255 * 255 - k) * dst[x * 4 + 0] + rounding_offset) / (255 * 255);
-            dst[x * 4 + 1] = (k *   g + (255 * 255 - k) * dst[x * 4 + 1] + rounding_offset) / (255 * 255);
-            dst[x * 4 + 2] = (k *   b + (255 * 255 - k) * dst[x * 4 + 2] + rounding_offset) / (255 * 255);
-            dst[x * 4 + 3] = (k * 255 + (255 * 255 - k) * dst[x * 4 + 3] + rounding_offset) / (255 * 255);
-        }
-        src += img->stride;
-        dst += frame->stride;
-    }
-}
-
 static void blend(image_t * frame, ASS_Image *img)
 {
     int cnt = 0;
-    while (img) {
-        blend_single(frame, img);
+    for (ASS_Image *cur = img; cur; cur = cur->next)
         ++cnt;
-        img = img->next;
-    }
+    ass_blend_frame(img, frame->buffer, frame->stride,
+                    frame->width, frame->height, ASS_FRAME_RGBA);
     printf("%d images blended\n", cnt);
 
     // Convert from pre-multiplied to straight alpha
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+#include "ass_compat.h"
+
+#include <string.h>
+
+#include "unittest.h"
+#include "ass_bitmap.h"
+
+#define N_BITMAPS 400
+#define MAX_HEIGHT 40
+
+// see blur_ref.c
+bool ref_gaussian_blur(BitmapPool *pool, const BitmapEngine *engine,
+                       ScratchBuffer *scratch, Bitmap *bm,
+                       double r2x, double r2y);
+
+// xorshift32, fixed seed for reproducible bitmaps
+static uint32_t rand_state = 0x2545F491;
+
+static uint32_t rnd(void)
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+// Around and at multiples of the block and stripe widths of all engines
+static const int gaps[] = {
+    1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 127, 128, 129, 300,
+};
+
+// Squared radii covering all levels and filter radii
+static const double radii[] = {
+    0.05, 0.2, 0.45, 0.5, 0.8, 1, 1.5, 2, 3, 4, 5, 6, 8, 10, 13, 16, 20, 25,
+    32, 40, 50, 64, 80, 100, 128, 160, 200, 256, 320, 400, 512, 640, 800,
+    1024, 1300, 1600, 2048,
+};
+
+#define N_GAPS  (sizeof(gaps) / sizeof(*gaps))
+#define N_RADII (sizeof(radii) / sizeof(*radii))
+
+// Short runs of random pixels separated by gaps of various widths,
+// with the first and last columns sometimes empty
+static bool random_bitmap(BitmapPool *pool, const BitmapEngine *engine,
+                          Bitmap *bm)
+{
+    int runs[16][2];
+    int n_runs = 1 + rnd() % 16;
+    int w = rnd() % 2 ? gaps[rnd() % N_GAPS] : 0;
+    for (int i = 0; i < n_runs; i++) {
+        runs[i][0] = w;
+        w += 1 + rnd() % 24;
+        runs[i][1] = w;
+        if (i < n_runs - 1 || rnd() % 2)
+            w += gaps[rnd() % N_GAPS];
+    }
+    int h = 1 + rnd() % MAX_HEIGHT;
+
+    if (!ass_alloc_bitmap(pool, engine, bm, w, h, true))
+        return false;
+    bm->left = rnd() % 64;
+    bm->top = rnd() % 64;
+    for (int i = 0; i < n_runs; i++)
+        for (int y = 0; y < h; y++)
+            if (rnd() % 4)
+                for (int x = runs[i][0]; x < runs[i][1]; x++)
+                    bm->buffer[y * bm->stride + x] = rnd() % 2 ? rnd() : 255;
+    return true;
+}
+
+static bool bitmaps_equal(const Bitmap *a, const Bitmap *b)
+{
+    if (a->w != b->w || a->h != b->h || a->left != b->left || a->top != b->top)
+        return false;
+    for (int32_t y = 0; y < a->h; y++)
+        if (memcmp(a->buffer + y * a->stride, b->buffer + y * b->stride, a->w))
+            return false;
+    return true;
+}
+
+static bool check_engine(BitmapPool *pool, unsigned flags)
+{
+    BitmapEngine engine = ass_bitmap_engine_init(flags);
+    ScratchBuffer scratch = {0};
+    bool ok = true;
+    for (int i = 0; ok && i < N_BITMAPS; i++) {
+        double r2x = radii[i % N_RADII];
+        double r2y = rnd() % 2 ? r2x : radii[rnd() % N_RADII];
+        Bitmap bm = {0}, ref = {0};
+        ok = CHECK(random_bitmap(pool, &engine, &bm)) &&
+             CHECK(ass_copy_bitmap(pool, &engine, &ref, &bm)) &&
+             CHECK(ass_gaussian_blur(pool, &engine, &scratch, &bm, r2x, r2y)) &&
+             CHECK(ref_gaussian_blur(pool, &engine, &scratch, &ref, r2x, r2y)) &&
+             CHECK(bitmaps_equal(&bm, &ref));
+        ass_free_bitmap(&bm);
+        ass_free_bitmap(&ref);
+    }
+    ass_scratch_done(&scratch);
+    return ok;
+}
+
+// Blurring only the nonempty column ranges must give exactly the same
+// result as blurring the full width of the bitmap, for every engine
+bool unittest_check_blur(void)
+{
+    static const unsigned flags[] = {
+        ASS_CPU_FLAG_NONE,
+        ASS_FLAG_WIDE_STRIPE,
+        ASS_FLAG_WIDER_STRIPE,
+        ASS_CPU_FLAG_ALL,
+    };
+    BitmapPool *pool = ass_bitmap_pool_create(0);
+    bool ok = CHECK(pool);
+    for (size_t i = 0; ok && i < sizeof(flags) / sizeof(*flags); i++)
+        ok = check_engine(pool, flags[i]);
+    ass_bitmap_pool_release(pool);
+    return ok;
+}
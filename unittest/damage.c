@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ass_compat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unittest.h"
+
+#define FRAME_W 640
+#define FRAME_H 360
+
+// Same as DAMAGE_MAX_RECTS in ass_render.h
+#define MAX_RECTS 64
+
+// Areas of the images of a frame
+typedef struct {
+    int n;
+    ASS_DamageRect *rects;
+} ImageRects;
+
+static bool collect_images(const ASS_Image *img, const ASS_DamageRect *area,
+                           ImageRects *out)
+{
+    out->n = 0;
+    out->rects = NULL;
+    for (; img; img = img->next) {
+        if (img->w <= 0 || img->h <= 0)
+            continue;
+        if (area && (img->dst_x < area->x0 || img->dst_x >= area->x1 ||
+                     img->dst_y < area->y0 || img->dst_y >= area->y1))
+            continue;
+        ASS_DamageRect *rects = realloc(out->rects, (out->n + 1) * sizeof(*rects));
+        if (!CHECK(rects))
+            return false;
+        out->rects = rects;
+        out->rects[out->n++] = (ASS_DamageRect) {
+            img->dst_x, img->dst_y, img->dst_x + img->w, img->dst_y + img->h
+        };
+    }
+    return true;
+}
+
+// Every image must lie within one of the damaged rectangles
+static bool check_covered(const ImageRects *images,
+                          const ASS_DamageRect *rects, int n)
+{
+    for (int i = 0; i < images->n; i++) {
+        const ASS_DamageRect *r = images->rects + i;
+        int j = 0;
+        while (j < n && (r->x0 < rects[j].x0 || r->y0 < rects[j].y0 ||
+                         r->x1 > rects[j].x1 || r->y1 > rects[j].y1))
+            j++;
+        if (!CHECK(j < n)) {
+            fprintf(stderr, "image %d,%d-%d,%d not in damage\n",
+                    r->x0, r->y0, r->x1, r->y1);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Render two frames, the damage of the second one must cover
+// all images of both frames inside area and consist of
+// between min_rects and max_rects rectangles,
+// or of none at all if min_rects is 0
+static bool check_damage(ASS_Library *library, const char *events,
+                         long long now1, long long now2,
+                         const ASS_DamageRect *area,
+                         int min_rects, int max_rects)
+{
+    ASS_Renderer *renderer = unittest_renderer(library, FRAME_W, FRAME_H);
+    ASS_Track *track = unittest_track(library, events);
+    ImageRects images1 = {0}, images2 = {0};
+    ASS_DamageRect rects[MAX_RECTS];
+    int change = -1;
+    bool ok = CHECK(renderer && track);
+    if (ok) {
+        ASS_Image *img = ass_render_frame(renderer, track, now1, &change);
+        ok = collect_images(img, area, &images1);
+    }
+    if (ok) {
+        ASS_Image *img = ass_render_frame(renderer, track, now2, &change);
+        ok = collect_images(img, area, &images2) &&
+            CHECK(min_rects ? change != 0 : change == 0);
+    }
+    if (ok) {
+        int n = ass_get_damage_rects(renderer, rects, max_rects);
+        if (!min_rects)
+            ok = CHECK(n == 0);
+        else
+            ok = CHECK(n >= min_rects && n <= max_rects) &&
+                check_covered(&images1, rects, n) &&
+                check_covered(&images2, rects, n);
+    }
+    free(images1.rects);
+    free(images2.rects);
+    ass_free_track(track);
+    ass_renderer_done(renderer);
+    return ok;
+}
+
+static const char static_events[] =
+    "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,Static line\n";
+
+static const char moving_events[] =
+    "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,"
+        "{\\move(100,100,400,300,0,5000)}Moving line\n";
+
+// The second line is only shown from 0:00:01.50 on
+static const char appearing_events[] =
+    "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,"
+        "{\\an7\\pos(20,20)}Static line\n"
+    "Dialogue: 0,0:00:01.50,0:00:10.00,Default,,0,0,0,,"
+        "{\\an9\\pos(620,340)}Appearing line\n";
+
+static const ASS_DamageRect appearing_area = {
+    FRAME_W / 2, FRAME_H / 2, FRAME_W, FRAME_H
+};
+
+// A grid of small moving events far enough apart
+// to make more than MAX_RECTS separate changes
+#define GRID_COLS 10
+#define GRID_ROWS 9
+
+static char *grid_events(void)
+{
+    const char *fmt = "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,"
+        "{\\an7\\fs10\\bord0\\shad0\\move(%d,%d,%d,%d,0,10000)}x\n";
+    size_t size = GRID_COLS * GRID_ROWS * (strlen(fmt) + 4 * 16) + 1;
+    char *buf = malloc(size), *ptr = buf;
+    if (!buf)
+        return NULL;
+    for (int y = 0; y < GRID_ROWS; y++)
+        for (int x = 0; x < GRID_COLS; x++) {
+            int x0 = 8 + 64 * x, y0 = 8 + 40 * y;
+            ptr += snprintf(ptr, size - (ptr - buf), fmt,
+                            x0, y0, x0 + 8, y0 + 8);
+        }
+    return buf;
+}
+
+// With a NULL detect_change, the whole frame is reported
+static bool check_whole_frame(ASS_Library *library)
+{
+    ASS_Renderer *renderer = unittest_renderer(library, FRAME_W, FRAME_H);
+    ASS_Track *track = unittest_track(library, static_events);
+    ASS_DamageRect rects[MAX_RECTS];
+    int change;
+    bool ok = CHECK(renderer && track);
+    if (ok)
+        ok = CHECK(ass_render_frame(renderer, track, 1000, &change)) &&
+            CHECK(ass_render_frame(renderer, track, 2000, NULL));
+    if (ok) {
+        int n = ass_get_damage_rects(renderer, rects, MAX_RECTS);
+        ok = CHECK(n == 1) &&
+            CHECK(rects[0].x0 == 0 && rects[0].y0 == 0) &&
+            CHECK(rects[0].x1 == FRAME_W && rects[0].y1 == FRAME_H);
+    }
+    ass_free_track(track);
+    ass_renderer_done(renderer);
+    return ok;
+}
+
+bool unittest_check_damage(void)
+{
+    ASS_Library *library = unittest_library();
+    char *grid = grid_events();
+    bool ok = CHECK(library && grid);
+
+    ok = ok && check_damage(library, static_events, 1000, 2000, NULL, 0, MAX_RECTS);
+    ok = ok && check_damage(library, moving_events, 1000, 2000, NULL, 1, MAX_RECTS);
+    ok = ok && check_damage(library, appearing_events, 1000, 2000,
+                            &appearing_area, 1, MAX_RECTS);
+    ok = ok && check_damage(library, appearing_events, 2000, 1000,
+                            &appearing_area, 1, MAX_RECTS);
+    ok = ok && check_damage(library, grid, 1000, 6000, NULL, 1, MAX_RECTS);
+    ok = ok && check_damage(library, grid, 1000, 6000, NULL, 1, 4);
+    ok = ok && check_damage(library, grid, 1000, 6000, NULL, 1, 1);
+    ok = ok && check_whole_frame(library);
+
+    free(grid);
+    ass_library_done(library);
+    return ok;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ass_compat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "unittest.h"
+
+// Enough events for the index to be built on the first frame
+#define N_EVENTS 200
+#define MOVED 100
+
+// Event i is shown from i seconds for half a second
+static char *make_events(void)
+{
+    static const char line[] =
+        "Dialogue: 0,0:%02d:%02d.00,0:%02d:%02d.50,Default,,0,0,0,,Line %d\n";
+    size_t size = N_EVENTS * sizeof(line) + 1;
+    char *buf = malloc(size);
+    if (!buf)
+        return NULL;
+    size_t pos = 0;
+    for (int i = 0; i < N_EVENTS; i++)
+        pos += snprintf(buf + pos, size - pos, line,
+                        i / 60, i % 60, i / 60, i % 60, i);
+    return buf;
+}
+
+// Events whose times are edited in place must be found
+// at their new times once ass_track_changed is called
+bool unittest_check_event_index(void)
+{
+    ASS_Library *library = unittest_library();
+    ASS_Renderer *renderer = library ? unittest_renderer(library, 640, 360) : NULL;
+    char *events = make_events();
+    ASS_Track *track = events ? unittest_track(library, events) : NULL;
+    bool ok = CHECK(library && renderer && track) &&
+              CHECK(track->n_events == N_EVENTS);
+
+    long long start = MOVED * 1000;
+    if (ok) {
+        ok = CHECK(ass_render_frame(renderer, track, start + 250, NULL)) &&
+             CHECK(!ass_render_frame(renderer, track, start + 750, NULL)) &&
+             CHECK(ass_step_sub(track, start - 300, 1) == 300);
+    }
+
+    if (ok) {
+        ASS_Event *event = track->events + MOVED;
+        // move it past the following events, to the gap after event 105
+        event->Start = start + 5700;
+        event->Duration = 200;
+        ass_track_changed(track);
+
+        ok = CHECK(!ass_render_frame(renderer, track, start + 250, NULL)) &&
+             CHECK(ass_render_frame(renderer, track, start + 5750, NULL)) &&
+             CHECK(ass_step_sub(track, start - 300, 1) == 1300) &&
+             CHECK(ass_step_sub(track, start + 5950, -1) == -250);
+    }
+
+    ass_free_track(track);
+    free(events);
+    ass_renderer_done(renderer);
+    ass_library_done(library);
+    return ok;
+}
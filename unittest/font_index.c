@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ass_compat.h"
+
+#include <stdio.h>
+
+#include "unittest.h"
+#include "ass_filesystem.h"
+
+// Created in the working directory
+#define INDEX_FILE "unittest_font_index"
+
+#define N_STALE_FIXED 16
+#define N_STALE_OWN   4
+
+static bool file_exists(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return false;
+    fclose(fp);
+    return true;
+}
+
+// Temporary files as left behind by crashed writers: all the names
+// earlier versions tried, and the first ones this process would use
+static void stale_file_name(char *buf, size_t size, int i)
+{
+    if (i < N_STALE_FIXED)
+        snprintf(buf, size, "%s.%d.tmp", INDEX_FILE, i);
+    else
+        snprintf(buf, size, "%s.%lu.%d.tmp", INDEX_FILE,
+                 ass_process_id(), i - N_STALE_FIXED + 1);
+}
+
+static void remove_files(void)
+{
+    char name[64];
+    remove(INDEX_FILE);
+    for (int i = 0; i < N_STALE_FIXED + N_STALE_OWN; i++) {
+        stale_file_name(name, sizeof(name), i);
+        remove(name);
+    }
+}
+
+// The index must be written despite leftover temporary files,
+// which are not touched, as they may still be in use
+bool unittest_check_font_index(void)
+{
+    char name[64];
+    remove_files();
+    bool ok = true;
+    for (int i = 0; ok && i < N_STALE_FIXED + N_STALE_OWN; i++) {
+        stale_file_name(name, sizeof(name), i);
+        FILE *fp = fopen(name, "wb");
+        ok = CHECK(fp);
+        if (fp)
+            fclose(fp);
+    }
+
+    ASS_Library *library = ok ? unittest_library() : NULL;
+    ok = ok && CHECK(library);
+    if (ok)
+        ass_set_font_index_file(library, INDEX_FILE);
+    // ass_set_fonts indexes the fonts of fonts_dir
+    ASS_Renderer *renderer = ok ? unittest_renderer(library, 640, 360) : NULL;
+    ok = ok && CHECK(renderer) && CHECK(file_exists(INDEX_FILE));
+    for (int i = 0; ok && i < N_STALE_FIXED + N_STALE_OWN; i++) {
+        stale_file_name(name, sizeof(name), i);
+        ok = CHECK(file_exists(name));
+    }
+
+    ass_renderer_done(renderer);
+    ass_library_done(library);
+    remove_files();
+    return ok;
+}
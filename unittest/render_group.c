@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2025 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ass_compat.h"
+
+#include "unittest.h"
+#include "ass_threading.h"
+
+// Lines that collide, so that all but the first are moved.
+// They share start and end times, so their final positions
+// don't depend on the frames rendered before.
+static const char colliding_events[] =
+    "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,First line\n"
+    "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,Second line\n"
+    "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,{\\fs60}Third line\n";
+
+static const long long frame_times[] = { 500, 1500, 2500, 5000, 9000 };
+#define N_FRAMES (sizeof(frame_times) / sizeof(frame_times[0]))
+
+static const int sizes[][2] = { { 640, 360 }, { 1280, 720 } };
+#define N_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+// Render with a separate renderer and track
+static bool render_reference(ASS_Library *library, int width, int height,
+                             uint64_t *hashes)
+{
+    ASS_Renderer *renderer = unittest_renderer(library, width, height);
+    ASS_Track *track = unittest_track(library, colliding_events);
+    bool ok = CHECK(renderer && track);
+    for (int i = 0; ok && i < N_FRAMES; i++) {
+        ASS_Image *img = ass_render_frame(renderer, track, frame_times[i], NULL);
+        ok = CHECK(img);
+        hashes[i] = unittest_hash_images(img);
+    }
+    ass_free_track(track);
+    ass_renderer_done(renderer);
+    return ok;
+}
+
+// Renderers of a group must not mix up their collision state
+// when they take turns rendering the same track
+static bool check_alternating(ASS_Library *library,
+                              uint64_t ref[N_SIZES][N_FRAMES])
+{
+    ASS_Renderer *renderer[N_SIZES] = { NULL };
+    ASS_Track *track = unittest_track(library, colliding_events);
+    bool ok = CHECK(track);
+    for (int i = 0; ok && i < N_SIZES; i++) {
+        renderer[i] = i ?
+            unittest_renderer_shared(renderer[0], sizes[i][0], sizes[i][1]) :
+            unittest_renderer(library, sizes[i][0], sizes[i][1]);
+        ok = CHECK(renderer[i]);
+    }
+
+    for (int i = 0; ok && i < N_FRAMES; i++) {
+        for (int j = 0; ok && j < N_SIZES; j++) {
+            ASS_Image *img = ass_render_frame(renderer[j], track, frame_times[i], NULL);
+            ok = CHECK(unittest_hash_images(img) == ref[j][i]);
+        }
+    }
+
+    for (int i = 0; i < N_SIZES; i++)
+        ass_renderer_done(renderer[i]);
+    ass_free_track(track);
+    return ok;
+}
+
+#if CONFIG_THREADS
+
+typedef struct {
+    ASS_Renderer *renderer;
+    ASS_Track *track;
+    const uint64_t *ref;
+    ASS_Thread thread;
+    bool ok;
+} RenderThread;
+
+#define THREAD_ITERATIONS 20
+
+static void *render_thread(void *arg)
+{
+    RenderThread *job = arg;
+    for (int n = 0; job->ok && n < THREAD_ITERATIONS; n++) {
+        for (int i = 0; job->ok && i < N_FRAMES; i++) {
+            ASS_Image *img = ass_render_frame(job->renderer, job->track,
+                                              frame_times[i], NULL);
+            job->ok = CHECK(unittest_hash_images(img) == job->ref[i]);
+        }
+    }
+    return NULL;
+}
+
+// Renderers of a group rendering the same track concurrently
+// must give the same results as on their own
+static bool check_concurrent(ASS_Library *library,
+                             uint64_t ref[N_SIZES][N_FRAMES])
+{
+    RenderThread jobs[N_SIZES] = { { NULL } };
+    ASS_Track *track = unittest_track(library, colliding_events);
+    bool ok = CHECK(track);
+    for (int i = 0; ok && i < N_SIZES; i++) {
+        jobs[i].renderer = i ?
+            unittest_renderer_shared(jobs[0].renderer, sizes[i][0], sizes[i][1]) :
+            unittest_renderer(library, sizes[i][0], sizes[i][1]);
+        jobs[i].track = track;
+        jobs[i].ref = ref[i];
+        jobs[i].ok = true;
+        ok = CHECK(jobs[i].renderer);
+    }
+
+    int n_started = 0;
+    for (; ok && n_started < N_SIZES; n_started++)
+        ok = CHECK(ass_thread_create(&jobs[n_started].thread,
+                                     render_thread, &jobs[n_started]));
+    for (int i = 0; i < n_started; i++) {
+        ass_thread_join(&jobs[i].thread);
+        ok &= jobs[i].ok;
+    }
+
+    for (int i = 0; i < N_SIZES; i++)
+        ass_renderer_done(jobs[i].renderer);
+    ass_free_track(track);
+    return ok;
+}
+
+#endif
+
+// 3 MB split between bitmaps and composite bitmaps, see ass_set_cache_limits
+#define COMPOSITE_LIMIT (1024 * 1024)
+
+// The cache limits apply to the whole cache, so a frame that fits
+// into them is rendered again without any cache misses
+static bool check_cache_budget(ASS_Library *library)
+{
+    static const char events[] =
+        "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,"
+        "{\\fs80\\bord4\\shad0\\blur2}Large text\n";
+
+    ASS_Renderer *first = unittest_renderer(library, 1280, 720);
+    ASS_Renderer *second = first ? unittest_renderer_shared(first, 1280, 720) : NULL;
+    ASS_Track *track = unittest_track(library, events);
+    bool ok = CHECK(first && second && track);
+    if (ok) {
+        ass_set_cache_limits(first, 0, 3);
+        ok = CHECK(ass_render_frame(first, track, 1000, NULL));
+    }
+
+    ASS_RenderStats before = { .size = sizeof(before) };
+    ASS_RenderStats after = { .size = sizeof(after) };
+    if (ok) {
+        ass_get_render_stats(first, &before);
+        ok = CHECK(before.composite_cache.size <= COMPOSITE_LIMIT &&
+                   before.composite_cache.size > 0);
+    }
+    // release the references of the first renderer's images
+    ass_renderer_done(first);
+    if (ok) {
+        ok = CHECK(ass_render_frame(second, track, 1000, NULL));
+        ass_get_render_stats(second, &after);
+        ok = ok && CHECK(after.bitmap_cache.misses == before.bitmap_cache.misses) &&
+            CHECK(after.composite_cache.misses == before.composite_cache.misses) &&
+            CHECK(after.composite_cache.evictions == before.composite_cache.evictions);
+    }
+
+    ass_renderer_done(second);
+    ass_free_track(track);
+    return ok;
+}
+
+bool unittest_check_render_group(void)
+{
+    ASS_Library *library = unittest_library();
+    bool ok = CHECK(library);
+
+    uint64_t ref[N_SIZES][N_FRAMES];
+    for (int i = 0; ok && i < N_SIZES; i++)
+        ok = render_reference(library, sizes[i][0], sizes[i][1], ref[i]);
+
+    ok = ok && check_alternating(library, ref);
+#if CONFIG_THREADS
+    ok = ok && check_concurrent(library, ref);
+#endif
+    ok = ok && check_cache_budget(library);
+
+    ass_library_done(library);
+    return ok;
+}
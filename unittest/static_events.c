@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ass_compat.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "unittest.h"
+
+// A static event, whose result is kept from one frame to the next
+static const char events[] =
+    "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,Static line\n";
+
+// Restyled once a style named Alt is added
+static const char restyled_events[] =
+    "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,{\\rAlt}Restyled line\n";
+
+static char *overrides[] = { "Default.Fontsize=60", NULL };
+
+#define ALT_STYLE \
+    "Style: Alt," UNITTEST_FONT ",60,&H000000FF,&H000000FF,&H00000000," \
+    "&H80000000,0,0,0,0,100,100,0,0,1,2,1,2,10,10,10,1\n"
+
+// Created in the working directory
+#define STYLES_FILE "unittest_static_events.styles"
+
+typedef void ChangeFunc(ASS_Library *library, ASS_Track *track);
+
+static ASS_Style *default_style(ASS_Track *track)
+{
+    for (int i = track->n_styles - 1; i >= 0; i--)
+        if (!strcmp(track->styles[i].Name, "Default"))
+            return track->styles + i;
+    return NULL;
+}
+
+static void change_style(ASS_Library *library, ASS_Track *track)
+{
+    default_style(track)->PrimaryColour = 0x00FF0000;
+    ass_track_changed(track);
+}
+
+static void change_text(ASS_Library *library, ASS_Track *track)
+{
+    ASS_Event *event = track->events;
+    ass_free(event->Text);
+    event->Text = ass_malloc(sizeof("Changed line"));
+    memcpy(event->Text, "Changed line", sizeof("Changed line"));
+    ass_track_changed(track);
+}
+
+static void force_style(ASS_Library *library, ASS_Track *track)
+{
+    ass_set_style_overrides(library, overrides);
+    ass_process_force_style(track);
+}
+
+static void read_styles(ASS_Library *library, ASS_Track *track)
+{
+    static const char data[] = ALT_STYLE;
+    FILE *fp = fopen(STYLES_FILE, "wb");
+    if (!CHECK(fp))
+        return;
+    bool ok = CHECK(fwrite(data, 1, sizeof(data) - 1, fp) == sizeof(data) - 1);
+    ok = CHECK(!fclose(fp)) && ok;
+    if (ok)
+        CHECK(!ass_read_styles(track, STYLES_FILE, NULL));
+    remove(STYLES_FILE);
+}
+
+static void codec_private(ASS_Library *library, ASS_Track *track)
+{
+    static const char data[] = "[V4+ Styles]\n" ALT_STYLE;
+    ass_process_codec_private(track, data, sizeof(data) - 1);
+}
+
+static void change_header(ASS_Library *library, ASS_Track *track)
+{
+    static const char data[] =
+        "[Script Info]\n"
+        "PlayResX: 320\n"
+        "PlayResY: 180\n";
+    ass_process_data(track, data, sizeof(data) - 1);
+}
+
+// Render a frame of the changed track with a new renderer
+static bool render_reference(ASS_Library *library, const char *events,
+                             ChangeFunc change, uint64_t *hash)
+{
+    ASS_Renderer *renderer = unittest_renderer(library, 640, 360);
+    ASS_Track *track = unittest_track(library, events);
+    bool ok = CHECK(renderer && track) && CHECK(default_style(track));
+    if (ok) {
+        change(library, track);
+        ASS_Image *img = ass_render_frame(renderer, track, 2000, NULL);
+        ok = CHECK(img);
+        *hash = unittest_hash_images(img);
+    }
+    ass_set_style_overrides(library, NULL);
+    ass_free_track(track);
+    ass_renderer_done(renderer);
+    return ok;
+}
+
+// Changing a track after a frame was rendered
+// must not leave the kept results in use
+static bool check_change(ASS_Library *library, const char *events,
+                         ChangeFunc change)
+{
+    uint64_t ref;
+    if (!render_reference(library, events, change, &ref))
+        return false;
+
+    ASS_Renderer *renderer = unittest_renderer(library, 640, 360);
+    ASS_Track *track = unittest_track(library, events);
+    bool ok = CHECK(renderer && track) && CHECK(default_style(track));
+    if (ok) {
+        ASS_Image *img = ass_render_frame(renderer, track, 1000, NULL);
+        ok = CHECK(img) && CHECK(unittest_hash_images(img) != ref);
+    }
+    if (ok) {
+        change(library, track);
+        ASS_Image *img = ass_render_frame(renderer, track, 2000, NULL);
+        ok = CHECK(unittest_hash_images(img) == ref);
+    }
+    ass_set_style_overrides(library, NULL);
+    ass_free_track(track);
+    ass_renderer_done(renderer);
+    return ok;
+}
+
+// Animated events whose layout is kept from one frame to the next,
+// except the last one, where the animation changes the layout
+static const char *const animated_events[] = {
+    "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,"
+        "{\\move(100,100,400,300,0,5000)}Moving line\n",
+    "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,"
+        "{\\fad(1500,0)}Fading line\n",
+    "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,"
+        "{\\t(0,3000,\\c&H0000FF&\\3a&H80&)}Changing color\n",
+    "Dialogue: 0,0:00:00.00,0:00:10.00,Default,,0,0,0,,"
+        "{\\t(0,3000,\\fs80)}Changing size\n",
+};
+
+// Render a frame of an animated event at a time with a new renderer
+static bool render_animated(ASS_Library *library, const char *events,
+                            long long now, uint64_t *hash)
+{
+    ASS_Renderer *renderer = unittest_renderer(library, 640, 360);
+    ASS_Track *track = unittest_track(library, events);
+    bool ok = CHECK(renderer && track);
+    if (ok) {
+        ASS_Image *img = ass_render_frame(renderer, track, now, NULL);
+        ok = CHECK(img);
+        *hash = unittest_hash_images(img);
+    }
+    ass_free_track(track);
+    ass_renderer_done(renderer);
+    return ok;
+}
+
+// A frame rendered with the layout of the previous one
+// must be the same as one rendered from scratch
+static bool check_animated(ASS_Library *library, const char *events)
+{
+    uint64_t ref1, ref2;
+    if (!render_animated(library, events, 1000, &ref1) ||
+            !render_animated(library, events, 2000, &ref2) ||
+            !CHECK(ref1 != ref2))
+        return false;
+
+    ASS_Renderer *renderer = unittest_renderer(library, 640, 360);
+    ASS_Track *track = unittest_track(library, events);
+    bool ok = CHECK(renderer && track);
+    if (ok) {
+        ASS_Image *img = ass_render_frame(renderer, track, 1000, NULL);
+        ok = CHECK(unittest_hash_images(img) == ref1);
+    }
+    if (ok) {
+        ASS_Image *img = ass_render_frame(renderer, track, 2000, NULL);
+        ok = CHECK(unittest_hash_images(img) == ref2);
+    }
+    ass_free_track(track);
+    ass_renderer_done(renderer);
+    return ok;
+}
+
+bool unittest_check_static_events(void)
+{
+    ASS_Library *library = unittest_library();
+    bool ok = CHECK(library);
+
+    ok = ok && check_change(library, events, change_style);
+    ok = ok && check_change(library, events, change_text);
+    ok = ok && check_change(library, events, force_style);
+    ok = ok && check_change(library, events, change_header);
+    ok = ok && check_change(library, restyled_events, read_styles);
+    ok = ok && check_change(library, restyled_events, codec_private);
+    for (size_t i = 0; i < sizeof(animated_events) / sizeof(*animated_events); i++)
+        ok = ok && check_animated(library, animated_events[i]);
+
+    ass_library_done(library);
+    return ok;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ass_compat.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "unittest.h"
+#include "ass_outline.h"
+
+#define N_OUTLINES 20000
+#define EPS 16  // as STROKER_PRECISION in ass_render.c
+
+// see stroker_ref.c
+bool ref_outline_stroke(ASS_Outline *result, ASS_Outline *result1,
+                        const ASS_Outline *path, int xbord, int ybord, int eps);
+
+// xorshift32, fixed seed for reproducible outlines
+static uint32_t rand_state = 0x12345678;
+
+static uint32_t rnd(void)
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+// Uniform in [-max, max]
+static int32_t rnd_offset(int32_t max)
+{
+    return (int32_t) (rnd() % (2 * (uint32_t) max + 1)) - max;
+}
+
+// Up to 4 contours of up to 8 segments of random order. Some points are
+// repeated and single line contours are single points, as those take
+// the degenerate paths of the stroker.
+static bool random_outline(ASS_Outline *outline)
+{
+    if (!ass_outline_alloc(outline, 64, 32))
+        return false;
+
+    int32_t scale = EPS << (rnd() % 16);
+    int n_contours = 1 + rnd() % 4;
+    for (int i = 0; i < n_contours; i++) {
+        ASS_Vector pt = { rnd_offset(4 * scale), rnd_offset(4 * scale) };
+        int n_segments = 1 + rnd() % 8;
+        for (int j = 0; j < n_segments; j++) {
+            int order = 1 + rnd() % 3;
+            for (int k = 0; k < order; k++) {
+                if (rnd() % 8) {
+                    pt.x += rnd_offset(scale);
+                    pt.y += rnd_offset(scale);
+                }
+                if (!ass_outline_add_point(outline, pt, k ? 0 : order))
+                    return false;
+            }
+        }
+        ass_outline_close_contour(outline);
+    }
+    return true;
+}
+
+static bool outlines_equal(const ASS_Outline *a, const ASS_Outline *b)
+{
+    return a->n_points == b->n_points && a->n_segments == b->n_segments &&
+           !memcmp(a->points, b->points, a->n_points * sizeof(*a->points)) &&
+           !memcmp(a->segments, b->segments, a->n_segments);
+}
+
+// Borders from EPS to 2^16, sometimes in one direction only
+static void random_border(int *xbord, int *ybord)
+{
+    int rad = EPS << (rnd() % 13);
+    int other = rnd() % 4 ? rnd() % (rad + 1) : 0;
+    *xbord = rnd() % 2 ? rad : other;
+    *ybord = *xbord == rad ? other : rad;
+}
+
+// The stroker must produce exactly the same outlines as the reference,
+// which emits arc points one at a time. The time spent by each is
+// printed for comparison of the two.
+bool unittest_check_stroker(void)
+{
+    int64_t time = 0, ref_time = 0;
+    bool ok = true;
+    for (int i = 0; ok && i < N_OUTLINES; i++) {
+        ASS_Outline path, result[2], ref[2];
+        ass_outline_clear(&path);
+        ok = CHECK(random_outline(&path));
+
+        int xbord, ybord;
+        random_border(&xbord, &ybord);
+        if (ok) {
+            int64_t start = ass_time_ns();
+            bool res = ass_outline_stroke(&result[0], &result[1],
+                                          &path, xbord, ybord, EPS);
+            int64_t mid = ass_time_ns();
+            bool ref_res = ref_outline_stroke(&ref[0], &ref[1],
+                                              &path, xbord, ybord, EPS);
+            ref_time += ass_time_ns() - mid;
+            time += mid - start;
+
+            ok = CHECK(res == ref_res) &&
+                 CHECK(!res || (outlines_equal(&result[0], &ref[0]) &&
+                                outlines_equal(&result[1], &ref[1])));
+            for (int k = 0; k < 2; k++) {
+                ass_outline_free(&result[k]);
+                ass_outline_free(&ref[k]);
+            }
+        }
+        ass_outline_free(&path);
+    }
+
+    if (ok)
+        printf("   stroked %d outlines in %.1f ms, reference %.1f ms\n",
+               N_OUTLINES, time / 1e6, ref_time / 1e6);
+    return ok;
+}
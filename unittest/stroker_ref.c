@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2026 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+// The outline code built with arc points emitted one at a time, as the
+// stroker worked before batching, for comparison in stroker.c.
+// All external functions are renamed to not clash with the library.
+
+#define ARC_BATCH_ORDER 0
+
+#define ass_outline_clear                    ref_outline_clear
+#define ass_outline_alloc                    ref_outline_alloc
+#define ass_outline_free                     ref_outline_free
+#define ass_outline_convert                  ref_outline_convert
+#define ass_outline_add_rect                 ref_outline_add_rect
+#define ass_outline_reserve                  ref_outline_reserve
+#define ass_outline_add_point                ref_outline_add_point
+#define ass_outline_add_segment              ref_outline_add_segment
+#define ass_outline_close_contour            ref_outline_close_contour
+#define ass_outline_rotate_90                ref_outline_rotate_90
+#define ass_outline_scale_pow2               ref_outline_scale_pow2
+#define ass_outline_transform_2d             ref_outline_transform_2d
+#define ass_outline_transform_3d             ref_outline_transform_3d
+#define ass_outline_update_min_transformed_x ref_outline_update_min_transformed_x
+#define ass_outline_update_cbox              ref_outline_update_cbox
+#define ass_outline_stroke                   ref_outline_stroke
+
+#include "ass_outline.c"
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2025 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "ass_compat.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "unittest.h"
+
+// List of tests to invoke
+static const struct {
+    const char *name;
+    bool (*func)(void);
+} tests[] = {
+    { "render_group", unittest_check_render_group },
+    { "event_index", unittest_check_event_index },
+    { "static_events", unittest_check_static_events },
+    { "font_index", unittest_check_font_index },
+    { "stroker", unittest_check_stroker },
+    { "blur", unittest_check_blur },
+    { "damage", unittest_check_damage },
+    { 0 }
+};
+
+static const char script_header[] =
+    "[Script Info]\n"
+    "ScriptType: v4.00+\n"
+    "PlayResX: 640\n"
+    "PlayResY: 360\n"
+    "ScaledBorderAndShadow: yes\n"
+    "\n"
+    "[V4+ Styles]\n"
+    "Format: Name, Fontname, Fontsize, PrimaryColour, SecondaryColour, "
+    "OutlineColour, BackColour, Bold, Italic, Underline, StrikeOut, "
+    "ScaleX, ScaleY, Spacing, Angle, BorderStyle, Outline, Shadow, "
+    "Alignment, MarginL, MarginR, MarginV, Encoding\n"
+    "Style: Default," UNITTEST_FONT ",40,&H00FFFFFF,&H000000FF,&H00000000,"
+    "&H80000000,0,0,0,0,100,100,0,0,1,2,1,2,10,10,10,1\n"
+    "\n"
+    "[Events]\n"
+    "Format: Layer, Start, End, Style, Name, MarginL, MarginR, MarginV, "
+    "Effect, Text\n";
+
+bool unittest_fail(const char *file, int line, const char *cond)
+{
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, cond);
+    return false;
+}
+
+static void msg_callback(int level, const char *fmt, va_list va, void *data)
+{
+    if (level > 1)
+        return;
+    fprintf(stderr, "libass: ");
+    vfprintf(stderr, fmt, va);
+    fprintf(stderr, "\n");
+}
+
+ASS_Library *unittest_library(void)
+{
+    ASS_Library *library = ass_library_init();
+    if (!library)
+        return NULL;
+    ass_set_message_cb(library, msg_callback, NULL);
+    ass_set_fonts_dir(library, UNITTEST_FONT_DIR);
+    return library;
+}
+
+static ASS_Renderer *setup_renderer(ASS_Renderer *renderer,
+                                    int width, int height)
+{
+    if (!renderer)
+        return NULL;
+    ass_set_frame_size(renderer, width, height);
+    ass_set_storage_size(renderer, width, height);
+    return renderer;
+}
+
+ASS_Renderer *unittest_renderer(ASS_Library *library, int width, int height)
+{
+    ASS_Renderer *renderer = ass_renderer_init(library);
+    if (!renderer)
+        return NULL;
+    ass_set_fonts(renderer, NULL, UNITTEST_FONT, ASS_FONTPROVIDER_NONE, NULL, 0);
+    return setup_renderer(renderer, width, height);
+}
+
+ASS_Renderer *unittest_renderer_shared(ASS_Renderer *source,
+                                       int width, int height)
+{
+    return setup_renderer(ass_renderer_init_shared(source), width, height);
+}
+
+ASS_Track *unittest_track(ASS_Library *library, const char *events)
+{
+    size_t header_size = sizeof(script_header) - 1;
+    size_t events_size = strlen(events);
+    char *buf = malloc(header_size + events_size);
+    if (!buf)
+        return NULL;
+    memcpy(buf, script_header, header_size);
+    memcpy(buf + header_size, events, events_size);
+    ASS_Track *track = ass_read_memory(library, buf, header_size + events_size, NULL);
+    free(buf);
+    return track;
+}
+
+// FNV-1a
+static uint64_t hash_data(uint64_t hash, const void *data, size_t size)
+{
+    const uint8_t *ptr = data;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ ptr[i]) * 0x100000001B3;
+    return hash;
+}
+
+uint64_t unittest_hash_images(const ASS_Image *img)
+{
+    uint64_t hash = 0xCBF29CE484222325;
+    for (; img; img = img->next) {
+        int32_t header[5] = { img->w, img->h, img->dst_x, img->dst_y, img->color };
+        hash = hash_data(hash, header, sizeof(header));
+        for (int y = 0; y < img->h; y++)
+            hash = hash_data(hash, img->bitmap + y * img->stride, img->w);
+    }
+    return hash;
+}
+
+int main(int argc, char *argv[])
+{
+    // run all tests, or only the ones given on the command line
+    int n_failed = 0;
+    for (int i = 0; tests[i].name; i++) {
+        bool selected = argc < 2;
+        for (int j = 1; j < argc; j++)
+            if (!strcmp(argv[j], tests[i].name))
+                selected = true;
+        if (!selected)
+            continue;
+
+        bool ok = tests[i].func();
+        printf(" - %-24s %s\n", tests[i].name, ok ? "OK" : "FAILED");
+        if (!ok)
+            n_failed++;
+    }
+
+    if (n_failed)
+        printf("%d test%s failed\n", n_failed, n_failed > 1 ? "s" : "");
+    return n_failed ? 1 : 0;
+}
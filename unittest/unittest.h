@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2025 libass contributors
+ *
+ * This file is part of libass.
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifndef UNITTEST_UNITTEST_H
+#define UNITTEST_UNITTEST_H
+
+#include "config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ass.h"
+
+// Regression tests for library behavior that can't be checked
+// by comparing rendered images against references (see compare/).
+// The fonts of compare/test are used for rendering.
+
+#define UNITTEST_FONT "Aileron"
+
+bool unittest_check_render_group(void);
+bool unittest_check_event_index(void);
+bool unittest_check_static_events(void);
+bool unittest_check_font_index(void);
+bool unittest_check_stroker(void);
+bool unittest_check_blur(void);
+bool unittest_check_damage(void);
+
+// Report a failed check; always returns false
+bool unittest_fail(const char *file, int line, const char *cond);
+
+// Evaluates to false and reports the failure if cond doesn't hold
+#define CHECK(cond) ((cond) ? true : unittest_fail(__FILE__, __LINE__, #cond))
+
+ASS_Library *unittest_library(void);
+ASS_Renderer *unittest_renderer(ASS_Library *library, int width, int height);
+ASS_Renderer *unittest_renderer_shared(ASS_Renderer *source,
+                                       int width, int height);
+
+// Read a track with a default style using UNITTEST_FONT,
+// events is the text of the [Events] section
+ASS_Track *unittest_track(ASS_Library *library, const char *events);
+
+// Hash of the positions, colors and contents of an image list
+uint64_t unittest_hash_images(const ASS_Image *img);
+
+#endif /* UNITTEST_UNITTEST_H */